@@ -91,6 +91,7 @@ LOCAL_SRC_FILES :=  main/gemrb/plugins/SAVImporter/SAVImporter.cpp \
 		    main/gemrb/plugins/SDLVideo/SDLVideo.cpp \
 		    main/gemrb/plugins/SDLVideo/SDLSurfaceSprite2D.cpp \
 		    main/gemrb/plugins/BIFImporter/BIFImporter.cpp \
+		    main/gemrb/plugins/BIFImporter/BIFCStream.cpp \
 		    main/gemrb/plugins/KEYImporter/KEYImporter.cpp \
 		    main/gemrb/plugins/AREImporter/AREImporter.cpp \
 		    main/gemrb/plugins/DirectoryImporter/DirectoryImporter.cpp \
@@ -155,10 +156,12 @@ LOCAL_SRC_FILES :=  main/gemrb/plugins/SAVImporter/SAVImporter.cpp \
 		    main/gemrb/core/System/Logger/Stdio.cpp \
 		    main/gemrb/core/System/Logger/Android.cpp \
 		    main/gemrb/core/System/StringBuffer.cpp \
+		    main/gemrb/core/System/Thread.cpp \
 		    main/gemrb/core/System/VFS.cpp \
 		    main/gemrb/core/System/String.cpp \
 		    main/gemrb/core/System/Logging.cpp \
 		    main/gemrb/core/System/FileStream.cpp \
+		    main/gemrb/core/System/MappedFileStream.cpp \
 		    main/gemrb/core/System/MemoryStream.cpp \
 		    main/gemrb/core/System/DataStream.cpp \
 		    main/gemrb/core/System/SlicedStream.cpp \
@@ -183,6 +186,7 @@ LOCAL_SRC_FILES :=  main/gemrb/plugins/SAVImporter/SAVImporter.cpp \
 		    main/gemrb/core/ResourceManager.cpp \
 		    main/gemrb/core/Video.cpp \
 		    main/gemrb/core/SpriteCover.cpp \
+		    main/gemrb/core/Effect.cpp \
 		    main/gemrb/core/EffectQueue.cpp \
 		    main/gemrb/core/TileOverlay.cpp \
 		    main/gemrb/core/KeyMap.cpp \
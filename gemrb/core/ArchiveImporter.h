@@ -25,6 +25,9 @@
 
 #include "Plugin.h"
 
+#include <string>
+#include <vector>
+
 namespace GemRB {
 
 class GEM_EXPORT ArchiveImporter : public Plugin {
@@ -35,6 +38,8 @@ public:
 	//decompressing a .sav file similar to CBF
 	virtual int DecompressSaveGame(DataStream *compressed) = 0;
 	virtual int AddToSaveGame(DataStream *str, DataStream *uncompressed) = 0;
+	//compresses the given files and appends them in order
+	virtual int AddFilesToSaveGame(DataStream *str, const std::vector<std::string> &paths) = 0;
 };
 
 }
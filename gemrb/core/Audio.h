@@ -79,6 +79,8 @@ public:
 	virtual void QueueBuffer(int stream, unsigned short bits,
 				int channels, short* memory, int size, int samplerate) = 0;
 	virtual void UpdateMapAmbient(MapReverb&) {};
+	/** Starts decoding a sound in the background, so a later Play doesn't wait for it */
+	virtual void Prefetch(const char* /*ResRef*/) {};
 
 protected:
 	AmbientMgr* ambim;
@@ -0,0 +1,113 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2014 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "Effect.h"
+
+#include "System/Logging.h"
+
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace GemRB {
+
+// effects are created and destroyed by the thousand (one copy per target
+// of every area spell), so they are carved out of slabs and recycled
+#define EFFECT_SLAB_SIZE 256
+
+//free effects hold the link to the next free one
+union EffectSlot {
+	EffectSlot *next;
+	char storage[sizeof(Effect)];
+	ieDword align;
+};
+
+static EffectSlot *freeSlots = NULL;
+static std::vector<EffectSlot *> slabs;
+static EffectPoolStats poolStats;
+
+void *Effect::operator new(size_t size)
+{
+	if (size != sizeof(Effect)) {
+		return ::operator new(size);
+	}
+	if (!freeSlots) {
+		EffectSlot *slab = (EffectSlot *) malloc(EFFECT_SLAB_SIZE * sizeof(EffectSlot));
+		if (!slab) {
+			throw std::bad_alloc();
+		}
+		for (int i = 0; i < EFFECT_SLAB_SIZE - 1; i++) {
+			slab[i].next = slab + i + 1;
+		}
+		slab[EFFECT_SLAB_SIZE - 1].next = NULL;
+		freeSlots = slab;
+		slabs.push_back(slab);
+		poolStats.Slabs++;
+	}
+	EffectSlot *slot = freeSlots;
+	freeSlots = slot->next;
+
+	poolStats.Allocations++;
+	poolStats.Live++;
+	if (poolStats.Live > poolStats.PeakLive) {
+		poolStats.PeakLive = poolStats.Live;
+	}
+	return slot;
+}
+
+void Effect::operator delete(void *ptr, size_t size)
+{
+	if (!ptr) {
+		return;
+	}
+	if (size != sizeof(Effect)) {
+		::operator delete(ptr);
+		return;
+	}
+	EffectSlot *slot = (EffectSlot *) ptr;
+	slot->next = freeSlots;
+	freeSlots = slot;
+
+	poolStats.Frees++;
+	poolStats.Live--;
+}
+
+const EffectPoolStats &Effect::GetPoolStats()
+{
+	return poolStats;
+}
+
+void Effect::ReleasePool()
+{
+	Log(DEBUG, "Effect", "Effect pool: %lu allocations in %lu slabs, at most %lu live, %lu leaked",
+		poolStats.Allocations, poolStats.Slabs, poolStats.PeakLive, poolStats.Live);
+	//leaked effects still point into the slabs
+	if (poolStats.Live) {
+		return;
+	}
+	for (size_t i = 0; i < slabs.size(); i++) {
+		free(slabs[i]);
+	}
+	slabs.clear();
+	freeSlots = NULL;
+	poolStats.Slabs = 0;
+}
+
+}
@@ -27,10 +27,13 @@
 #ifndef EFFECT_H
 #define EFFECT_H
 
+#include "exports.h"
 #include "ie_types.h"
 
 #include "Region.h"
 
+#include <cstddef>
+
 namespace GemRB {
 
 class Actor;
@@ -77,13 +80,22 @@ class Actor;
 #define SF_BYPASS_MIRROR_IMAGE 0x1000000
 #define SF_IGNORE_DIFFICULTY   0x2000000
 
+/** Allocation counters of the Effect pool */
+struct EffectPoolStats {
+	unsigned long Allocations;
+	unsigned long Frees;
+	unsigned long Live;
+	unsigned long PeakLive;
+	unsigned long Slabs;
+};
+
 /**
  * @class Effect
  * Structure holding information about single spell or spell-like effect.
  */
 
 // the same as ITMFeature and SPLFeature
-struct Effect {
+struct GEM_EXPORT Effect {
 	ieDword Opcode;
 	ieDword Target;
 	ieDword Power;
@@ -147,6 +159,13 @@ public:
 			SourceY=p.y;
 		}
 	}
+
+	/* single effects come from a recycling pool, arrays (features) don't */
+	static void *operator new(size_t size);
+	static void operator delete(void *ptr, size_t size);
+	static const EffectPoolStats &GetPoolStats();
+	/* frees the pool, unless some effects are still alive */
+	static void ReleasePool();
 };
 
 }
@@ -35,6 +35,7 @@
 #include "TableMgr.h"
 #include "System/StringBuffer.h"
 
+#include <algorithm>
 #include <cstdio>
 #include "GameData.h"
 
@@ -320,6 +321,7 @@ void EffectQueue_ReleaseMemory()
 	}
 	effectnames_count = 0;
 	effectnames = NULL;
+	Effect::ReleasePool();
 }
 
 void EffectQueue_RegisterOpcodes(int count, const EffectDesc* opcodes)
@@ -482,6 +484,100 @@ void EffectQueue::AddEffect(Effect* fx, bool insert)
 	} else {
 		effects.push_back( new_fx );
 	}
+	IndexEffect(new_fx, insert);
+}
+
+static std::string SourceKey(const char *source)
+{
+	char key[9];
+
+	strnlwrcpy(key, source, 8);
+	return key;
+}
+
+//removes fx from the bucket, dropping the bucket once it is empty
+template <class Key>
+static bool RemoveFromIndex(std::map< Key, std::vector< Effect* > > &index, const Key &key, Effect *fx)
+{
+	typename std::map< Key, std::vector< Effect* > >::iterator i = index.find(key);
+	if (i == index.end()) {
+		return false;
+	}
+	std::vector< Effect* >::iterator j = std::find(i->second.begin(), i->second.end(), fx);
+	if (j == i->second.end()) {
+		return false;
+	}
+	i->second.erase(j);
+	if (i->second.empty()) {
+		index.erase(i);
+	}
+	return true;
+}
+
+const EffectQueue::fxindex &EffectQueue::GetOpcodeIndex(ieDword opcode) const
+{
+	static const fxindex none;
+
+	std::map< ieDword, fxindex >::const_iterator i = opcodeIndex.find(opcode);
+	if (i == opcodeIndex.end()) {
+		return none;
+	}
+	return i->second;
+}
+
+const EffectQueue::fxindex &EffectQueue::GetSourceIndex(const ieResRef source) const
+{
+	static const fxindex none;
+
+	std::map< std::string, fxindex >::const_iterator i = sourceIndex.find(SourceKey(source));
+	if (i == sourceIndex.end()) {
+		return none;
+	}
+	return i->second;
+}
+
+void EffectQueue::IndexEffect(Effect *fx, bool insert)
+{
+	fxindex &byOpcode = opcodeIndex[fx->Opcode];
+	fxindex &bySource = sourceIndex[SourceKey(fx->Source)];
+	if (insert) {
+		byOpcode.insert(byOpcode.begin(), fx);
+		bySource.insert(bySource.begin(), fx);
+	} else {
+		byOpcode.push_back(fx);
+		bySource.push_back(fx);
+	}
+}
+
+void EffectQueue::UnindexEffect(Effect *fx)
+{
+	if (!RemoveFromIndex(opcodeIndex, fx->Opcode, fx)) {
+		//the opcode was changed behind our back, look everywhere
+		std::map< ieDword, fxindex >::iterator i;
+		for (i = opcodeIndex.begin(); i != opcodeIndex.end(); i++) {
+			if (RemoveFromIndex(opcodeIndex, i->first, fx)) break;
+		}
+	}
+	RemoveFromIndex(sourceIndex, SourceKey(fx->Source), fx);
+}
+
+//an effect replaced its opcode while being applied, so move it
+//to the right bucket, keeping the queue order there too
+void EffectQueue::ReindexOpcode(Effect *fx, ieDword oldOpcode) const
+{
+	if (!RemoveFromIndex(opcodeIndex, oldOpcode, fx)) {
+		//not one of ours
+		return;
+	}
+
+	fxindex &byOpcode = opcodeIndex[fx->Opcode];
+	byOpcode.clear();
+	std::list< Effect* >::const_iterator f;
+	for (f = effects.begin(); f != effects.end(); f++) {
+		if ((*f)->Opcode == fx->Opcode) {
+			byOpcode.push_back(*f);
+		}
+	}
 }
 
 //This method can remove an effect described by a pointer to it, or
@@ -494,6 +590,7 @@ bool EffectQueue::RemoveEffect(Effect* fx)
 		Effect* fx2 = *f;
 
 		if( (fx==fx2) || !memcmp( fx, fx2, invariant_size)) {
+			UnindexEffect(fx2);
 			delete fx2;
 			effects.erase( f );
 			return true;
@@ -518,12 +615,49 @@ void EffectQueue::ApplyAllEffects(Actor* target) const
 	}
 }
 
+bool EffectQueue::GetStatSignature(ieDword &signature) const
+{
+	ieDword GameTime = core->GetGame()->GameTime;
+	ieDword hash = 2166136261u;
+
+	std::list< Effect* >::const_iterator f;
+	for ( f = effects.begin(); f != effects.end(); f++ ) {
+		const Effect *fx = *f;
+		if (fx->TimingMode == FX_DURATION_JUST_EXPIRED) {
+			continue;
+		}
+		switch (DelayType(fx->TimingMode&0xff)) {
+			case DELAYED:
+				//a waiting effect does nothing until it triggers
+				if (fx->Duration <= GameTime) return false;
+				break;
+			case DURATION:
+				if (fx->Duration <= GameTime) return false;
+				//fall through
+			case PERMANENT:
+				if (fx->FirstApply || fx->Opcode >= MAX_EFFECTS) return false;
+				if ((Opcodes[fx->Opcode].Flags & (EFFECT_STAT_ONLY|EFFECT_REINIT_ON_LOAD)) != EFFECT_STAT_ONLY) return false;
+				break;
+			default:
+				return false;
+		}
+		const ieDword fields[] = { (ieDword) (size_t) fx, fx->Opcode, fx->TimingMode,
+			fx->Parameter1, fx->Parameter2, fx->Parameter3, fx->Parameter4, fx->Duration };
+		for (size_t i = 0; i < sizeof(fields)/sizeof(ieDword); i++) {
+			hash = (hash ^ fields[i]) * 16777619u;
+		}
+	}
+	signature = hash;
+	return true;
+}
+
 void EffectQueue::Cleanup()
 {
 	std::list< Effect* >::iterator f;
 
 	for ( f = effects.begin(); f != effects.end(); ) {
 		if( (*f)->TimingMode == FX_DURATION_JUST_EXPIRED) {
+			UnindexEffect(*f);
 			delete *f;
 			effects.erase(f++);
 		} else {
@@ -1290,8 +1424,15 @@ int EffectQueue::ApplyEffect(Actor* target, Effect* fx, ieDword first_apply, ieD
 			}
 		}
 
+		ieDword opcode = fx->Opcode;
 		res=fn( Owner, target, fx );
 		fx->FirstApply = 0;
+		if (fx->Opcode != opcode) {
+			ReindexOpcode(fx, opcode);
+			if (target && &target->fxqueue != this) {
+				target->fxqueue.ReindexOpcode(fx, opcode);
+			}
+		}
 
 		//if there is no owner, we assume it is the target
 		switch( res ) {
@@ -1356,8 +1497,9 @@ static inline bool IsLive(ieByte timingmode)
 //will be killed along with it
 void EffectQueue::RemoveAllEffects(ieDword opcode) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 
@@ -1391,8 +1533,9 @@ void EffectQueue::RemoveAllEffectsWithProjectile(ieDword projectile) const
 //remove effects belonging to a given spell
 void EffectQueue::RemoveAllEffects(const ieResRef Removed) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetSourceIndex(Removed);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_SOURCE();
 
@@ -1441,8 +1584,9 @@ void EffectQueue::RemoveAllEffects(const ieResRef Removed) const
 //remove effects belonging to a given spell, but only if they match timing method x
 void EffectQueue::RemoveAllEffects(const ieResRef Removed, ieByte timing) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetSourceIndex(Removed);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_TIMING();
 		MATCH_SOURCE();
 
@@ -1463,8 +1607,9 @@ void EffectQueue::RemoveAllEffects(EffectRef &effect_reference) const
 //Removes all effects with a matching resource field
 void EffectQueue::RemoveAllEffectsWithResource(ieDword opcode, const ieResRef resource) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 		MATCH_RESOURCE();
@@ -1484,8 +1629,9 @@ void EffectQueue::RemoveAllEffectsWithResource(EffectRef &effect_reference, cons
 //(works only if a higher stat means good for the target)
 void EffectQueue::RemoveAllDetrimentalEffects(ieDword opcode, ieDword current) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 		switch((*f)->Parameter2) {
@@ -1518,8 +1664,9 @@ void EffectQueue::RemoveAllDetrimentalEffects(EffectRef &effect_reference, ieDwo
 //opcode need to be removed (see removal of portrait icon)
 void EffectQueue::RemoveAllEffectsWithParam(ieDword opcode, ieDword param2) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 		MATCH_PARAM2();
@@ -1538,8 +1685,9 @@ void EffectQueue::RemoveAllEffectsWithParam(EffectRef &effect_reference, ieDword
 //Removes all effects with a matching resource field
 void EffectQueue::RemoveAllEffectsWithParamAndResource(ieDword opcode, ieDword param2, const ieResRef resource) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 		MATCH_PARAM2();
@@ -1635,8 +1783,9 @@ void EffectQueue::RemoveLevelEffects(ieResRef &Removed, ieDword level, ieDword F
 
 Effect *EffectQueue::HasOpcode(ieDword opcode) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 
@@ -1656,8 +1805,9 @@ Effect *EffectQueue::HasEffect(EffectRef &effect_reference) const
 
 Effect *EffectQueue::HasOpcodeWithParam(ieDword opcode, ieDword param2) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 		MATCH_PARAM2();
@@ -1682,8 +1832,9 @@ Effect *EffectQueue::HasEffectWithParam(EffectRef &effect_reference, ieDword par
 
 Effect *EffectQueue::HasOpcodeWithParamPair(ieDword opcode, ieDword param1, ieDword param2) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 		MATCH_PARAM2();
@@ -1710,8 +1861,9 @@ Effect *EffectQueue::HasEffectWithParamPair(EffectRef &effect_reference, ieDword
 //this could be used for stoneskins and mirror images as well
 void EffectQueue::DecreaseParam1OfEffect(ieDword opcode, ieDword amount) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 		ieDword value = (*f)->Parameter1;
@@ -1742,8 +1894,9 @@ void EffectQueue::DecreaseParam1OfEffect(EffectRef &effect_reference, ieDword am
 //returns the damage amount NOT soaked
 int EffectQueue::DecreaseParam3OfEffect(ieDword opcode, ieDword amount, ieDword param2) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 		MATCH_PARAM2();
@@ -1782,8 +1935,9 @@ static const int ids_stats[9]={IE_FACTION, IE_TEAM, IE_EA, IE_GENERAL, IE_RACE,
 int EffectQueue::BonusAgainstCreature(ieDword opcode, Actor *actor) const
 {
 	int sum = 0;
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 		if( (*f)->Parameter1) {
@@ -1832,8 +1986,9 @@ int EffectQueue::BonusAgainstCreature(EffectRef &effect_reference, Actor *actor)
 int EffectQueue::BonusForParam2(ieDword opcode, ieDword param2) const
 {
 	int sum = 0;
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 		MATCH_PARAM2();
@@ -1855,8 +2010,9 @@ int EffectQueue::MaxParam1(ieDword opcode, bool positive) const
 {
 	int max = 0;
 	ieDwordSigned param1 = 0;
-	std::list< Effect* >::const_iterator f;
-	for (f = effects.begin(); f != effects.end(); f++) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 
@@ -1879,8 +2035,9 @@ int EffectQueue::MaxParam1(EffectRef &effect_reference, bool positive) const
 
 bool EffectQueue::WeaponImmunity(ieDword opcode, int enchantment, ieDword weapontype) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 		//
@@ -1920,8 +2077,9 @@ void EffectQueue::AddWeaponEffects(EffectQueue *fxqueue, EffectRef &fx_ref) cons
 	ieDword opcode = fx_ref.opcode;
 	Point p(-1,-1);
 
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 		//
@@ -1940,8 +2098,9 @@ int EffectQueue::SumDamageReduction(EffectRef &effect_reference, ieDword weaponE
 	int remaining = 0;
 	int count = 0;
 
-	std::list< Effect* >::const_iterator f;
-	for (f = effects.begin(); f != effects.end(); f++) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 
@@ -1964,8 +2123,9 @@ int EffectQueue::SumDamageReduction(EffectRef &effect_reference, ieDword weaponE
 //useful for immunity vs spell, can't use item, etc.
 Effect *EffectQueue::HasOpcodeWithResource(ieDword opcode, const ieResRef resource) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 		MATCH_RESOURCE();
@@ -1990,8 +2150,9 @@ Effect *EffectQueue::HasEffectWithPower(EffectRef &effect_reference, ieDword pow
 
 Effect *EffectQueue::HasOpcodeWithPower(ieDword opcode, ieDword power) const
 {
-	std::list< Effect* >::const_iterator f;
-	for (f = effects.begin(); f != effects.end(); f++) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 		// NOTE: matching greater or equals!
@@ -2005,8 +2166,9 @@ Effect *EffectQueue::HasOpcodeWithPower(ieDword opcode, ieDword power) const
 //returns the first effect with source 'Removed'
 Effect *EffectQueue::HasSource(const ieResRef Removed) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetSourceIndex(Removed);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_LIVE_FX();
 		MATCH_SOURCE();
 
@@ -2018,8 +2180,9 @@ Effect *EffectQueue::HasSource(const ieResRef Removed) const
 //used in contingency/sequencer code (cannot have the same contingency twice)
 Effect *EffectQueue::HasOpcodeWithSource(ieDword opcode, const ieResRef Removed) const
 {
-	std::list< Effect* >::const_iterator f;
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		MATCH_LIVE_FX();
 		MATCH_SOURCE();
@@ -2151,9 +2314,10 @@ ieDword EffectQueue::CountEffects(ieDword opcode, ieDword param1, ieDword param2
 {
 	ieDword cnt = 0;
 
-	std::list< Effect* >::const_iterator f;
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
 
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		if( param1!=0xffffffff)
 			MATCH_PARAM1();
@@ -2169,9 +2333,10 @@ ieDword EffectQueue::CountEffects(ieDword opcode, ieDword param1, ieDword param2
 
 void EffectQueue::ModifyEffectPoint(ieDword opcode, ieDword x, ieDword y) const
 {
-	std::list< Effect* >::const_iterator f;
+	const fxindex &matches = GetOpcodeIndex(opcode);
+	fxindex::const_iterator f;
 
-	for ( f = effects.begin(); f != effects.end(); f++ ) {
+	for ( f = matches.begin(); f != matches.end(); f++ ) {
 		MATCH_OPCODE();
 		(*f)->PosX=x;
 		(*f)->PosY=y;
@@ -35,6 +35,9 @@
 
 #include <cstdlib>
 #include <list>
+#include <map>
+#include <string>
+#include <vector>
 
 namespace GemRB {
 
@@ -168,7 +171,8 @@ enum EffectFlags {
 	EFFECT_NO_ACTOR = 4,
 	EFFECT_REINIT_ON_LOAD = 8,
 	EFFECT_PRESET_TARGET = 16,
-	EFFECT_SPECIAL_UNDO = 32
+	EFFECT_SPECIAL_UNDO = 32,
+	EFFECT_STAT_ONLY = 64 //only sets target stats from its parameters, see GetStatSignature
 };
 
 /** Initializes table of available spell Effects used by all the queues. */
@@ -191,8 +195,13 @@ bool IsColorslotEffect(int opcode);
 
 class GEM_EXPORT EffectQueue {
 private:
+	typedef std::vector< Effect* > fxindex;
 	/** List of Effects applied on the Actor */
 	std::list< Effect* > effects;
+	/** The same effects grouped by opcode and by source, in queue order.
+	 * Effects changing their own opcode are moved by ApplyEffect */
+	mutable std::map< ieDword, fxindex > opcodeIndex;
+	std::map< std::string, fxindex > sourceIndex;
 	/** Actor which is target of the Effects */
 	Scriptable* Owner;
 
@@ -219,6 +228,9 @@ public:
 
 	int AddAllEffects(Actor* target, const Point &dest) const;
 	void ApplyAllEffects(Actor* target) const;
+	/* fingerprints the queue, returns false if reapplying it now could
+	 * do anything but setting the same stats as the last time */
+	bool GetStatSignature(ieDword &signature) const;
 	/** remove effects marked for removal */
 	void Cleanup();
 
@@ -335,6 +347,11 @@ private:
 	int MaxParam1(ieDword opcode, bool positive) const;
 	int BonusAgainstCreature(ieDword opcode, Actor *actor) const;
 	bool WeaponImmunity(ieDword opcode, int enchantment, ieDword weapontype) const;
+	const fxindex &GetOpcodeIndex(ieDword opcode) const;
+	const fxindex &GetSourceIndex(const ieResRef source) const;
+	void IndexEffect(Effect *fx, bool insert);
+	void UnindexEffect(Effect *fx);
+	void ReindexOpcode(Effect *fx, ieDword oldOpcode) const;
 };
 
 }
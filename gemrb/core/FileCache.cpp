@@ -22,8 +22,12 @@
 #include "Interface.h"
 #include "PluginMgr.h"
 #include "System/FileStream.h"
+#include "System/Thread.h"
 #include "System/VFS.h"
 
+#include <set>
+#include <string>
+
 namespace GemRB {
 
 DataStream* CacheCompressedStream(DataStream *stream, const char* filename, int length, bool overwrite)
@@ -54,4 +58,114 @@ DataStream* CacheCompressedStream(DataStream *stream, const char* filename, int
 	return FileStream::OpenFile(path);
 }
 
+static WorkerPool *writer = NULL;
+//files queued since the last wait, the main thread has its own bookkeeping
+//instead of asking the writer
+static std::set<std::string> pendingFiles;
+static bool pendingJobs = false;
+
+// owns the real job and itself, since nobody waits for single jobs
+class BackgroundJob : public Task {
+public:
+	BackgroundJob(Task *task)
+		: task(task)
+	{
+	}
+	void Run()
+	{
+		task->Run();
+		delete task;
+		delete this;
+	}
+private:
+	Task *task;
+};
+
+class WriteJob : public Task {
+public:
+	WriteJob(DataStream *data)
+		: data(data)
+	{
+	}
+	~WriteJob()
+	{
+		delete data;
+	}
+	void Run()
+	{
+		char buffer[8192];
+		unsigned long remains;
+
+		FileStream out;
+		if (!out.Create(data->originalfile)) {
+			Log(ERROR, "FileCache", "Cannot create %s.", data->originalfile);
+			return;
+		}
+		data->Seek(0, GEM_STREAM_START);
+		while ((remains = data->Remains())) {
+			unsigned int chunk = remains > sizeof(buffer) ? sizeof(buffer) : (unsigned int) remains;
+			if (data->Read(buffer, chunk) != (int) chunk || out.Write(buffer, chunk) != (int) chunk) {
+				Log(ERROR, "FileCache", "Cannot write %s.", data->originalfile);
+				break;
+			}
+		}
+	}
+private:
+	DataStream *data;
+};
+
+static void QueueJob(Task *task)
+{
+	if (!writer) {
+		writer = new WorkerPool(1);
+	}
+	pendingJobs = true;
+	writer->Submit(new BackgroundJob(task));
+}
+
+void WriteInBackground(DataStream *data)
+{
+	char key[_MAX_PATH];
+	strlcpy(key, data->filename, sizeof(key));
+	strlwr(key);
+	pendingFiles.insert(key);
+	QueueJob(new WriteJob(data));
+}
+
+void RunInBackground(Task *task)
+{
+	QueueJob(task);
+}
+
+void WaitForBackgroundWrite(const char *resref, const char *ext)
+{
+	//the ambient thread looks up sounds, which are never written here
+	if (!IsMainThread() || pendingFiles.empty()) {
+		return;
+	}
+	char key[_MAX_PATH];
+	snprintf(key, sizeof(key), "%s.%s", resref, ext);
+	strlwr(key);
+	if (pendingFiles.find(key) != pendingFiles.end()) {
+		WaitForBackgroundWrites();
+	}
+}
+
+void WaitForBackgroundWrites()
+{
+	if (!pendingJobs) {
+		return;
+	}
+	writer->Wait();
+	pendingJobs = false;
+	pendingFiles.clear();
+}
+
+void ShutdownBackgroundWriter()
+{
+	WaitForBackgroundWrites();
+	delete writer;
+	writer = NULL;
+}
+
 }
@@ -23,8 +23,27 @@
 
 namespace GemRB {
 
+class Task;
+
 GEM_EXPORT DataStream* CacheCompressedStream(DataStream *stream, const char* filename, int length = 0, bool overwrite = false);
 
+/* The background writer runs its jobs one by one in the order they were
+ * queued. Only the main thread may use these. */
+
+/** Writes the content of data in the background to the file at its
+ * originalfile, then deletes it. The file is only created then, so the
+ * jobs queued before still see the old one. */
+GEM_EXPORT void WriteInBackground(DataStream *data);
+/** Runs the task in the background after the queued writes, then deletes it. */
+GEM_EXPORT void RunInBackground(Task *task);
+/** Waits for the background jobs if the file is still queued for writing.
+ * Does nothing on other threads, so resource lookups may call it anywhere. */
+GEM_EXPORT void WaitForBackgroundWrite(const char *resref, const char *ext);
+/** Waits until all the queued background jobs are done. */
+GEM_EXPORT void WaitForBackgroundWrites();
+/** Finishes the queued background jobs and stops the writer thread. */
+GEM_EXPORT void ShutdownBackgroundWriter();
+
 }
 
 #endif
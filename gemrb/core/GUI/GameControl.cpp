@@ -505,16 +505,15 @@ void GameControl::DrawInternal(Region& screen)
 		Actor *actor = area->GetActorByGlobalID(trackerID);
 
 		if (actor) {
-			Actor **monsters = area->GetAllActorsInRadius(actor->Pos, GA_NO_DEAD|GA_NO_LOS|GA_NO_UNSCHEDULED, distance);
+			std::vector<Actor*> monsters;
+			area->GetAllActorsInRadius(monsters, actor->Pos, GA_NO_DEAD|GA_NO_LOS|GA_NO_UNSCHEDULED, distance);
 
-			int i = 0;
-			while(monsters[i]) {
-				Actor *target = monsters[i++];
+			for (size_t i = 0; i < monsters.size(); i++) {
+				Actor *target = monsters[i];
 				if (target->InParty) continue;
 				if (target->GetStat(IE_NOTRACKING)) continue;
 				DrawArrowMarker(screen, target->Pos, viewport, ColorBlack);
 			}
-			free(monsters);
 		} else {
 			trackerID = 0;
 		}
@@ -1923,7 +1922,7 @@ void GameControl::OnMouseUp(unsigned short x, unsigned short y, unsigned short B
 	if (!area) return;
 
 	if (DrawSelectionRect) {
-		Actor** ab;
+		std::vector<Actor*> ab;
 		unsigned int count = area->GetActorInRect( ab, SelectionRect,true );
 		if (count != 0) {
 			for (i = 0; i < highlighted.size(); i++)
@@ -1935,7 +1934,6 @@ void GameControl::OnMouseUp(unsigned short x, unsigned short y, unsigned short B
 				game->SelectActor( ab[i], true, SELECT_NORMAL );
 			}
 		}
-		free( ab );
 		DrawSelectionRect = false;
 		return;
 	}
@@ -2301,7 +2299,7 @@ void GameControl::CalculateSelection(const Point &p)
 			SelectionRect.y = ClickPoint.y;
 			SelectionRect.h = p.y - ClickPoint.y;
 		}
-		Actor** ab;
+		std::vector<Actor*> ab;
 		unsigned int count = area->GetActorInRect( ab, SelectionRect,true );
 		for (i = 0; i < highlighted.size(); i++)
 			highlighted[i]->SetOver( false );
@@ -2312,7 +2310,6 @@ void GameControl::CalculateSelection(const Point &p)
 				highlighted.push_back( ab[i] );
 			}
 		}
-		free( ab );
 	} else {
 		Actor* actor = area->GetActor( p, GA_DEFAULT | GA_SELECT | GA_NO_DEAD | GA_NO_ENEMY);
 		SetLastActor( actor, area->GetActorByGlobalID(lastActorID) );
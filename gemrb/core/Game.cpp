@@ -964,6 +964,12 @@ int Game::LoadMap(const char* ResRef, bool loadscreen)
 		core->GetAudioDrv()->UpdateMapAmbient(*newMap->reverb);
 	}
 
+	//so the first fight doesn't wait for the sounds to be decoded
+	i = newMap->GetActorCount(true);
+	while (i--) {
+		newMap->GetActor(i, true)->PrefetchSounds();
+	}
+
 	return ret;
 failedload:
 	if (hide) {
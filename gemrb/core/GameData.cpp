@@ -29,6 +29,7 @@
 #include "Effect.h"
 #include "EffectMgr.h"
 #include "Factory.h"
+#include "FileCache.h"
 #include "Game.h"
 #include "ImageFactory.h"
 #include "ImageMgr.h"
@@ -552,6 +553,8 @@ void GameData::SaveStore(Store* store)
 		error("GameData", "Can't save store to cache.");
 	}
 
+	//a save may still be reading the cache in the background
+	WaitForBackgroundWrites();
 	FileStream str;
 
 	if (!str.Create(store->Name, IE_STO_CLASS_ID)) {
@@ -65,6 +65,9 @@ TriggerFunction triggers[MAX_TRIGGERS];
 ActionFunction actions[MAX_ACTIONS];
 short actionflags[MAX_ACTIONS];
 short triggerflags[MAX_TRIGGERS];
+//the ids entries, looked up once in InitializeIEScript
+const char *triggerNames[MAX_TRIGGERS];
+const char *actionNames[MAX_ACTIONS];
 ObjectFunction objects[MAX_OBJECTS];
 IDSFunction idtargets[MAX_OBJECT_FIELDS];
 Cache SrcCache; //cache for string resources (pst)
@@ -2132,6 +2135,12 @@ void SetVariable(Scriptable* Sender, const char* VarName, ieDword value)
 }
 
 ieDword CheckVariable(Scriptable* Sender, const char* VarName, bool *valid)
+{
+	unsigned int hash = 0;
+	return CheckVariable(Sender, VarName, valid, hash);
+}
+
+ieDword CheckVariable(Scriptable* Sender, const char* VarName, bool *valid, unsigned int &hash)
 {
 	char newVarName[8];
 	const char *poi;
@@ -2143,16 +2152,19 @@ ieDword CheckVariable(Scriptable* Sender, const char* VarName, bool *valid)
 	if (*poi==':') {
 		poi++;
 	}
+	if (!hash) {
+		hash = Variables::HashKey( poi );
+	}
 
 	if (stricmp( newVarName, "MYAREA" ) == 0) {
-		Sender->GetCurrentArea()->locals->Lookup( poi, value );
+		Sender->GetCurrentArea()->locals->Lookup( poi, hash, value );
 		if (InDebug&ID_VARIABLES) {
 			print("CheckVariable %s: %d", VarName, value);
 		}
 		return value;
 	}
 	if (stricmp( newVarName, "LOCALS" ) == 0) {
-		Sender->locals->Lookup( poi, value );
+		Sender->locals->Lookup( poi, hash, value );
 		if (InDebug&ID_VARIABLES) {
 			print("CheckVariable %s: %d", VarName, value);
 		}
@@ -2160,7 +2172,7 @@ ieDword CheckVariable(Scriptable* Sender, const char* VarName, bool *valid)
 	}
 	Game *game = core->GetGame();
 	if (HasKaputz && !stricmp(newVarName,"KAPUTZ") ) {
-		game->kaputz->Lookup( poi, value );
+		game->kaputz->Lookup( poi, hash, value );
 		if (InDebug&ID_VARIABLES) {
 			print("CheckVariable %s: %d", VarName, value);
 		}
@@ -2169,7 +2181,7 @@ ieDword CheckVariable(Scriptable* Sender, const char* VarName, bool *valid)
 	if (stricmp(newVarName,"GLOBAL") ) {
 		Map *map=game->GetMap(game->FindMap(newVarName));
 		if (map) {
-			map->locals->Lookup( poi, value);
+			map->locals->Lookup( poi, hash, value);
 		} else {
 			if (valid) {
 				*valid=false;
@@ -2180,7 +2192,7 @@ ieDword CheckVariable(Scriptable* Sender, const char* VarName, bool *valid)
 			}
 		}
 	} else {
-		game->locals->Lookup( poi, value );
+		game->locals->Lookup( poi, hash, value );
 	}
 	if (InDebug&ID_VARIABLES) {
 		print("CheckVariable %s: %d", VarName, value);
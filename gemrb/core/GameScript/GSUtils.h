@@ -36,6 +36,7 @@ namespace GemRB {
 #define ID_VARIABLES 4
 #define ID_ACTIONS   8
 #define ID_TRIGGERS  16
+#define ID_PROFILE   32 //count script blocks, triggers and actions and their time, see DumpScriptProfile
 
 //whoseeswho for GetNearestEnemy:
 #define ENEMY_SEES_ORIGIN 1
@@ -50,6 +51,8 @@ extern TriggerFunction triggers[MAX_TRIGGERS];
 extern ActionFunction actions[MAX_ACTIONS];
 extern short actionflags[MAX_ACTIONS];
 extern short triggerflags[MAX_TRIGGERS];
+extern const char *triggerNames[MAX_TRIGGERS];
+extern const char *actionNames[MAX_ACTIONS];
 extern ObjectFunction objects[MAX_OBJECTS];
 extern IDSFunction idtargets[MAX_OBJECT_FIELDS];
 extern Cache SrcCache; //cache for string resources (pst)
@@ -134,6 +137,8 @@ GEM_EXPORT void SetVariable(Scriptable* Sender, const char* VarName, const char*
 bool CreateMovementEffect(Actor* actor, const char *area, const Point &position, int face);
 GEM_EXPORT void MoveBetweenAreasCore(Actor* actor, const char *area, const Point &position, int face, bool adjust);
 GEM_EXPORT ieDword CheckVariable(Scriptable* Sender, const char* VarName, bool *valid = NULL);
+//the same, hash caches the Variables::HashKey of the name without the scope (0 if not known yet)
+GEM_EXPORT ieDword CheckVariable(Scriptable* Sender, const char* VarName, bool *valid, unsigned int &hash);
 GEM_EXPORT ieDword CheckVariable(Scriptable* Sender, const char* VarName, const char* Context, bool *valid = NULL);
 GEM_EXPORT bool VariableExists(Scriptable *Sender, const char *VarName, const char *Context);
 Action* GenerateActionCore(const char *src, const char *str, unsigned short actionID);
@@ -31,8 +31,12 @@
 #include "PluginMgr.h"
 #include "TableMgr.h"
 #include "RNG/RNG_SFMT.h"
+#include "System/FileStream.h"
 #include "System/StringBuffer.h"
 
+#include <algorithm>
+#include <map>
+
 namespace GemRB {
 
 //debug flags
@@ -1223,6 +1227,35 @@ void SetScriptDebugMode(int arg)
 
 /********************** Targets **********************************/
 
+//the buffers of deleted Targets, since they are created for every object evaluation
+static std::vector<targetlist> targetsPool;
+
+Targets::Targets()
+{
+	if (!targetsPool.empty()) {
+		objects.swap(targetsPool.back());
+		targetsPool.pop_back();
+	}
+}
+
+Targets::Targets(const Targets &other)
+{
+	if (!targetsPool.empty()) {
+		objects.swap(targetsPool.back());
+		targetsPool.pop_back();
+	}
+	objects = other.objects;
+}
+
+Targets::~Targets()
+{
+	if (objects.capacity() && targetsPool.size() < TARGETS_POOL) {
+		objects.clear();
+		targetsPool.push_back(targetlist());
+		targetsPool.back().swap(objects);
+	}
+}
+
 int Targets::Count() const
 {
 	return (int)objects.size();
@@ -1239,10 +1272,10 @@ targettype *Targets::RemoveTargetAt(targetlist::iterator &m)
 
 const targettype *Targets::GetLastTarget(int Type)
 {
-	targetlist::const_iterator m = objects.end();
-	while (m--!=objects.begin() ) {
-		if ( (Type==-1) || ((*m).actor->Type==Type) ) {
-			return &(*(m));
+	size_t i = objects.size();
+	while (i--) {
+		if ( (Type==-1) || (objects[i].actor->Type==Type) ) {
+			return &objects[i];
 		}
 	}
 	return NULL;
@@ -1276,6 +1309,10 @@ const targettype *Targets::GetNextTarget(targetlist::iterator &m, int Type)
 
 Scriptable *Targets::GetTarget(unsigned int index, int Type)
 {
+	//the list is sorted, so the nth target is simply there
+	if (Type == -1) {
+		return index < objects.size() ? objects[index].actor : NULL;
+	}
 	targetlist::iterator m = objects.begin();
 	while(m!=objects.end() ) {
 		if ( (Type==-1) || ((*m).actor->Type==Type)) {
@@ -1289,6 +1326,11 @@ Scriptable *Targets::GetTarget(unsigned int index, int Type)
 	return NULL;
 }
 
+static bool CloserThan(const targettype &a, const targettype &b)
+{
+	return a.distance < b.distance;
+}
+
 //this stuff should be refined, dead actors are sometimes targetable by script?
 void Targets::AddTarget(Scriptable* target, unsigned int distance, int ga_flags)
 {
@@ -1313,14 +1355,8 @@ void Targets::AddTarget(Scriptable* target, unsigned int distance, int ga_flags)
 		break;
 	}
 	targettype Target = {target, distance};
-	targetlist::iterator m;
-	for (m = objects.begin(); m != objects.end(); ++m) {
-		if ( (*m).distance>distance) {
-			objects.insert( m, Target);
-			return;
-		}
-	}
-	objects.push_back( Target );
+	//after the targets at the same distance, like they were found
+	objects.insert(std::upper_bound(objects.begin(), objects.end(), Target, CloserThan), Target);
 }
 
 void Targets::Clear()
@@ -1342,6 +1378,16 @@ void Targets::dump() const
 /** releasing global memory */
 static void CleanupIEScript()
 {
+	if (InDebug&ID_PROFILE) {
+		char path[_MAX_PATH];
+		//not in the game data, which may not even be writable
+		PathJoin(path, core->SavePath, "gemrb-scriptprofile.csv", NULL);
+		WriteScriptProfile(path);
+		DumpScriptProfile(true);
+	}
+	//the names point into the tables
+	memset(triggerNames, 0, sizeof(triggerNames));
+	memset(actionNames, 0, sizeof(actionNames));
 	triggersTable.release();
 	actionsTable.release();
 	objectsTable.release();
@@ -1786,6 +1832,17 @@ void InitializeIEScript()
 			triggerflags[i] |= TF_SAVED;
 		}
 	}
+
+	//resolve the names for the debug output once, instead of per call
+	for (i = 0; i < MAX_TRIGGERS; i++) {
+		triggerNames[i] = triggersTable->GetValue(i);
+		if (!triggerNames[i]) {
+			triggerNames[i] = triggersTable->GetValue(i|0x4000);
+		}
+	}
+	for (i = 0; i < MAX_ACTIONS; i++) {
+		actionNames[i] = actionsTable->GetValue(i);
+	}
 }
 
 /********************** GameScript *******************************/
@@ -1799,6 +1856,10 @@ GameScript::GameScript(const ieResRef ResRef, Scriptable* MySelf,
 	strnlwrcpy( Name, ResRef, 8 );
 
 	script = CacheScript( Name, AIScript);
+	if (script) {
+		BlockMemo none = { 0, 0 };
+		memos.resize(script->blocks.size(), none);
+	}
 }
 
 GameScript::~GameScript(void)
@@ -1860,9 +1921,469 @@ Script* GameScript::CacheScript(ieResRef ResRef, bool AIScript)
 		stream->ReadLine( line, 10 );
 	}
 	delete( stream );
+	newScript->Compile();
 	return newScript;
 }
 
+static const char* GetTriggerName(unsigned short triggerID)
+{
+	if (triggerID >= MAX_TRIGGERS) {
+		return NULL;
+	}
+	return triggerNames[triggerID];
+}
+
+/********************** Profiling *******************************/
+
+#define PROFILE_BLOCK    0 //conditions of a block, hits are the true ones
+#define PROFILE_RESPONSE 1 //the chosen response of a block
+#define PROFILE_TRIGGER  2
+#define PROFILE_ACTION   3
+
+static const char *profileKinds[] = { "block", "response", "trigger", "action" };
+
+struct ScriptProfileKey {
+	ieResRef script;
+	int block;
+	int kind;
+	int id;
+
+	bool operator<(const ScriptProfileKey &other) const
+	{
+		int cmp = strcmp(script, other.script);
+		if (cmp) return cmp < 0;
+		if (block != other.block) return block < other.block;
+		if (kind != other.kind) return kind < other.kind;
+		return id < other.id;
+	}
+};
+
+struct ScriptProfileEntry {
+	unsigned long calls;
+	unsigned long hits;
+	unsigned long usecs;
+};
+
+typedef std::map<ScriptProfileKey, ScriptProfileEntry> ScriptProfile;
+static ScriptProfile scriptProfile;
+
+//the script block being run, actions executed outside of any
+//(from the action queue) are only counted per action
+static const char *profileScript = "";
+static int profileBlock = -1;
+
+static void RecordProfile(int kind, int id, unsigned long usecs, bool hit)
+{
+	ScriptProfileKey key;
+	strnlwrcpy(key.script, profileScript, 8);
+	key.block = profileBlock;
+	key.kind = kind;
+	key.id = id;
+
+	ScriptProfileEntry &entry = scriptProfile[key];
+	entry.calls++;
+	if (hit) entry.hits++;
+	entry.usecs += usecs;
+}
+
+/* times its own lifetime, if profiling is on; with a script it also
+ * makes its block the current one until then */
+class ProfileTimer {
+public:
+	ProfileTimer(const char *script, int block, int kind, int id)
+	{
+		active = (InDebug&ID_PROFILE) != 0;
+		hit = true;
+		if (!active) return;
+
+		this->kind = kind;
+		this->id = id;
+		oldScript = profileScript;
+		oldBlock = profileBlock;
+		if (script) {
+			profileScript = script;
+			profileBlock = block;
+		}
+		start = GetMicroTicks();
+	}
+	~ProfileTimer()
+	{
+		if (!active) return;
+
+		RecordProfile(kind, id, GetMicroTicks() - start, hit);
+		profileScript = oldScript;
+		profileBlock = oldBlock;
+	}
+	bool hit;
+private:
+	bool active;
+	int kind, id;
+	const char *oldScript;
+	int oldBlock;
+	unsigned long start;
+};
+
+static inline int CallTrigger(TriggerFunction func, Scriptable* Sender, Trigger* tR)
+{
+	if (!(InDebug&ID_PROFILE) || tR->triggerID >= MAX_TRIGGERS) {
+		return func(Sender, tR);
+	}
+	unsigned long start = GetMicroTicks();
+	int ret = func(Sender, tR);
+	RecordProfile(PROFILE_TRIGGER, tR->triggerID, GetMicroTicks() - start, ret != 0);
+	return ret;
+}
+
+//the name of the trigger or action without its parameters
+static std::string GetProfileName(int kind, int id)
+{
+	const char *name = NULL;
+	if (kind == PROFILE_TRIGGER) {
+		name = GetTriggerName(id);
+	} else if (kind == PROFILE_ACTION && id < MAX_ACTIONS) {
+		name = actionNames[id];
+	}
+	if (!name) {
+		return "";
+	}
+	const char *end = strchr(name, '(');
+	return std::string(name, end ? end - name : strlen(name));
+}
+
+static bool CostlierEntry(const ScriptProfile::const_iterator &a, const ScriptProfile::const_iterator &b)
+{
+	return a->second.usecs > b->second.usecs;
+}
+
+void DumpScriptProfile(bool reset)
+{
+	std::vector<ScriptProfile::const_iterator> blocks;
+	ScriptProfile::const_iterator i;
+	for (i = scriptProfile.begin(); i != scriptProfile.end(); i++) {
+		if (i->first.kind == PROFILE_BLOCK || i->first.kind == PROFILE_RESPONSE) {
+			blocks.push_back(i);
+		}
+	}
+	std::sort(blocks.begin(), blocks.end(), CostlierEntry);
+	if (blocks.size() > 50) {
+		blocks.resize(50);
+	}
+
+	StringBuffer buffer;
+	buffer.append("Costliest script blocks (calls, hits, total usecs):\n");
+	for (size_t j = 0; j < blocks.size(); j++) {
+		const ScriptProfileKey &key = blocks[j]->first;
+		const ScriptProfileEntry &entry = blocks[j]->second;
+		buffer.appendFormatted("%s:%d %s: %lu %lu %lu\n", key.script, key.block,
+			profileKinds[key.kind], entry.calls, entry.hits, entry.usecs);
+	}
+	Log(MESSAGE, "GameScript", buffer);
+	DumpTriggerProfile(reset);
+	if (reset) {
+		scriptProfile.clear();
+	}
+}
+
+bool WriteScriptProfile(const char *path)
+{
+	FileStream fs;
+	if (!fs.Create(path)) {
+		return false;
+	}
+
+	StringBuffer buffer;
+	buffer.append("script,block,kind,id,name,calls,hits,usecs\n");
+	ScriptProfile::const_iterator i;
+	for (i = scriptProfile.begin(); i != scriptProfile.end(); i++) {
+		const ScriptProfileKey &key = i->first;
+		const ScriptProfileEntry &entry = i->second;
+		buffer.appendFormatted("%s,%d,%s,%d,%s,%lu,%lu,%lu\n", key.script, key.block,
+			profileKinds[key.kind], key.id, GetProfileName(key.kind, key.id).c_str(),
+			entry.calls, entry.hits, entry.usecs);
+	}
+	const std::string &csv = buffer.get();
+	return fs.Write(csv.c_str(), (unsigned int) csv.size()) == (int) csv.size();
+}
+
+struct TriggerCost {
+	int id;
+	ScriptProfileEntry entry;
+};
+
+static bool CostlierTrigger(const TriggerCost &a, const TriggerCost &b)
+{
+	return a.entry.usecs > b.entry.usecs;
+}
+
+//sums up the trigger entries of all the script blocks per trigger
+void DumpTriggerProfile(bool reset)
+{
+	std::vector<TriggerCost> costs;
+	std::map<int, size_t> index;
+	ScriptProfile::iterator i = scriptProfile.begin();
+	while (i != scriptProfile.end()) {
+		if (i->first.kind != PROFILE_TRIGGER) {
+			i++;
+			continue;
+		}
+		std::map<int, size_t>::iterator found = index.find(i->first.id);
+		if (found == index.end()) {
+			TriggerCost cost;
+			cost.id = i->first.id;
+			cost.entry = i->second;
+			index[cost.id] = costs.size();
+			costs.push_back(cost);
+		} else {
+			ScriptProfileEntry &entry = costs[found->second].entry;
+			entry.calls += i->second.calls;
+			entry.hits += i->second.hits;
+			entry.usecs += i->second.usecs;
+		}
+		if (reset) {
+			scriptProfile.erase(i++);
+		} else {
+			i++;
+		}
+	}
+	std::sort(costs.begin(), costs.end(), CostlierTrigger);
+
+	StringBuffer buffer;
+	buffer.append("Trigger profile (calls, total usecs, usecs per call):\n");
+	for (size_t j = 0; j < costs.size(); j++) {
+		const ScriptProfileEntry &entry = costs[j].entry;
+		const char *name = GetTriggerName(costs[j].id);
+		buffer.appendFormatted("0x%04x %s: %lu %lu %.2f\n", costs[j].id, name ? name : "?",
+			entry.calls, entry.usecs, (double) entry.usecs / entry.calls);
+	}
+	Log(MESSAGE, "GameScript", buffer);
+}
+
+//triggers that only read variables; the ones with a context in
+//their string parameters only count for GLOBAL and LOCALS
+static const struct {
+	TriggerFunction func;
+	int contexts; //1 - string0Parameter, 2 - string1Parameter
+} variableTriggers[] = {
+	{ GameScript::BitCheck, 1 },
+	{ GameScript::BitCheckExact, 1 },
+	{ GameScript::BitGlobal_Trigger, 1 },
+	{ GameScript::G_Trigger, 0 },
+	{ GameScript::GGT_Trigger, 0 },
+	{ GameScript::GLT_Trigger, 0 },
+	{ GameScript::Global, 1 },
+	{ GameScript::GlobalAndGlobal_Trigger, 3 },
+	{ GameScript::GlobalBAndGlobal_Trigger, 3 },
+	{ GameScript::GlobalBAndGlobalExact, 3 },
+	{ GameScript::GlobalBitGlobal_Trigger, 3 },
+	{ GameScript::GlobalGT, 1 },
+	{ GameScript::GlobalGTGlobal, 3 },
+	{ GameScript::GlobalLT, 1 },
+	{ GameScript::GlobalLTGlobal, 3 },
+	{ GameScript::GlobalOrGlobal_Trigger, 3 },
+	{ GameScript::GlobalsEqual, 0 },
+	{ GameScript::GlobalsGT, 0 },
+	{ GameScript::GlobalsLT, 0 },
+	{ GameScript::LocalsEqual, 0 },
+	{ GameScript::LocalsGT, 0 },
+	{ GameScript::LocalsLT, 0 },
+	{ GameScript::Xor, 1 },
+	{ NULL, 0 }
+};
+
+//triggers that only look for an entry in the trigger list
+static const TriggerFunction eventTriggers[] = {
+	GameScript::AttackedBy, GameScript::BecameVisible, GameScript::Clicked,
+	GameScript::Closed, GameScript::Detected, GameScript::Die, GameScript::Died,
+	GameScript::Disarmed, GameScript::DisarmFailed, GameScript::Entered,
+	GameScript::HarmlessClosed, GameScript::HarmlessEntered,
+	GameScript::HarmlessOpened, GameScript::Heard, GameScript::Help_Trigger,
+	GameScript::HitBy, GameScript::HotKey, GameScript::Joins, GameScript::Killed,
+	GameScript::Leaves, GameScript::NamelessBitTheDust, GameScript::OnCreation,
+	GameScript::OpenFailed, GameScript::Opened, GameScript::PartyMemberDied,
+	GameScript::PartyRested, GameScript::PickLockFailed,
+	GameScript::PickpocketFailed, GameScript::ReceivedOrder,
+	GameScript::SpellCast, GameScript::SpellCastInnate,
+	GameScript::SpellCastOnMe, GameScript::SpellCastPriest,
+	GameScript::StealFailed, GameScript::TookDamage, GameScript::TrapTriggered,
+	GameScript::TriggerTrigger, GameScript::TurnedBy, GameScript::Unlocked,
+	GameScript::WalkedToTrigger, GameScript::WasInDialog, NULL
+};
+
+static bool IsTrackedContext(const char *var)
+{
+	return !strnicmp(var, "GLOBAL", 6) || !strnicmp(var, "LOCALS", 6);
+}
+
+//what a false result of the trigger depends on
+static unsigned char GetTriggerDepends(TriggerFunction func, const Trigger *tR, bool negate)
+{
+	int i;
+
+	if (func == GameScript::True || func == GameScript::False) {
+		return TD_CONSTANT;
+	}
+	for (i = 0; variableTriggers[i].func; i++) {
+		if (variableTriggers[i].func != func) continue;
+		int contexts = variableTriggers[i].contexts;
+		if ((contexts & 1) && !IsTrackedContext(tR->string0Parameter)) {
+			return TD_VOLATILE;
+		}
+		if ((contexts & 2) && !IsTrackedContext(tR->string1Parameter)) {
+			return TD_VOLATILE;
+		}
+		return TD_VARIABLES;
+	}
+	//a negated one fails because there is an entry
+	if (negate) {
+		return TD_VOLATILE;
+	}
+	for (i = 0; eventTriggers[i]; i++) {
+		if (eventTriggers[i] == func) {
+			return TD_EVENTS;
+		}
+	}
+	return TD_VOLATILE;
+}
+
+//moves the triggers of all the blocks into one array and resolves their
+//functions, so evaluating the script walks memory in order
+void Script::Compile()
+{
+	size_t count = 0;
+	size_t a, i;
+
+	for (a = 0; a < responseBlocks.size(); a++) {
+		Condition* cO = responseBlocks[a]->condition;
+		if (cO) count += cO->triggers.size();
+	}
+	if (count) {
+		triggerPool = new Trigger[count];
+	}
+	code.resize(count);
+	blocks.resize(responseBlocks.size());
+
+	unsigned int pc = 0;
+	for (a = 0; a < responseBlocks.size(); a++) {
+		ResponseBlock* rB = responseBlocks[a];
+		blocks[a].first = pc;
+		blocks[a].count = 0;
+		if (!rB->condition) continue;
+
+		std::vector<Trigger*> &triggers = rB->condition->triggers;
+		for (i = 0; i < triggers.size(); i++) {
+			Trigger* src = triggers[i];
+			Trigger* tR = triggerPool + pc;
+			tR->triggerID = src->triggerID;
+			tR->int0Parameter = src->int0Parameter;
+			tR->flags = src->flags;
+			tR->int1Parameter = src->int1Parameter;
+			tR->int2Parameter = src->int2Parameter;
+			tR->pointParameter = src->pointParameter;
+			memcpy(tR->string0Parameter, src->string0Parameter, sizeof(tR->string0Parameter));
+			memcpy(tR->string1Parameter, src->string1Parameter, sizeof(tR->string1Parameter));
+			tR->objectParameter = src->objectParameter;
+			src->objectParameter = NULL;
+
+			TriggerOp &op = code[pc++];
+			op.trigger = tR;
+			op.func = tR->GetFunction();
+			op.negate = (tR->flags & TF_NEGATE) != 0;
+			op.depends = GetTriggerDepends(op.func, tR, op.negate);
+			op.orCount = 0;
+			if (op.func == GameScript::Or && !op.negate) {
+				op.func = NULL;
+				op.orCount = tR->int0Parameter;
+			}
+		}
+		blocks[a].count = pc - blocks[a].first;
+		//the tree is not needed anymore
+		rB->condition->Release();
+		rB->condition = NULL;
+	}
+}
+
+//the same as Condition::Evaluate, on the compiled triggers
+//if the block failed on a trigger, and neither it nor anything before it
+//can have changed, the block is known to fail again without evaluating it
+bool Script::EvaluateBlock(unsigned int block, Scriptable* Sender, BlockMemo& memo) const
+{
+	if (memo.op) {
+		switch (code[memo.op - 1].depends) {
+			case TD_CONSTANT:
+				return false;
+			case TD_VARIABLES:
+				if (memo.changes == Variables::GetChanges()) return false;
+				break;
+			case TD_EVENTS:
+				if (!Sender->HasTriggers()) return false;
+				break;
+		}
+		memo.op = 0;
+	}
+
+	int ORcount = 0;
+	unsigned int result = 0;
+	bool subresult = true;
+	//all triggers so far were tracked ones
+	bool tracked = true;
+
+	const TriggerOp* op = &code[0] + blocks[block].first;
+	const TriggerOp* end = op + blocks[block].count;
+	for (; op != end; op++) {
+		if (op->depends == TD_VOLATILE) {
+			tracked = false;
+		}
+		//do not evaluate triggers in an Or() block if one of them
+		//was already True()
+		if (!ORcount || !subresult) {
+			if (!op->func) {
+				result = op->orCount;
+			} else {
+				if (InDebug&ID_TRIGGERS) {
+					Log(WARNING, "GameScript", "Executing trigger code: 0x%04x %s",
+						op->trigger->triggerID, GetTriggerName(op->trigger->triggerID));
+				}
+				result = CallTrigger(op->func, Sender, op->trigger);
+				if (op->negate) {
+					result = !result;
+				}
+			}
+		}
+		if (result > 1) {
+			//we started an Or() block
+			if (ORcount) {
+				Log(WARNING, "GameScript", "Unfinished OR block encountered!");
+				if (!subresult) {
+					return false;
+				}
+			}
+			ORcount = result;
+			subresult = false;
+			tracked = false;
+			continue;
+		}
+		if (ORcount) {
+			subresult |= ( result != 0 );
+			if (--ORcount) {
+				continue;
+			}
+			result = subresult;
+		}
+		if (!result) {
+			if (tracked) {
+				memo.op = (unsigned int) (op - &code[0]) + 1;
+				memo.changes = Variables::GetChanges();
+			}
+			return false;
+		}
+	}
+	if (ORcount) {
+		Log(WARNING, "GameScript", "Unfinished OR block encountered!");
+		return subresult;
+	}
+	return true;
+}
+
 static int ParseInt(const char*& src)
 {
 	char number[33];
@@ -2000,6 +2521,23 @@ static Condition* ReadCondition(DataStream* stream)
  * (should start false and be passed to next script's Update),
  * and done is set to whether we processed a block without Continue()
  */
+//the triggers of a script pass share the object lookups
+class ObjectMemoScope {
+public:
+	ObjectMemoScope() { BeginObjectMemo(); }
+	~ObjectMemoScope() { EndObjectMemo(); }
+};
+
+//immediate actions change the game state, so they and the blocks evaluated
+//after them have to look their objects up afresh
+class ObjectMemoPause {
+public:
+	ObjectMemoPause() { depth = SuspendObjectMemo(); }
+	~ObjectMemoPause() { ResumeObjectMemo(depth); }
+private:
+	int depth;
+};
+
 bool GameScript::Update(bool *continuing, bool *done)
 {
 	if (!MySelf)
@@ -2016,9 +2554,16 @@ bool GameScript::Update(bool *continuing, bool *done)
 	if (continuing) continueExecution = *continuing;
 
 	RandomNumValue=RNG_SFMT::getInstance()->rand();
+	ObjectMemoScope memoScope;
 	for (size_t a = 0; a < script->responseBlocks.size(); a++) {
 		ResponseBlock* rB = script->responseBlocks[a];
-		if (rB->condition->Evaluate(MySelf)) {
+		bool matched;
+		{
+			ProfileTimer timer(Name, (int) a, PROFILE_BLOCK, 0);
+			matched = script->EvaluateBlock((unsigned int) a, MySelf, memos[a]);
+			timer.hit = matched;
+		}
+		if (matched) {
 			//if this isn't a continue-d block, we have to clear the queue
 			//we cannot clear the queue and cannot execute the new block
 			//if we already have stuff on the queue!
@@ -2047,7 +2592,11 @@ bool GameScript::Update(bool *continuing, bool *done)
 				}
 				lastAction=a;
 			}
-			continueExecution = ( rB->responseSet->Execute(MySelf) != 0);
+			{
+				ObjectMemoPause memoPause;
+				ProfileTimer timer(Name, (int) a, PROFILE_RESPONSE, 0);
+				continueExecution = ( rB->responseSet->Execute(MySelf) != 0);
+			}
 			if (continuing) *continuing = continueExecution;
 			if (!continueExecution) {
 				if (done) *done = true;
@@ -2271,6 +2820,22 @@ bool Condition::Evaluate(Scriptable* Sender)
 	return 1;
 }
 
+//returns the function of the trigger, unhandled ones become False
+TriggerFunction Trigger::GetFunction() const
+{
+	if (triggerID >= MAX_TRIGGERS) {
+		Log(ERROR, "GameScript", "Corrupted (too high) trigger code: %d", triggerID);
+		return GameScript::False;
+	}
+	TriggerFunction func = triggers[triggerID];
+	if (!func) {
+		triggers[triggerID] = func = GameScript::False;
+		Log(WARNING, "GameScript", "Unhandled trigger code: 0x%04x %s",
+			triggerID, GetTriggerName(triggerID) );
+	}
+	return func;
+}
+
 /* this may return more than a boolean, in case of Or(x) */
 int Trigger::Evaluate(Scriptable* Sender)
 {
@@ -2279,21 +2844,17 @@ int Trigger::Evaluate(Scriptable* Sender)
 		return 0;
 	}
 	TriggerFunction func = triggers[triggerID];
-	const char *tmpstr=triggersTable->GetValue(triggerID);
-	if (!tmpstr) {
-		tmpstr=triggersTable->GetValue(triggerID|0x4000);
-	}
 	if (!func) {
 		triggers[triggerID] = GameScript::False;
 		Log(WARNING, "GameScript", "Unhandled trigger code: 0x%04x %s",
-			triggerID, tmpstr );
+			triggerID, GetTriggerName(triggerID) );
 		return 0;
 	}
 	if (InDebug&ID_TRIGGERS) {
 		Log(WARNING, "GameScript", "Executing trigger code: 0x%04x %s",
-				triggerID, tmpstr );
+				triggerID, GetTriggerName(triggerID) );
 	}
-	int ret = func( Sender, this );
+	int ret = CallTrigger(func, Sender, this);
 	if (flags & TF_NEGATE) {
 		return !ret;
 	}
@@ -2370,7 +2931,11 @@ int Response::Execute(Scriptable* Sender)
 
 static void PrintAction(StringBuffer& buffer, int actionID)
 {
-	buffer.appendFormatted("Action: %d %s\n", actionID, actionsTable->GetValue(actionID));
+	const char *name = NULL;
+	if (actionID >= 0 && actionID < MAX_ACTIONS) {
+		name = actionNames[actionID];
+	}
+	buffer.appendFormatted("Action: %d %s\n", actionID, name ? name : "?");
 }
 
 void GameScript::ExecuteAction(Scriptable* Sender, Action* aC)
@@ -2427,6 +2992,7 @@ void GameScript::ExecuteAction(Scriptable* Sender, Action* aC)
 				}
 			}
 		}
+		ProfileTimer timer(NULL, 0, PROFILE_ACTION, actionID);
 		func( Sender, aC );
 	} else {
 		actions[actionID] = NoActionAtAll;
@@ -42,9 +42,12 @@ namespace GemRB {
 
 class Action;
 class GameScript;
+class Trigger;
 
 class StringBuffer;
 
+typedef int (* TriggerFunction)(Scriptable*, Trigger*);
+
 //escapearea flags
 #define EA_DESTROY 1        //destroy actor at the exit (otherwise move to new place)
 #define EA_NOSEE   2        //no need to see the exit
@@ -140,18 +143,17 @@ struct targettype {
 	unsigned int distance;
 };
 
-typedef std::list<targettype> targetlist;
+//sorted by distance, nearest first
+typedef std::vector<targettype> targetlist;
+
+//freed target buffers kept for reuse
+#define TARGETS_POOL 32
 
 class GEM_EXPORT Targets {
 public:
-	Targets()
-	{
-	}
-
-	~Targets()
-	{
-		Clear();
-	}
+	Targets();
+	Targets(const Targets &other);
+	~Targets();
 private:
 	targetlist objects;
 public:
@@ -229,6 +231,7 @@ public:
 		int1Parameter = 0;
 		int2Parameter = 0;
 		pointParameter.null();
+		string0Hash = 0;
 	}
 	~Trigger()
 	{
@@ -238,6 +241,7 @@ public:
 		}
 	}
 	int Evaluate(Scriptable* Sender);
+	TriggerFunction GetFunction() const;
 public:
 	unsigned short triggerID;
 	int int0Parameter;
@@ -248,6 +252,8 @@ public:
 	char string0Parameter[65];
 	char string1Parameter[65];
 	Object* objectParameter;
+	//the hash of the variable in string0Parameter, see CheckVariable
+	unsigned int string0Hash;
 
 public:
 	void dump() const;
@@ -424,8 +430,39 @@ public:
 	ResponseSet* responseSet;
 };
 
+//what a trigger result depends on, for skipping blocks that must fail again
+#define TD_VOLATILE  0 //anything, always evaluated
+#define TD_CONSTANT  1 //nothing (True, False)
+#define TD_VARIABLES 2 //GLOBAL and LOCALS variables only
+#define TD_EVENTS    3 //the Scriptable's trigger list only, false while empty
+
+/* a trigger of a compiled script, with its function already looked up */
+struct TriggerOp {
+	TriggerFunction func; //NULL for Or(), which needs no call
+	Trigger* trigger;
+	int orCount;
+	bool negate;
+	unsigned char depends; //TD_*, for a false result
+};
+
+/* the trigger that made a block fail last time, see Script::EvaluateBlock */
+struct BlockMemo {
+	unsigned int op; //1 based index into Script::code, 0 for none
+	ieDword changes; //Variables::GetChanges() back then
+};
+
+/* the triggers of a response block, as a range of Script::code */
+struct BlockOp {
+	unsigned int first;
+	unsigned int count;
+};
+
 class GEM_EXPORT Script : protected Canary {
 public:
+	Script()
+	{
+		triggerPool = NULL;
+	}
 	~Script()
 	{
 		for (unsigned int i = 0; i < responseBlocks.size(); i++) {
@@ -434,9 +471,16 @@ public:
 				responseBlocks[i] = NULL;
 			}
 		}
+		delete [] triggerPool;
 	}
+	void Compile();
+	bool EvaluateBlock(unsigned int block, Scriptable* Sender, BlockMemo& memo) const;
 public:
 	std::vector<ResponseBlock*> responseBlocks;
+	//the conditions of all blocks, stored back to back by Compile
+	std::vector<BlockOp> blocks;
+	std::vector<TriggerOp> code;
+	Trigger* triggerPool;
 public:
 	void Release()
 	{
@@ -444,7 +488,6 @@ public:
 	}
 };
 
-typedef int (* TriggerFunction)(Scriptable*, Trigger*);
 typedef void (* ActionFunction)(Scriptable*, Action*);
 typedef Targets* (* ObjectFunction)(Scriptable *, Targets*, int ga_flags);
 typedef int (* IDSFunction)(Actor *, int parameter);
@@ -530,6 +573,12 @@ struct IDSLink {
 #define AI_SCRIPT_LEVEL 4             //the script level of special ai scripts
 
 extern void SetScriptDebugMode(int arg);
+/* logs the costliest triggers so far, optionally restarting the counting */
+GEM_EXPORT void DumpTriggerProfile(bool reset);
+/* the same for script blocks, followed by the triggers */
+GEM_EXPORT void DumpScriptProfile(bool reset);
+/* writes all the counters per script block, trigger and action as CSV */
+GEM_EXPORT bool WriteScriptProfile(const char *path);
 extern int RandomNumValue;
 
 class GEM_EXPORT GameScript {
@@ -555,6 +604,7 @@ private: //Internal variables
 	Scriptable* const MySelf;
 	ieResRef Name;
 	Script* script;
+	std::vector<BlockMemo> memos;
 	unsigned int lastAction;
 	int scriptlevel;
 public: //Script Functions
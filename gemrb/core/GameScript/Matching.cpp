@@ -30,8 +30,43 @@
 #include "Scriptable/Door.h"
 #include "Scriptable/InfoPoint.h"
 
+#include <climits>
+
 namespace GemRB {
 
+//reused by the indexed actor lookups
+static std::vector<unsigned int> candidates;
+
+/* remembered GetAllObjects results, see BeginObjectMemo */
+struct ObjectMemo {
+	Map *map;
+	Scriptable *sender;
+	Object object;
+	int ga_flags;
+	Targets *result; //NULL if nothing was found
+};
+
+static std::vector<ObjectMemo> objectMemos;
+static int objectMemoDepth = 0;
+
+//filters only depending on positions and stats, not on the Last* fields
+//that triggers like See() can change while the script is evaluated
+static const ObjectFunction memoFilters[] = {
+	GameScript::Myself, GameScript::Protagonist,
+	GameScript::Player1, GameScript::Player2, GameScript::Player3,
+	GameScript::Player4, GameScript::Player5, GameScript::Player6,
+	GameScript::Nearest, GameScript::SecondNearest, GameScript::ThirdNearest,
+	GameScript::FourthNearest, GameScript::FifthNearest, GameScript::SixthNearest,
+	GameScript::SeventhNearest, GameScript::EighthNearest, GameScript::NinthNearest,
+	GameScript::TenthNearest, GameScript::Farthest, GameScript::NearestPC,
+	GameScript::NearestEnemyOf, GameScript::SecondNearestEnemyOf,
+	GameScript::ThirdNearestEnemyOf, GameScript::FourthNearestEnemyOf,
+	GameScript::FifthNearestEnemyOf, GameScript::SixthNearestEnemyOf,
+	GameScript::SeventhNearestEnemyOf, GameScript::EighthNearestEnemyOf,
+	GameScript::NinthNearestEnemyOf, GameScript::TenthNearestEnemyOf,
+	GameScript::FarthestEnemyOf, NULL
+};
+
 /* return a Targets object with a single scriptable inside */
 static inline Targets* ReturnScriptableAsTarget(Scriptable *sc)
 {
@@ -60,6 +95,89 @@ static inline bool DoObjectIDSCheck(Object *oC, Actor *ac, bool *filtered) {
 	return true;
 }
 
+/* the values an IDS field accepts in one of the stats the map indexes,
+ * false if the field can't be looked up that way (class, masks) */
+static bool GetIDSRange(int field, int value, unsigned int &stat, int &min, int &max)
+{
+	IDSFunction func = idtargets[field];
+	min = max = value;
+	if (func == GameScript::ID_Allegiance) {
+		stat = IE_EA;
+		switch (value) {
+			case EA_GOODCUTOFF:
+				min = INT_MIN;
+				return true;
+			case EA_NOTGOOD:
+				max = INT_MAX;
+				return true;
+			case EA_NOTEVIL:
+				min = INT_MIN;
+				return true;
+			case EA_EVILCUTOFF:
+				max = INT_MAX;
+				return true;
+			case EA_NOTNEUTRAL:
+			case EA_ANYTHING:
+				return false;
+		}
+		return true;
+	}
+	if (func == GameScript::ID_Alignment) {
+		//the index only holds the low byte, like the matching
+		stat = IE_ALIGNMENT;
+		if (!(value & 15)) {
+			min = value & 240;
+			max = min | 15;
+			return min != 0;
+		}
+		min = max = value & 255;
+		return (value & 240) != 0;
+	}
+	if (func == GameScript::ID_General) {
+		stat = IE_GENERAL;
+	} else if (func == GameScript::ID_Race) {
+		stat = IE_RACE;
+	} else if (func == GameScript::ID_Specific) {
+		stat = IE_SPECIFIC;
+	} else if (func == GameScript::ID_Gender) {
+		stat = IE_SEX;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+/* fills candidates from the most selective indexed IDS field,
+ * false if none of them is indexed and all actors have to be checked */
+static bool GetIDSCandidates(Map *map, Object *oC)
+{
+	unsigned int best = 0, bestStat = 0;
+	int bestMin = 0, bestMax = 0;
+	bool indexed = false;
+
+	for (int j = 0; j < ObjectIDSCount; j++) {
+		unsigned int stat;
+		int min, max;
+		if (!oC->objectFields[j] || !GetIDSRange(j, oC->objectFields[j], stat, min, max)) {
+			continue;
+		}
+		unsigned int count = map->CountIndexedActors(stat, min, max);
+		if (!indexed || count < best) {
+			indexed = true;
+			best = count;
+			bestStat = stat;
+			bestMin = min;
+			bestMax = max;
+		}
+	}
+	if (!indexed) {
+		return false;
+	}
+	candidates.clear();
+	map->GetIndexedActors(bestStat, bestMin, bestMax, candidates);
+	return true;
+}
+
 /* do object filtering: Myself, LastAttackerOf(Player1), etc */
 static inline Targets *DoObjectFiltering(Scriptable *Sender, Targets *tgts, Object *oC, int ga_flags) {
 	targetlist::iterator m;
@@ -193,11 +311,12 @@ static Targets* EvaluateObject(Map *map, Scriptable* Sender, Object* oC, int ga_
 
 	Targets *tgts = NULL;
 
-	//we need to get a subset of actors from the large array
-	//if this gets slow, we will need some index tables
-	int i = map->GetActorCount(true);
-	while (i--) {
-		Actor *ac = map->GetActor(i, true);
+	//we need to get a subset of actors from the large array, the map
+	//indexes the common IDS fields, so only check the actors matching one
+	bool indexed = GetIDSCandidates(map, oC);
+	int count = indexed ? (int) candidates.size() : map->GetActorCount(true);
+	for (int c = 0; c < count; c++) {
+		Actor *ac = map->GetActor(indexed ? (int) candidates[c] : count - 1 - c, true);
 		if (!ac) continue; // is this check really needed?
 		// don't return Sender in IDS targeting!
 		// unless it's pst, which relies on it in 3012cut2-3012cut7.bcs
@@ -226,7 +345,92 @@ static Targets* EvaluateObject(Map *map, Scriptable* Sender, Object* oC, int ga_
 	return tgts;
 }
 
+static bool CanMemoObject(const Object *oC)
+{
+	for (int i = 0; i < MaxObjectNesting; i++) {
+		int filterid = oC->objectFilters[i];
+		if (!filterid) break;
+		if (filterid < 0) continue;
+
+		int j;
+		for (j = 0; memoFilters[j]; j++) {
+			if (memoFilters[j] == objects[filterid]) break;
+		}
+		if (!memoFilters[j]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool SameObject(const Object *a, const Object *b)
+{
+	return !memcmp(a->objectFields, b->objectFields, sizeof(a->objectFields)) &&
+		!memcmp(a->objectFilters, b->objectFilters, sizeof(a->objectFilters)) &&
+		!memcmp(a->objectRect, b->objectRect, sizeof(a->objectRect)) &&
+		!strcmp(a->objectName, b->objectName);
+}
+
+void BeginObjectMemo()
+{
+	objectMemoDepth++;
+}
+
+void FlushObjectMemo()
+{
+	for (size_t i = 0; i < objectMemos.size(); i++) {
+		delete objectMemos[i].result;
+	}
+	objectMemos.clear();
+}
+
+void EndObjectMemo()
+{
+	if (!--objectMemoDepth) {
+		FlushObjectMemo();
+	}
+}
+
+int SuspendObjectMemo()
+{
+	int depth = objectMemoDepth;
+	objectMemoDepth = 0;
+	FlushObjectMemo();
+	return depth;
+}
+
+void ResumeObjectMemo(int depth)
+{
+	objectMemoDepth = depth;
+}
+
+static Targets* FindAllObjects(Map *map, Scriptable* Sender, Object* oC, int ga_flags);
+
 Targets* GetAllObjects(Map *map, Scriptable* Sender, Object* oC, int ga_flags)
+{
+	if (!objectMemoDepth || !oC || !CanMemoObject(oC)) {
+		return FindAllObjects(map, Sender, oC, ga_flags);
+	}
+
+	for (size_t i = 0; i < objectMemos.size(); i++) {
+		const ObjectMemo &memo = objectMemos[i];
+		if (memo.sender == Sender && memo.map == map && memo.ga_flags == ga_flags && SameObject(&memo.object, oC)) {
+			return memo.result ? new Targets(*memo.result) : NULL;
+		}
+	}
+
+	Targets *tgts = FindAllObjects(map, Sender, oC, ga_flags);
+	ObjectMemo memo;
+	memo.map = map;
+	memo.sender = Sender;
+	memo.object = *oC;
+	memo.ga_flags = ga_flags;
+	memo.result = tgts ? new Targets(*tgts) : NULL;
+	objectMemos.push_back(memo);
+	return tgts;
+}
+
+static Targets* FindAllObjects(Map *map, Scriptable* Sender, Object* oC, int ga_flags)
 {
 	if (!oC) {
 		//return all objects
@@ -694,10 +898,17 @@ Targets *XthNearestEnemyOf(Targets *parameters, int count, int ga_flags)
 		return parameters;
 	}
 	Map *map = origin->GetCurrentArea();
-	int i = map->GetActorCount(true);
+	//only look at the opposite side, the checks below still decide
+	candidates.clear();
+	if (type) {
+		map->GetIndexedActors(IE_EA, EA_EVILCUTOFF, INT_MAX, candidates);
+		map->GetIndexedActors(IE_EA, INT_MIN, -1, candidates);
+	} else {
+		map->GetIndexedActors(IE_EA, 0, EA_GOODCUTOFF, candidates);
+	}
 	ga_flags |= GA_NO_UNSCHEDULED|GA_NO_DEAD;
-	while (i--) {
-		Actor *ac = map->GetActor(i,true);
+	for (size_t c = 0; c < candidates.size(); c++) {
+		Actor *ac = map->GetActor(candidates[c], true);
 		if (ac == origin) continue;
 		int distance;
 		//int distance = Distance(ac, origin);
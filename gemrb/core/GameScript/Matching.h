@@ -29,6 +29,14 @@ namespace GemRB {
 class TileMap;
 
 GEM_EXPORT Targets* GetAllObjects(Map *map, Scriptable* Sender, Object* oC, int ga_flags);
+/* between these, GetAllObjects reuses its results for the same objects of
+ * the same sender; flush it whenever the game state may have changed */
+void BeginObjectMemo();
+void FlushObjectMemo();
+void EndObjectMemo();
+/* turns the memo off (and empties it) until resumed with the returned depth */
+int SuspendObjectMemo();
+void ResumeObjectMemo(int depth);
 Targets* GetAllActors(Scriptable* Sender, int ga_flags);
 Scriptable* GetActorFromObject(Scriptable* Sender, Object* oC, int ga_flags = 0);
 Scriptable* GetStoredActorFromObject(Scriptable* Sender, Object* oC, int ga_flags = 0);
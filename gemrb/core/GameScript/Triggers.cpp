@@ -455,7 +455,7 @@ int GameScript::BitCheck(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value = CheckVariable(Sender, parameters->string0Parameter, &valid, parameters->string0Hash );
 	if (valid) {
 		if ( value & parameters->int0Parameter ) return 1;
 	}
@@ -466,7 +466,7 @@ int GameScript::BitCheckExact(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value = CheckVariable(Sender, parameters->string0Parameter, &valid, parameters->string0Hash );
 	if (valid) {
 		ieDword tmp = (ieDword) parameters->int0Parameter ;
 		if ((value & tmp) == tmp) return 1;
@@ -480,7 +480,7 @@ int GameScript::BitGlobal_Trigger(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value = CheckVariable(Sender, parameters->string0Parameter, &valid, parameters->string0Hash );
 	if (valid) {
 		HandleBitMod(value, parameters->int0Parameter, parameters->int1Parameter);
 		if (value!=0) return 1;
@@ -492,7 +492,7 @@ int GameScript::GlobalOrGlobal_Trigger(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, &valid, parameters->string0Hash );
 	if (valid) {
 		if ( value1 ) return 1;
 		ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
@@ -519,7 +519,7 @@ int GameScript::GlobalBAndGlobal_Trigger(Scriptable* Sender, Trigger* parameters
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, &valid, parameters->string0Hash );
 	if (valid) {
 		ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
 		if (valid) {
@@ -533,7 +533,7 @@ int GameScript::GlobalBAndGlobalExact(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, &valid, parameters->string0Hash );
 	if (valid) {
 		ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
 		if (valid) {
@@ -547,7 +547,7 @@ int GameScript::GlobalBitGlobal_Trigger(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value1 = CheckVariable(Sender, parameters->string0Parameter, &valid, parameters->string0Hash );
 	if (valid) {
 		ieDword value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
 		if (valid) {
@@ -571,7 +571,7 @@ int GameScript::Xor(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDword value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDword value = CheckVariable(Sender, parameters->string0Parameter, &valid, parameters->string0Hash );
 	if (valid) {
 		if (( value ^ parameters->int0Parameter ) != 0) return 1;
 	}
@@ -633,7 +633,7 @@ int GameScript::Global(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, &valid, parameters->string0Hash );
 	if (valid) {
 		if ( value == parameters->int0Parameter ) return 1;
 	}
@@ -650,7 +650,7 @@ int GameScript::GlobalLT(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, &valid, parameters->string0Hash );
 	if (valid) {
 		if ( value < parameters->int0Parameter ) return 1;
 	}
@@ -667,7 +667,7 @@ int GameScript::GlobalGT(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDwordSigned value = CheckVariable(Sender, parameters->string0Parameter, &valid, parameters->string0Hash );
 	if (valid) {
 		if ( value > parameters->int0Parameter ) return 1;
 	}
@@ -678,7 +678,7 @@ int GameScript::GlobalLTGlobal(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDwordSigned value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDwordSigned value1 = CheckVariable(Sender, parameters->string0Parameter, &valid, parameters->string0Hash );
 	if (valid) {
 		ieDwordSigned value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
 		if (valid) {
@@ -692,7 +692,7 @@ int GameScript::GlobalGTGlobal(Scriptable* Sender, Trigger* parameters)
 {
 	bool valid=true;
 
-	ieDwordSigned value1 = CheckVariable(Sender, parameters->string0Parameter, &valid );
+	ieDwordSigned value1 = CheckVariable(Sender, parameters->string0Parameter, &valid, parameters->string0Hash );
 	if (valid) {
 		ieDwordSigned value2 = CheckVariable(Sender, parameters->string1Parameter, &valid );
 		if (valid) {
@@ -43,6 +43,7 @@
 #include "EffectMgr.h"
 #include "EffectQueue.h"
 #include "Factory.h"
+#include "FileCache.h"
 #include "FontManager.h"
 #include "Game.h"
 #include "GameData.h"
@@ -85,6 +86,8 @@
 #include "RNG/RNG_SFMT.h"
 #include "Scriptable/Container.h"
 #include "System/FileStream.h"
+#include "System/MemoryStream.h"
+#include "System/Thread.h"
 #include "System/VFS.h"
 #include "System/StringBuffer.h"
 
@@ -195,6 +198,8 @@ Interface::Interface()
 	TouchScrollAreas = false;
 	UseSoftKeyboard = false;
 	KeepCache = false;
+	BIFCacheSize = 8192;
+	LazySaveExtraction = true;
 	NumFingInfo = 2;
 	NumFingKboard = 3;
 	NumFingScroll = 2;
@@ -321,6 +326,7 @@ void Interface::FreeResRefTable(ieResRef *&table, int &count)
 
 Interface::~Interface(void)
 {
+	ShutdownBackgroundWriter();
 	DragItem(NULL,NULL);
 	delete AreaAliasTable;
 
@@ -1288,6 +1294,7 @@ int Interface::Init(InterfaceConfig* config)
 			var ( atoi( value ) ); \
 		value = NULL;
 
+	CONFIG_INT("BIFCacheSize", BIFCacheSize =);
 	CONFIG_INT("Bpp", Bpp =);
 	vars->SetAt("BitsPerPixel", Bpp); //put into vars so that reading from game.ini wont overwrite
 	CONFIG_INT("CaseSensitive", CaseSensitive =);
@@ -1303,6 +1310,7 @@ int Interface::Init(InterfaceConfig* config)
 	CONFIG_INT("TouchScrollAreas", TouchScrollAreas = );
 	CONFIG_INT("Height", Height = );
 	CONFIG_INT("KeepCache", KeepCache = );
+	CONFIG_INT("LazySaveExtraction", LazySaveExtraction = );
 	CONFIG_INT("MaxPartySize", MaxPartySize = );
 	vars->SetAt("MaxPartySize", MaxPartySize); // for simple GUIScript access
 	CONFIG_INT("MultipleQuickSaves", MultipleQuickSaves = );
@@ -1507,6 +1515,8 @@ int Interface::Init(InterfaceConfig* config)
 			Log(FATAL, "Core", "The cache path couldn't be registered, please check!");
 			return GEM_ERROR;
 		}
+		//replaced by the archive of a loaded save, see LoadGame
+		gamedata->AddSource(path, "Saved game", PLUGIN_RESOURCE_NULL);
 
 		size_t i;
 		for (i = 0; i < ModPath.size(); ++i)
@@ -3796,6 +3806,8 @@ void Interface::LoadGame(SaveGame *sg, int ver_override)
 
 	LoadProgress(10);
 	if (!KeepCache) DelTree((const char *) CachePath, true);
+	//drop the entries of the previous save that were never extracted
+	gamedata->AddSource(CachePath, "Saved game", PLUGIN_RESOURCE_NULL, RM_REPLACE_SAME_SOURCE);
 	LoadProgress(15);
 
 	if (sg == NULL) {
@@ -3854,8 +3866,11 @@ void Interface::LoadGame(SaveGame *sg, int ver_override)
 	LoadProgress(20);
 	// Unpack SAV (archive) file to Cache dir
 	if (sav_str) {
+		//areas and stores are only extracted when first requested
+		bool indexed = LazySaveExtraction && gamedata->AddSource(sav_str->originalfile,
+			"Saved game", PLUGIN_RESOURCE_SAVEGAME, RM_REPLACE_SAME_SOURCE);
 		PluginHolder<ArchiveImporter> ai(IE_SAV_CLASS_ID);
-		if (ai) {
+		if (ai && !indexed) {
 			if (ai->DecompressSaveGame(sav_str) != GEM_OK) {
 				goto cleanup;
 			}
@@ -4403,8 +4418,11 @@ void Interface::RemoveFromCache(const ieResRef resref, SClass_ID ClassID)
 {
 	char filename[_MAX_PATH];
 
+	WaitForBackgroundWrites();
 	PathJoinExt(filename, CachePath, resref, TypeExt(ClassID));
 	unlink ( filename);
+	//the lookups would still find the file in the cache
+	gamedata->FlushLookups();
 }
 
 //this function checks if the path is eligible as a cache
@@ -4448,6 +4466,7 @@ void Interface::DelTree(const char* Pt, bool onlysave)
 	char Path[_MAX_PATH];
 
 	if (!Pt[0]) return; //Don't delete the root filesystem :)
+	WaitForBackgroundWrites();
 	if (strlcpy(Path, Pt, _MAX_PATH) >= _MAX_PATH) {
 		Log(ERROR, "Interface", "Trying to delete too long path: %s!", Pt);
 		return;
@@ -4469,6 +4488,9 @@ void Interface::DelTree(const char* Pt, bool onlysave)
 			unlink( dtmp );
 		}
 	} while (++dir);
+	if (gamedata) {
+		gamedata->FlushLookups();
+	}
 }
 
 void Interface::LoadProgress(int percent)
@@ -5061,16 +5083,19 @@ int Interface::SwapoutArea(Map *map)
 	}
 	int size = mm->GetStoredFileSize (map);
 	if (size > 0) {
-		//created streams are always autofree (close file on destruct)
-		//this one will be destructed when we return from here
-		FileStream str;
+		//the area is serialized here, but written out in the background
+		char path[_MAX_PATH];
+		PathJoinExt(path, CachePath, map->GetScriptName(), TypeExt(IE_ARE_CLASS_ID));
+		MemoryStream *mem = new MemoryStream(path, malloc(size), size);
 
-		str.Create( map->GetScriptName(), IE_ARE_CLASS_ID );
-		int ret = mm->PutArea (&str, map);
+		int ret = mm->PutArea (mem, map);
 		if (ret <0) {
+			delete mem;
 			Log(WARNING, "Core", "Area removed: %s",
 				map->GetScriptName());
 			RemoveFromCache(map->GetScriptName(), IE_ARE_CLASS_ID);
+		} else {
+			WriteInBackground(mem);
 		}
 	} else {
 		Log(WARNING, "Core", "Area removed: %s",
@@ -5127,16 +5152,18 @@ int Interface::WriteGame(const char *folder)
 
 	int size = gm->GetStoredFileSize (game);
 	if (size > 0) {
-		//created streams are always autofree (close file on destruct)
-		//this one will be destructed when we return from here
-		FileStream str;
+		//the game is serialized here, but written out in the background
+		char path[_MAX_PATH];
+		PathJoinExt(path, folder, GameNameResRef, TypeExt(IE_GAM_CLASS_ID));
+		MemoryStream *mem = new MemoryStream(path, malloc(size), size);
 
-		str.Create( folder, GameNameResRef, IE_GAM_CLASS_ID );
-		int ret = gm->PutGame (&str, game);
+		int ret = gm->PutGame (mem, game);
 		if (ret <0) {
+			delete mem;
 			Log(WARNING, "Core", "Game cannot be saved: %s", folder);
 			return -1;
 		}
+		WriteInBackground(mem);
 	} else {
 		Log(WARNING, "Core", "Internal error, game cannot be saved: %s", folder);
 		return -1;
@@ -5167,16 +5194,27 @@ int Interface::WriteWorldMap(const char *folder)
 	if ((size1 < 0) || (size2<0) ) {
 		ret=-1;
 	} else {
-		//created streams are always autofree (close file on destruct)
-		//this one will be destructed when we return from here
-		FileStream str1;
-		FileStream str2;
-
-		str1.Create( folder, WorldMapName[0], IE_WMP_CLASS_ID );
+		//the worldmaps are serialized here, but written out in the background
+		char path1[_MAX_PATH];
+		PathJoinExt(path1, folder, WorldMapName[0], TypeExt(IE_WMP_CLASS_ID));
+		MemoryStream *mem1 = new MemoryStream(path1, malloc(size1), size1);
+		MemoryStream *mem2 = NULL;
 		if (!worldmap->IsSingle()) {
-			str2.Create( folder, WorldMapName[1], IE_WMP_CLASS_ID );
+			char path2[_MAX_PATH];
+			PathJoinExt(path2, folder, WorldMapName[1], TypeExt(IE_WMP_CLASS_ID));
+			mem2 = new MemoryStream(path2, malloc(size2), size2);
+		}
+
+		ret = wmm->PutWorldMap (mem1, mem2, worldmap);
+		if (ret < 0) {
+			delete mem1;
+			delete mem2;
+		} else {
+			WriteInBackground(mem1);
+			if (mem2) {
+				WriteInBackground(mem2);
+			}
 		}
-		ret = wmm->PutWorldMap (&str1, &str2, worldmap);
 	}
 	if (ret <0) {
 		Log(WARNING, "Core", "Internal error, worldmap cannot be saved: %s", folder);
@@ -5185,43 +5223,74 @@ int Interface::WriteWorldMap(const char *folder)
 	return 0;
 }
 
-int Interface::CompressSave(const char *folder)
-{
-	FileStream str;
-
-	str.Create( folder, GameNameResRef, IE_SAV_CLASS_ID );
-	DirectoryIterator dir(CachePath);
-	if (!dir) {
-		return -1;
+// builds the save archive from the cache, after the queued area writes
+class CompressSaveJob : public Task {
+public:
+	CompressSaveJob(FileStream *str)
+		: str(str)
+	{
+	}
+	~CompressSaveJob()
+	{
+		delete str;
 	}
-	PluginHolder<ArchiveImporter> ai(IE_SAV_CLASS_ID);
-	ai->CreateArchive( &str);
+	void Run()
+	{
+		DirectoryIterator dir(core->CachePath);
+		if (!dir) {
+			Log(ERROR, "Interface", "Cannot read the cache, %s is incomplete.", str->originalfile);
+			return;
+		}
 
-	//.tot and .toh should be saved last, because they are updated when an .are is saved
-	int priority=2;
-	while(priority) {
-		do {
-			const char *name = dir.GetName();
-			if (dir.IsDirectory())
-				continue;
-			if (name[0] == '.')
-				continue;
-			if (SavedExtension(name)==priority) {
-				char dtmp[_MAX_PATH];
-				dir.GetFullPath(dtmp);
-				FileStream fs;
-				if (!fs.Open(dtmp)) {
-					Log(ERROR, "Interface", "Failed to open \"%s\".", dtmp);
+		//.tot and .toh should be saved last, because they are updated when an .are is saved
+		std::vector<std::string> files;
+		int priority=2;
+		while(priority) {
+			do {
+				const char *name = dir.GetName();
+				if (dir.IsDirectory())
+					continue;
+				if (name[0] == '.')
+					continue;
+				if (core->SavedExtension(name)==priority) {
+					char dtmp[_MAX_PATH];
+					dir.GetFullPath(dtmp);
+					files.push_back(dtmp);
 				}
-				ai->AddToSaveGame(&str, &fs);
+			} while (++dir);
+			//reopen list for the second round
+			priority--;
+			if (priority>0) {
+				dir.Rewind();
 			}
-		} while (++dir);
-		//reopen list for the second round
-		priority--;
-		if (priority>0) {
-			dir.Rewind();
 		}
+		//the importer is only used (and refcounted) on this thread
+		PluginHolder<ArchiveImporter> ai(IE_SAV_CLASS_ID);
+		ai->CreateArchive(str);
+		//the entries are compressed in parallel, but keep this order
+		ai->AddFilesToSaveGame(str, files);
+	}
+private:
+	FileStream *str;
+};
+
+int Interface::CompressSave(const char *folder)
+{
+	//the save has to contain the entries of the loaded one never extracted
+	if (!gamedata->ExtractAll()) {
+		Log(ERROR, "Core", "Cannot save, some areas of the loaded game could not be extracted.");
+		return -1;
+	}
+
+	if (!IsAvailable(IE_SAV_CLASS_ID)) {
+		return -1;
+	}
+	FileStream *str = new FileStream();
+	if (!str->Create( folder, GameNameResRef, IE_SAV_CLASS_ID )) {
+		delete str;
+		return -1;
 	}
+	RunInBackground(new CompressSaveJob(str));
 	return 0;
 }
 
@@ -818,6 +818,8 @@ public:
 	int GUIEnhancements;
 	int MaxPartySize;
 	bool KeepCache;
+	unsigned int BIFCacheSize; //KB of compressed archive blocks kept inflated, 0 inflates to the cache
+	bool LazySaveExtraction; //extract areas and stores of a loaded save only when needed
 	bool MultipleQuickSaves;
 	bool UseCorruptedHack;
 
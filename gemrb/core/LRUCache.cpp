@@ -30,16 +30,31 @@ struct VarEntry {
 	VarEntry* next;
 	void* data;
 	char* key;
+	unsigned long size;
+	unsigned int pins;
 };
 
-LRUCache::LRUCache() : v(), head(0), tail(0) {
+LRUCache::LRUCache(unsigned long capacity)
+	: v(), head(0), tail(0), pinnedHead(0), pinnedTail(0), capacity(capacity),
+	size(0), hits(0), misses(0), evictions(0)
+{
 	v.SetType(GEM_VARIABLES_POINTER);
 	v.ParseKey(1);
 }
 
 LRUCache::~LRUCache()
 {
-
+	// the values are owned by the user
+	VarEntry* lists[2] = { head, pinnedHead };
+	for (int i = 0; i < 2; ++i) {
+		VarEntry* e = lists[i];
+		while (e) {
+			VarEntry* next = e->next;
+			delete[] e->key;
+			delete e;
+			e = next;
+		}
+	}
 }
 
 int LRUCache::GetCount() const
@@ -47,27 +62,26 @@ int LRUCache::GetCount() const
 	return v.GetCount();
 }
 
-void LRUCache::SetAt(const char* key, void* value)
+void LRUCache::SetAt(const char* key, void* value, unsigned long size)
 {
 	void* p;
 	if (v.Lookup(key, p)) {
 		VarEntry* e = (VarEntry*) p;
 		e->data = value;
+		this->size += size - e->size;
+		e->size = size;
 		Touch(key);
 		return;
 	}
 
 	VarEntry* e = new VarEntry();
-	e->prev = 0;
-	e->next = head;
 	e->data = value;
 	e->key = new char[strlen(key)+1];
 	strcpy(e->key, key);
-
-	if (head)
-		head->prev = e;
-	head = e;
-	if (tail == 0) tail = head;
+	e->size = size;
+	e->pins = 0;
+	addToList(e);
+	this->size += size;
 
 	v.SetAt(key, (void*)e);
 }
@@ -78,8 +92,10 @@ bool LRUCache::Lookup(const char* key, void*& value) const
 	if (v.Lookup(key, p)) {
 		VarEntry* e = (VarEntry*) p;
 		value = e->data;
+		++hits;
 		return true;
 	}
+	++misses;
 	return false;
 }
 
@@ -89,17 +105,11 @@ bool LRUCache::Touch(const char* key)
 	if (!v.Lookup(key, p)) return false;
 	VarEntry* e = (VarEntry*) p;
 
-	// already head?
-	if (!e->prev) return true;
+	// already head? pinned entries aren't ordered
+	if (!e->prev || e->pins) return true;
 
 	removeFromList(e);
-
-	// re-add e as head:
-	e->prev = 0;
-	e->next = head;
-	head->prev = e;
-	head = e;
-	if (tail == 0) tail = head;
+	addToList(e);
 	return true;
 }
 
@@ -110,41 +120,111 @@ bool LRUCache::Remove(const char* key)
 	VarEntry* e = (VarEntry*) p;
 	v.Remove(key);
 	removeFromList(e);
+	size -= e->size;
 	delete[] e->key;
 	delete e;
 	return true;
 }
 
+bool LRUCache::Pin(const char* key)
+{
+	void* p;
+	if (!v.Lookup(key, p)) return false;
+	VarEntry* e = (VarEntry*) p;
+
+	if (!e->pins) {
+		removeFromList(e);
+		e->pins = 1;
+		addToList(e);
+	} else {
+		++e->pins;
+	}
+	return true;
+}
+
+bool LRUCache::Unpin(const char* key)
+{
+	void* p;
+	if (!v.Lookup(key, p)) return false;
+	VarEntry* e = (VarEntry*) p;
+	if (!e->pins) return false;
+
+	if (e->pins == 1) {
+		// it was just in use, so it is the most recently used
+		removeFromList(e);
+		e->pins = 0;
+		addToList(e);
+	} else {
+		--e->pins;
+	}
+	return true;
+}
+
+bool LRUCache::IsPinned(const char* key) const
+{
+	void* p;
+	if (!v.Lookup(key, p)) return false;
+	return ((VarEntry*) p)->pins != 0;
+}
+
+bool LRUCache::Evict(void*& value)
+{
+	if (!capacity || size <= capacity || !tail) return false;
+
+	value = tail->data;
+	++evictions;
+	return Remove(tail->key);
+}
+
 bool LRUCache::getLRU(unsigned int n, const char*& key, void*& value) const
 {
 	VarEntry* e = tail;
-	for (unsigned int i = 0; i < n; ++i) {
+	bool pinned = false;
+	for (unsigned int i = 0; i <= n; ++i) {
+		if (i) e = e->prev;
+		if (!e && !pinned) {
+			e = pinnedTail;
+			pinned = true;
+		}
 		if (!e) return false;
-		e = e->prev;
 	}
-	if (!e) return false;
 
 	key = e->key;
 	value = e->data;
 	return true;
 }
 
+void LRUCache::addToList(VarEntry* e)
+{
+	VarEntry*& first = e->pins ? pinnedHead : head;
+	VarEntry*& last = e->pins ? pinnedTail : tail;
+
+	e->prev = 0;
+	e->next = first;
+	if (first) first->prev = e;
+	first = e;
+	if (last == 0) last = first;
+}
+
 void LRUCache::removeFromList(VarEntry* e)
 {
+	VarEntry*& first = e->pins ? pinnedHead : head;
+	VarEntry*& last = e->pins ? pinnedTail : tail;
+
 	if (e->prev) {
-		assert(e != head);
+		assert(e != first);
 		e->prev->next = e->next;
 	} else {
-		assert(e == head);
-		head = e->next;
+		assert(e == first);
+		first = e->next;
 	}
 
 	if (e->next) {
-		assert(e != tail);
+		assert(e != last);
 		e->next->prev = e->prev;
 	} else {
-		assert(e == tail);
-		tail = e->prev;
+		assert(e == last);
+		last = e->prev;
 	}
 
 	e->prev = e->next = 0;
@@ -31,28 +31,51 @@ struct VarEntry;
 
 class GEM_EXPORT LRUCache {
 public:
-	LRUCache();
+	// capacity is in the units passed to SetAt, 0 means unlimited
+	LRUCache(unsigned long capacity = 0);
 	~LRUCache();
 
 	// set value, overwriting any previous entry
-	void SetAt(const char* key, void* value);
+	void SetAt(const char* key, void* value, unsigned long size = 0);
 	bool Lookup(const char* key, void*& value) const;
 	bool Touch(const char* key);
 	bool Remove(const char* key);
 
+	// pinned entries are in use, so they are never evicted
+	bool Pin(const char* key);
+	bool Unpin(const char* key);
+	bool IsPinned(const char* key) const;
+	// remove the least recently used unpinned entry if over capacity.
+	// returns its value, so the caller can free it.
+	bool Evict(void*& value);
+
 	int GetCount() const;
+	unsigned long GetSize() const { return size; }
+	unsigned long GetHits() const { return hits; }
+	unsigned long GetMisses() const { return misses; }
+	unsigned long GetEvictions() const { return evictions; }
 
 	// return n-th LRU entry. key remains owned by LRUCache.
 	// (n = 0 is least recently used, n = 1 the next least recently used,
-	//  etc...)
+	//  etc... pinned entries come after all the unpinned ones)
 	bool getLRU(unsigned int n, const char*& key, void*& value) const;
 
 private:
 	// internal storage
 	Variables v;
+	// unpinned entries, head is the most recently used
 	VarEntry* head;
 	VarEntry* tail;
+	// pinned entries, in no particular order
+	VarEntry* pinnedHead;
+	VarEntry* pinnedTail;
+	unsigned long capacity;
+	unsigned long size;
+	mutable unsigned long hits;
+	mutable unsigned long misses;
+	unsigned long evictions;
 
+	void addToList(VarEntry* e);
 	void removeFromList(VarEntry* e);
 };
 
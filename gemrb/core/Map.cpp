@@ -59,6 +59,7 @@
 
 #include <cmath>
 #include <cassert>
+#include <functional>
 
 namespace GemRB {
 
@@ -335,6 +336,18 @@ Map::Map(void)
 	HeightMap = NULL;
 	SmallMap = NULL;
 	MapSet = NULL;
+	MapSetGen = NULL;
+	MapSetNode = NULL;
+	SearchGen = 0;
+	PathRegions = NULL;
+	PathSectorsDirty = false;
+	ActorIndexValid = false;
+	GridWidth = GridHeight = GridMaxSize = 0;
+	VisibleCount = NULL;
+	SightEpoch = 0;
+	FogStale = true;
+	SightMap = NULL;
+	memset(LOSCache, -1, sizeof(LOSCache));
 	SrchMap = NULL;
 	Walls = NULL;
 	WallCount = 0;
@@ -379,6 +392,12 @@ Map::~Map(void)
 	unsigned int i;
 
 	free( MapSet );
+	free( MapSetGen );
+	free( MapSetNode );
+	free( PathRegions );
+	free( SightMap );
+	FlushSectorRoutes();
+	FlushSpriteCovers();
 	free( SrchMap );
 	free( MaterialMap );
 
@@ -400,6 +419,8 @@ Map::~Map(void)
 		//don't delete NPC/PC
 		if (a && !a->Persistent() ) {
 			delete a;
+		} else if (a) {
+			a->GridCell = -1;
 		}
 	}
 
@@ -446,6 +467,7 @@ Map::~Map(void)
 	//malloc-d in AREImp
 	free( ExploredBitmap );
 	free( VisibleBitmap );
+	free( VisibleCount );
 	if (Walls) {
 		for(i=0;i<WallCount;i++) {
 			delete Walls[i];
@@ -477,10 +499,13 @@ void Map::AddTileMap(TileMap* tm, Image* lm, Bitmap* sr, Sprite2D* sm, Bitmap* h
 	Height = (unsigned int) (( TMap->YCellCount * 64 + 63) / 12);
 	//Filling Matrices
 	MapSet = (unsigned short *) malloc(sizeof(unsigned short) * Width * Height);
+	MapSetGen = (ieDword *) calloc(Width * Height, sizeof(ieDword));
+	MapSetNode = (ieByte *) malloc(sizeof(ieByte) * Width * Height);
 	//Internal Searchmap
 	int y = sr->GetHeight();
 	SrchMap = (unsigned short *) calloc(Width * Height, sizeof(unsigned short));
 	MaterialMap = (unsigned short *) calloc(Width * Height, sizeof(unsigned short));
+	SightMap = (ieDword *) calloc((Width * Height + 31) / 32, sizeof(ieDword));
 	while(y--) {
 		int x=sr->GetWidth();
 		while(x--) {
@@ -488,11 +513,23 @@ void Map::AddTileMap(TileMap* tm, Image* lm, Bitmap* sr, Sprite2D* sm, Bitmap* h
 			size_t index = y * Width + x;
 			SrchMap[index] = Passable[value];
 			MaterialMap[index] = value;
+			UpdateSightMap(index, SrchMap[index]);
 		}
 	}
 
 	//delete the original searchmap
 	delete sr;
+	//the sector graph is built on the first long search, after the doors are set up
+	PathSectorsDirty = true;
+
+	GridWidth = (Width * 16 + ACTOR_GRID_CELL - 1) / ACTOR_GRID_CELL;
+	GridHeight = (Height * 12 + ACTOR_GRID_CELL - 1) / ACTOR_GRID_CELL;
+	ActorGrid.clear();
+	ActorGrid.resize(GridWidth * GridHeight);
+	for (size_t i = 0; i < actors.size(); i++) {
+		actors[i]->GridCell = -1;
+		FileActor(actors[i]);
+	}
 }
 
 void Map::MoveToNewArea(const char *area, const char *entrance, unsigned int direction, int EveryOne, Actor *actor)
@@ -673,9 +710,10 @@ void Map::UpdateScripts()
 	bool has_pcs = false;
 	size_t i=actors.size();
 	while (i--) {
+		// catch actors that were moved without telling the grid
+		UpdateActorCell(actors[i]);
 		if (actors[i]->InParty) {
 			has_pcs = true;
-			break;
 		}
 	}
 
@@ -926,6 +964,7 @@ bool Map::DoStepForActor(Actor *actor, int speed, ieDword time) {
 	}
 	if (!(actor->GetBase(IE_STATE_ID)&STATE_CANTMOVE) ) {
 		no_more_steps = actor->DoStep( speed, time );
+		UpdateActorCell( actor );
 		if (actor->BlocksSearchMap()) {
 			BlockSearchMap( actor->Pos, actor->size, actor->IsPartyMember()?PATH_MAP_PC:PATH_MAP_NPC);
 		}
@@ -935,19 +974,17 @@ bool Map::DoStepForActor(Actor *actor, int speed, ieDword time) {
 }
 
 void Map::ClearSearchMapFor( Movable *actor ) {
-	Actor** nearActors = GetAllActorsInRadius(actor->Pos, GA_NO_DEAD|GA_NO_LOS|GA_NO_UNSCHEDULED, MAX_CIRCLE_SIZE*2*16);
+	GetAllActorsInRadius(NearActors, actor->Pos, GA_NO_DEAD|GA_NO_LOS|GA_NO_UNSCHEDULED, MAX_CIRCLE_SIZE*2*16);
 	BlockSearchMap( actor->Pos, actor->size, PATH_MAP_FREE);
 
 	// Restore the searchmap areas of any nearby actors that could
 	// have been cleared by this BlockSearchMap(..., 0).
 	// (Necessary since blocked areas of actors may overlap.)
-	int i=0;
-	while(nearActors[i]!=NULL) {
-		if(nearActors[i]!=actor && nearActors[i]->BlocksSearchMap())
-			BlockSearchMap( nearActors[i]->Pos, nearActors[i]->size, nearActors[i]->IsPartyMember()?PATH_MAP_PC:PATH_MAP_NPC);
-		++i;
+	for (size_t i = 0; i < NearActors.size(); i++) {
+		Actor *neighbour = NearActors[i];
+		if (neighbour != actor && neighbour->BlocksSearchMap())
+			BlockSearchMap( neighbour->Pos, neighbour->size, neighbour->IsPartyMember()?PATH_MAP_PC:PATH_MAP_NPC);
 	}
-	free(nearActors);
 }
 
 void Map::DrawHighlightables()
@@ -1499,6 +1536,10 @@ void Map::AddActor(Actor* actor, bool init)
 	strnlwrcpy(actor->Area, scriptName, 8);
 	if (!HasActor(actor)) {
 		actors.push_back( actor );
+		ActorIndexValid = false;
+		//the cell could be left over from an area that was freed
+		actor->GridCell = -1;
+		FileActor( actor );
 	}
 	if (init) {
 		actor->SetMap(this);
@@ -1540,12 +1581,15 @@ void Map::DeleteActor(int i)
 		CopyResRef(actor->Area, "");
 		//don't destroy the object in case it is a persistent object
 		//otherwise there is a dead reference causing a crash on save
+		UnfileActor(actor);
+		DropFogCaster(actor);
 		if (game->InStore(actor) < 0) {
 			delete actor;
 		}
 	}
 	//remove the actor from the area's actor list
 	actors.erase( actors.begin()+i );
+	ActorIndexValid = false;
 }
 
 Scriptable *Map::GetScriptableByGlobalID(ieDword objectID)
@@ -1654,82 +1698,238 @@ Actor* Map::GetActor(const Point &p, int flags)
 	return NULL;
 }
 
-Actor* Map::GetActorInRadius(const Point &p, int flags, unsigned int radius)
+// actors off the map are filed in the border cells
+static inline unsigned int GetGridCoord(int coord, unsigned int cells)
 {
-	size_t i = actors.size();
-	while (i--) {
-		Actor* actor = actors[i];
+	return (unsigned int) std::max(0, std::min(coord / ACTOR_GRID_CELL, (int) cells - 1));
+}
 
-		if (PersonalDistance( p, actor ) > radius)
-			continue;
-		if (!actor->ValidTarget(flags) ) {
-			continue;
-		}
-		return actor;
+unsigned int Map::GetGridCell(const Point &p) const
+{
+	return GetGridCoord(p.y, GridHeight) * GridWidth + GetGridCoord(p.x, GridWidth);
+}
+
+void Map::GetGridRange(const Region &rgn, unsigned int &x1, unsigned int &y1, unsigned int &x2, unsigned int &y2) const
+{
+	//clamped as ints, the far corner of a big region doesn't fit a Point
+	x1 = GetGridCoord(rgn.x, GridWidth);
+	y1 = GetGridCoord(rgn.y, GridHeight);
+	x2 = GetGridCoord(rgn.x + rgn.w, GridWidth);
+	y2 = GetGridCoord(rgn.y + rgn.h, GridHeight);
+}
+
+void Map::FileActor(Actor *actor)
+{
+	if (ActorGrid.empty() || actor->GridCell >= 0) {
+		return;
+	}
+	actor->GridCell = (int) GetGridCell(actor->Pos);
+	ActorGrid[actor->GridCell].push_back(actor);
+	if ((unsigned int) actor->size > GridMaxSize) {
+		GridMaxSize = actor->size;
 	}
-	return NULL;
 }
 
-//maybe consider using a simple list
-Actor **Map::GetAllActorsInRadius(const Point &p, int flags, unsigned int radius, Scriptable *see)
+void Map::UnfileActor(Actor *actor)
 {
-	ieDword count = 1;
-	size_t i = actors.size();
-	while (i--) {
-		Actor* actor = actors[i];
+	if (actor->GridCell < 0) {
+		return;
+	}
+	std::vector<Actor*> &cell = ActorGrid[actor->GridCell];
+	std::vector<Actor*>::iterator it = std::find(cell.begin(), cell.end(), actor);
+	if (it != cell.end()) {
+		*it = cell.back();
+		cell.pop_back();
+	}
+	actor->GridCell = -1;
+}
 
-		if (PersonalDistance( p, actor ) > radius)
-			continue;
-		if (!actor->ValidTarget(flags, see) ) {
-			continue;
-		}
-		if (!(flags&GA_NO_LOS)) {
-			//line of sight visibility
-			if (!IsVisibleLOS(actor->Pos, p)) {
-				continue;
+void Map::UpdateActorCell(Actor *actor)
+{
+	if (actor->GridCell < 0 || actor->GetCurrentArea() != this) {
+		return;
+	}
+	if ((unsigned int) actor->GridCell == GetGridCell(actor->Pos) && (unsigned int) actor->size <= GridMaxSize) {
+		return;
+	}
+	UnfileActor(actor);
+	FileActor(actor);
+}
+
+Actor* Map::GetActorInRadius(const Point &p, int flags, unsigned int radius)
+{
+	if (ActorGrid.empty()) {
+		return NULL;
+	}
+	// PersonalDistance discounts the actor size
+	int range = radius + GridMaxSize * 10;
+	unsigned int x1, y1, x2, y2;
+	GetGridRange(Region(p.x - range, p.y - range, 2 * range, 2 * range), x1, y1, x2, y2);
+	for (unsigned int y = y1; y <= y2; y++) {
+		for (unsigned int x = x1; x <= x2; x++) {
+			const std::vector<Actor*> &cell = ActorGrid[y * GridWidth + x];
+			for (size_t i = 0; i < cell.size(); i++) {
+				Actor* actor = cell[i];
+
+				if (PersonalDistance( p, actor ) > radius)
+					continue;
+				if (!actor->ValidTarget(flags) ) {
+					continue;
+				}
+				return actor;
 			}
 		}
-		count++;
 	}
+	return NULL;
+}
 
-	Actor **ret = (Actor **) malloc( sizeof(Actor*) * count);
-	i = actors.size();
-	int j = 0;
-	while (i--) {
-		Actor* actor = actors[i];
-
-		if (PersonalDistance( p, actor ) > radius)
-			continue;
-		if (!actor->ValidTarget(flags) ) {
-			continue;
-		}
-		if (!(flags&GA_NO_LOS)) {
-			if (!IsVisibleLOS(actor->Pos, p)) {
-				continue;
+int Map::GetAllActorsInRadius(std::vector<Actor*> &neighbours, const Point &p, int flags, unsigned int radius, Scriptable *see)
+{
+	neighbours.clear();
+	if (ActorGrid.empty()) {
+		return 0;
+	}
+	// PersonalDistance discounts the actor size
+	int range = radius + GridMaxSize * 10;
+	unsigned int x1, y1, x2, y2;
+	GetGridRange(Region(p.x - range, p.y - range, 2 * range, 2 * range), x1, y1, x2, y2);
+	for (unsigned int y = y1; y <= y2; y++) {
+		for (unsigned int x = x1; x <= x2; x++) {
+			const std::vector<Actor*> &cell = ActorGrid[y * GridWidth + x];
+			for (size_t i = 0; i < cell.size(); i++) {
+				Actor* actor = cell[i];
+
+				if (PersonalDistance( p, actor ) > radius)
+					continue;
+				if (!actor->ValidTarget(flags, see) ) {
+					continue;
+				}
+				if (!(flags&GA_NO_LOS)) {
+					//line of sight visibility
+					if (!IsVisibleLOS(actor->Pos, p)) {
+						continue;
+					}
+				}
+				neighbours.push_back(actor);
 			}
 		}
+	}
+	return (int) neighbours.size();
+}
+
+
+//script names compare case insensitively, on 32 characters
+static inline void GetNameKey(ieVariable key, const char *name)
+{
+	strlcpy(key, name, sizeof(ieVariable));
+}
 
-		ret[j++]=actor;
+Actor* Map::GetActor(const char* Name, int flags)
+{
+	if (!ActorIndexValid) {
+		IndexActors();
+	}
+	ieVariable key;
+	GetNameKey(key, Name);
+	Actor* const *actor = ActorNames.get(key);
+	if (!actor || !(*actor)->ValidTarget(flags)) {
+		return NULL;
 	}
+	return *actor;
+}
 
-	ret[j]=NULL;
-	return ret;
+static const unsigned int indexedStats[ACTOR_INDEX_STATS] = {
+	IE_EA, IE_GENERAL, IE_RACE, IE_SPECIFIC, IE_SEX, IE_ALIGNMENT
+};
+
+static int GetIndexSlot(unsigned int stat)
+{
+	for (int i = 0; i < ACTOR_INDEX_STATS; i++) {
+		if (indexedStats[i] == stat) {
+			return i;
+		}
+	}
+	return -1;
 }
 
+//the IDS matching only looks at the low byte of the alignment
+static inline int GetIndexKey(unsigned int stat, ieDword value)
+{
+	if (stat == IE_ALIGNMENT) {
+		return (int) (value & 255);
+	}
+	return (int) value;
+}
 
-Actor* Map::GetActor(const char* Name, int flags)
+//rebuilt lazily on the first lookup after the actors or their indexed
+//stats changed, the buckets keep the order GetActor(int) scans in
+void Map::IndexActors()
 {
-	size_t i = actors.size();
+	ActorNames.init(64, 32);
+	for (int s = 0; s < ACTOR_INDEX_STATS; s++) {
+		ActorStats[s].clear();
+	}
+
+	size_t i;
+	for (i = 0; i < actors.size(); i++) {
+		ieVariable key;
+		GetNameKey(key, actors[i]->GetScriptName());
+		ActorNames.set(key, actors[i]);
+	}
+	i = actors.size();
 	while (i--) {
-		Actor* actor = actors[i];
-		if (strnicmp( actor->GetScriptName(), Name, 32 ) == 0) {
-			if (!actor->ValidTarget(flags) ) {
-				return NULL;
-			}
-			return actor;
+		Actor *actor = actors[i];
+		for (int s = 0; s < ACTOR_INDEX_STATS; s++) {
+			int key = GetIndexKey(indexedStats[s], actor->GetSafeStat(indexedStats[s]));
+			ActorStats[s][key].push_back((unsigned int) i);
 		}
 	}
-	return NULL;
+	ActorIndexValid = true;
+}
+
+unsigned int Map::CountIndexedActors(unsigned int stat, int min, int max)
+{
+	int slot = GetIndexSlot(stat);
+	if (slot < 0) {
+		return (unsigned int) actors.size();
+	}
+	if (!ActorIndexValid) {
+		IndexActors();
+	}
+
+	unsigned int count = 0;
+	std::map< int, std::vector<unsigned int> >::const_iterator it = ActorStats[slot].lower_bound(min);
+	for (; it != ActorStats[slot].end() && it->first <= max; ++it) {
+		count += (unsigned int) it->second.size();
+	}
+	return count;
+}
+
+void Map::GetIndexedActors(unsigned int stat, int min, int max, std::vector<unsigned int> &found)
+{
+	int slot = GetIndexSlot(stat);
+	if (slot < 0) {
+		size_t i = actors.size();
+		while (i--) {
+			found.push_back((unsigned int) i);
+		}
+		return;
+	}
+	if (!ActorIndexValid) {
+		IndexActors();
+	}
+
+	bool merge = !found.empty();
+	int buckets = 0;
+	std::map< int, std::vector<unsigned int> >::const_iterator it = ActorStats[slot].lower_bound(min);
+	for (; it != ActorStats[slot].end() && it->first <= max; ++it) {
+		found.insert(found.end(), it->second.begin(), it->second.end());
+		buckets++;
+	}
+	//several buckets (or ranges) were collected, merge them back into scan order
+	if (merge || buckets > 1) {
+		std::sort(found.begin(), found.end(), std::greater<unsigned int>());
+	}
 }
 
 int Map::GetActorCount(bool any) const
@@ -1938,30 +2138,37 @@ Actor* Map::GetActorByScriptName(const char *name)
 	return NULL;
 }
 
-int Map::GetActorInRect(Actor**& actorlist, Region& rgn, bool onlyparty)
+int Map::GetActorInRect(std::vector<Actor*> &actorlist, const Region& rgn, bool onlyparty)
 {
-	actorlist = ( Actor * * ) malloc( actors.size() * sizeof( Actor * ) );
-	int count = 0;
-	size_t i = actors.size();
-	while (i--) {
-		Actor* actor = actors[i];
+	actorlist.clear();
+	if (ActorGrid.empty()) {
+		return 0;
+	}
+	unsigned int x1, y1, x2, y2;
+	GetGridRange(rgn, x1, y1, x2, y2);
+	for (unsigned int y = y1; y <= y2; y++) {
+		for (unsigned int x = x1; x <= x2; x++) {
+			const std::vector<Actor*> &cell = ActorGrid[y * GridWidth + x];
+			for (size_t i = 0; i < cell.size(); i++) {
+				Actor* actor = cell[i];
 //use this function only for party?
-		if (onlyparty && actor->GetStat(IE_EA)>EA_CHARMED) {
-			continue;
+				if (onlyparty && actor->GetStat(IE_EA)>EA_CHARMED) {
+					continue;
+				}
+				// this is called by non-selection code..
+				if (onlyparty && !actor->ValidTarget(GA_SELECT))
+					continue;
+				if (!actor->ValidTarget(GA_NO_DEAD|GA_NO_UNSCHEDULED))
+					continue;
+				if ((actor->Pos.x<rgn.x) || (actor->Pos.y<rgn.y))
+					continue;
+				if ((actor->Pos.x>rgn.x+rgn.w) || (actor->Pos.y>rgn.y+rgn.h) )
+					continue;
+				actorlist.push_back(actor);
+			}
 		}
-		// this is called by non-selection code..
-		if (onlyparty && !actor->ValidTarget(GA_SELECT))
-			continue;
-		if (!actor->ValidTarget(GA_NO_DEAD|GA_NO_UNSCHEDULED))
-			continue;
-		if ((actor->Pos.x<rgn.x) || (actor->Pos.y<rgn.y))
-			continue;
-		if ((actor->Pos.x>rgn.x+rgn.w) || (actor->Pos.y>rgn.y+rgn.h) )
-			continue;
-		actorlist[count++] = actor;
 	}
-	actorlist = ( Actor * * ) realloc( actorlist, count * sizeof( Actor * ) );
-	return count;
+	return (int) actorlist.size();
 }
 
 bool Map::SpawnsAlive() const
@@ -2050,9 +2257,39 @@ unsigned int Map::GetBlocked(const Point &c)
 //	1 - dither if polygon wants it
 //	2 - always dither
 
+bool SpriteCoverKey::operator<(const SpriteCoverKey &other) const
+{
+	if (worldx != other.worldx) return worldx < other.worldx;
+	if (worldy != other.worldy) return worldy < other.worldy;
+	if (XPos != other.XPos) return XPos < other.XPos;
+	if (YPos != other.YPos) return YPos < other.YPos;
+	if (Width != other.Width) return Width < other.Width;
+	if (Height != other.Height) return Height < other.Height;
+	if (flags != other.flags) return flags < other.flags;
+	return areaanim < other.areaanim;
+}
+
+//the returned cover is shared with anyone asking for the same one,
+//callers have to release it when done
 SpriteCover* Map::BuildSpriteCover(int x, int y, int xpos, int ypos,
 	unsigned int width, unsigned int height, int flags, bool areaanim)
 {
+	SpriteCoverKey key;
+	key.worldx = x;
+	key.worldy = y;
+	key.XPos = xpos;
+	key.YPos = ypos;
+	key.Width = width;
+	key.Height = height;
+	key.flags = flags;
+	key.areaanim = areaanim;
+
+	std::map<SpriteCoverKey, SpriteCover*>::iterator it = SpriteCovers.find(key);
+	if (it != SpriteCovers.end()) {
+		it->second->acquire();
+		return it->second;
+	}
+
 	SpriteCover* sc = new SpriteCover;
 	sc->worldx = x;
 	sc->worldy = y;
@@ -2060,10 +2297,9 @@ SpriteCover* Map::BuildSpriteCover(int x, int y, int xpos, int ypos,
 	sc->YPos = ypos;
 	sc->Width = width;
 	sc->Height = height;
+	sc->flags = flags;
 
 	Video* video = core->GetVideoDriver();
-	video->InitSpriteCover(sc, flags);
-
 	unsigned int wpcount = GetWallCount();
 	unsigned int i;
 
@@ -2074,12 +2310,39 @@ SpriteCover* Map::BuildSpriteCover(int x, int y, int xpos, int ypos,
 		if (!wp->PointCovered(x, y)) continue;
 		if (areaanim && !(wp->GetPolygonFlag() & WF_COVERANIMS)) continue;
 
+		//most sprites are not behind any wall, those get no mask at all
+		if (!sc->pixels) {
+			video->InitSpriteCover(sc, flags);
+		}
 		video->AddPolygonToSpriteCover(sc, wp);
 	}
 
+	//make room by dropping the covers only the cache still holds
+	if (SpriteCovers.size() >= SPRITECOVER_CACHE) {
+		it = SpriteCovers.begin();
+		while (it != SpriteCovers.end()) {
+			if (it->second->RefCount == 1) {
+				it->second->release();
+				SpriteCovers.erase(it++);
+			} else {
+				++it;
+			}
+		}
+	}
+	sc->acquire();
+	SpriteCovers[key] = sc;
 	return sc;
 }
 
+void Map::FlushSpriteCovers()
+{
+	std::map<SpriteCoverKey, SpriteCover*>::iterator it;
+	for (it = SpriteCovers.begin(); it != SpriteCovers.end(); ++it) {
+		it->second->release();
+	}
+	SpriteCovers.clear();
+}
+
 void Map::ActivateWallgroups(unsigned int baseindex, unsigned int count, int flg)
 {
 	unsigned int i;
@@ -2098,6 +2361,7 @@ void Map::ActivateWallgroups(unsigned int baseindex, unsigned int count, int flg
 			value|=WF_DISABLED;
 		wp->SetPolygonFlag(value);
 	}
+	FlushSpriteCovers();
 	//all actors will have to generate a new spritecover
 	i=(int) actors.size();
 	while(i--) {
@@ -2346,9 +2610,12 @@ void Map::RemoveActor(Actor* actor)
 			//path is invalid outside this area, but actions may be valid
 			actor->ClearPath();
 			ClearSearchMapFor(actor);
+			UnfileActor(actor);
+			DropFogCaster(actor);
 			actor->SetMap(NULL);
 			CopyResRef(actor->Area, "");
 			actors.erase( actors.begin()+i );
+			ActorIndexValid = false;
 			return;
 		}
 	}
@@ -2412,49 +2679,158 @@ void Map::dump(bool show_actors) const
 
 /******************************************************************************/
 
-void Map::Leveldown(unsigned int px, unsigned int py,
-	unsigned int& level, Point &n, unsigned int& diff)
+//pathfinder node states kept in MapSetNode (the low bits hold the parent direction)
+#define PN_DIRMASK   7
+#define PN_ROOT      8
+#define PN_CLOSED    16
+#define PN_BLOCKED   32
+
+//the eight neighbours of a searchmap cell, diagonal steps first
+static const int PathDirX[8] = { -1, 1, 1, -1, 0, 1, 0, -1 };
+static const int PathDirY[8] = { -1, -1, 1, 1, -1, 0, 1, 0 };
+
+//orders the open set heap so the lowest estimate is on top
+struct OpenNodeGreater {
+	bool operator()(const PathOpenNode &a, const PathOpenNode &b) const
+	{
+		if (a.estimate != b.estimate) {
+			return a.estimate > b.estimate;
+		}
+		//on ties prefer the node that got further
+		return a.cost < b.cost;
+	}
+};
+
+//octile distance estimate between two searchmap cells using the pathfind.2da
+//step costs: diagonal steps cost NormalCost, straight ones NormalCost+AdditionalCost
+//it never overestimates, so the first path found to the target is the cheapest
+static unsigned int PathHeuristic(const Point &a, const Point &b)
 {
-	int pos;
-	unsigned int nlevel;
+	int diagonal = NormalCost;
+	int straight = NormalCost + AdditionalCost;
+	if (diagonal <= 0 || straight <= 0) {
+		return 0;
+	}
+	int dx = abs(a.x - b.x);
+	int dy = abs(a.y - b.y);
+	int minor = std::min(dx, dy);
+	int major = std::max(dx, dy);
 
-	if (( px >= Width ) || ( py >= Height )) {
-		return;
-	} //walked off the map
-	pos = py * Width + px;
-	nlevel = MapSet[pos];
-	if (!nlevel) {
-		return;
-	} //not even considered
-	if (level <= nlevel) {
-		return;
+	if (diagonal <= straight) {
+		//zigzagging diagonally is never worse than walking straight
+		return diagonal * major;
 	}
-	unsigned int ndiff = level - nlevel;
-	if (ndiff > diff) {
-		level = nlevel;
-		diff = ndiff;
-		n.x = (ieWord) px;
-		n.y = (ieWord) py;
+	if (diagonal < 2 * straight) {
+		return diagonal * minor + straight * (major - minor);
 	}
+	return straight * (dx + dy);
 }
 
-void Map::SetupNode(unsigned int x, unsigned int y, unsigned int size, unsigned int Cost)
+//starts a new search from root; cells stamped by older searches count as unvisited,
+//so the search maps never need to be cleared
+void Map::BeginPathSearch(const Point &root)
 {
-	unsigned int pos;
+	if (!++SearchGen) {
+		memset(MapSetGen, 0, Width * Height * sizeof(ieDword));
+		SearchGen = 1;
+	}
+	OpenSet.clear();
 
-	if (( x >= Width ) || ( y >= Height )) {
+	if ((unsigned int) root.x >= Width || (unsigned int) root.y >= Height) {
 		return;
 	}
-	pos = y * Width + x;
-	if (MapSet[pos]) {
-		return;
+	unsigned int pos = root.y * Width + root.x;
+	MapSetGen[pos] = SearchGen;
+	MapSetNode[pos] = PN_ROOT;
+	MapSet[pos] = 0;
+
+	PathOpenNode node;
+	node.estimate = 0;
+	node.cost = 0;
+	node.pos = pos;
+	OpenSet.push_back(node);
+}
+
+//takes the most promising node off the open set and closes it
+bool Map::PopPathNode(unsigned int &pos)
+{
+	while (!OpenSet.empty()) {
+		std::pop_heap(OpenSet.begin(), OpenSet.end(), OpenNodeGreater());
+		unsigned int npos = OpenSet.back().pos;
+		OpenSet.pop_back();
+		//stale entry, the node was already reached by a cheaper route
+		if (MapSetNode[npos] & PN_CLOSED) {
+			continue;
+		}
+		MapSetNode[npos] |= PN_CLOSED;
+		pos = npos;
+		return true;
 	}
-	if (GetBlocked(x*16+8,y*12+6,size)) {
-		MapSet[pos] = 65535;
-		return;
+	return false;
+}
+
+//opens or improves the neighbours of a closed node; without a target the
+//search degrades to a plain cheapest-first flood
+void Map::ExpandPathNode(unsigned int pos, unsigned int size, const Point *target, unsigned int MaxCost)
+{
+	unsigned int x = pos % Width;
+	unsigned int y = pos / Width;
+
+	for (int i = 0; i < 8; i++) {
+		unsigned int nx = x + PathDirX[i];
+		unsigned int ny = y + PathDirY[i];
+		//this also catches stepping off the left and top edges
+		if (nx >= Width || ny >= Height) {
+			continue;
+		}
+		unsigned int Cost = MapSet[pos] + NormalCost;
+		if (i >= 4) {
+			Cost += AdditionalCost;
+		}
+		if (Cost > MaxCost) {
+			continue;
+		}
+		unsigned int npos = ny * Width + nx;
+		if (MapSetGen[npos] == SearchGen) {
+			if (MapSetNode[npos] & (PN_CLOSED|PN_BLOCKED)) {
+				continue;
+			}
+			if (MapSet[npos] <= Cost) {
+				continue;
+			}
+		} else {
+			MapSetGen[npos] = SearchGen;
+			if (GetBlocked(nx*16+8, ny*12+6, size)) {
+				MapSetNode[npos] = PN_BLOCKED;
+				continue;
+			}
+		}
+		MapSet[npos] = (unsigned short) Cost;
+		MapSetNode[npos] = (ieByte) i;
+
+		PathOpenNode node;
+		node.cost = Cost;
+		node.estimate = Cost;
+		if (target) {
+			node.estimate += PathHeuristic(Point(nx, ny), *target);
+		}
+		node.pos = npos;
+		OpenSet.push_back(node);
+		std::push_heap(OpenSet.begin(), OpenSet.end(), OpenNodeGreater());
 	}
-	MapSet[pos] = (ieWord) Cost;
-	InternalStack.push( ( x << 16 ) | y );
+}
+
+//returns false when p is the root of the last search
+bool Map::GetPathParent(const Point &p, Point &parent) const
+{
+	ieByte node = MapSetNode[p.y * Width + p.x];
+	if (node & PN_ROOT) {
+		return false;
+	}
+	int dir = node & PN_DIRMASK;
+	parent.x = (short) (p.x - PathDirX[dir]);
+	parent.y = (short) (p.y - PathDirY[dir]);
+	return true;
 }
 
 bool Map::AdjustPositionX(Point &goal, unsigned int radiusx, unsigned int radiusy)
@@ -2547,6 +2923,416 @@ void Map::AdjustPosition(Point &goal, unsigned int radiusx, unsigned int radiusy
 	}
 }
 
+static void FreePath(PathNode* path)
+{
+	while (path) {
+		PathNode* next = path->Next;
+		delete path;
+		path = next;
+	}
+}
+
+//passability of a searchmap cell ignoring creatures, which move too much to
+//be part of the sector graph
+bool Map::IsStaticPassable(unsigned int pos) const
+{
+	unsigned int value = SrchMap[pos] & PATH_MAP_NOTACTOR;
+	if (value & PATH_MAP_DOOR) {
+		return false;
+	}
+	return (value & PATH_MAP_PASSABLE) != 0;
+}
+
+//the sector graph (HPA* style): the searchmap is cut into square sectors, each
+//split into regions of connected cells, with portals where regions of neighbouring
+//sectors touch. Long paths are searched on this small graph and then refined
+//with the normal pathfinder between the portals.
+void Map::BuildPathSectors()
+{
+	PathSectorsDirty = false;
+	FlushSectorRoutes();
+	Portals.clear();
+	RegionPortals.clear();
+	//region 0 stands for blocked cells
+	RegionPortals.resize(1);
+
+	if (!PathRegions) {
+		PathRegions = (ieDword *) malloc(sizeof(ieDword) * Width * Height);
+	}
+	memset(PathRegions, 0, sizeof(ieDword) * Width * Height);
+
+	std::vector<unsigned int> stack;
+	for (unsigned int sy = 0; sy < Height; sy += PATH_SECTOR_SIZE) {
+		unsigned int maxy = std::min(sy + PATH_SECTOR_SIZE, Height);
+		for (unsigned int sx = 0; sx < Width; sx += PATH_SECTOR_SIZE) {
+			unsigned int maxx = std::min(sx + PATH_SECTOR_SIZE, Width);
+			for (unsigned int y = sy; y < maxy; y++) {
+				for (unsigned int x = sx; x < maxx; x++) {
+					unsigned int pos = y * Width + x;
+					if (PathRegions[pos] || !IsStaticPassable(pos)) {
+						continue;
+					}
+					//flood the new region, staying inside the sector
+					ieDword region = (ieDword) RegionPortals.size();
+					RegionPortals.resize(region + 1);
+					PathRegions[pos] = region;
+					stack.push_back(pos);
+					while (!stack.empty()) {
+						unsigned int cur = stack.back();
+						stack.pop_back();
+						unsigned int cx = cur % Width;
+						unsigned int cy = cur / Width;
+						for (int i = 0; i < 8; i++) {
+							unsigned int nx = cx + PathDirX[i];
+							unsigned int ny = cy + PathDirY[i];
+							if (nx < sx || nx >= maxx || ny < sy || ny >= maxy) {
+								continue;
+							}
+							unsigned int npos = ny * Width + nx;
+							if (PathRegions[npos] || !IsStaticPassable(npos)) {
+								continue;
+							}
+							PathRegions[npos] = region;
+							stack.push_back(npos);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	for (unsigned int x = PATH_SECTOR_SIZE - 1; x + 1 < Width; x += PATH_SECTOR_SIZE) {
+		AddBorderPortals(Point(x, 0), true);
+	}
+	for (unsigned int y = PATH_SECTOR_SIZE - 1; y + 1 < Height; y += PATH_SECTOR_SIZE) {
+		AddBorderPortals(Point(0, y), false);
+	}
+
+	for (size_t r = 1; r < RegionPortals.size(); r++) {
+		LinkRegionPortals((ieDword) r);
+	}
+}
+
+//portals of the same region can reach each other; the links cost the real
+//walk inside the region, since a straight line underestimates regions that
+//wind around walls and the route search would prefer detours through them
+void Map::LinkRegionPortals(ieDword region)
+{
+	const std::vector<unsigned int> &list = RegionPortals[region];
+	if (list.size() < 2) {
+		return;
+	}
+	const unsigned int unset = (unsigned int) -1;
+	const Point &origin = Portals[list[0]].pos;
+	unsigned int sx = origin.x - origin.x % PATH_SECTOR_SIZE;
+	unsigned int sy = origin.y - origin.y % PATH_SECTOR_SIZE;
+	unsigned int maxx = std::min(sx + PATH_SECTOR_SIZE, Width);
+	unsigned int maxy = std::min(sy + PATH_SECTOR_SIZE, Height);
+	//walking costs from the current portal, indexed inside the sector
+	unsigned int dist[PATH_SECTOR_SIZE * PATH_SECTOR_SIZE];
+	std::vector<PathOpenNode> open;
+	PathOpenNode node;
+
+	for (size_t i = 0; i + 1 < list.size(); i++) {
+		const Point &from = Portals[list[i]].pos;
+		std::fill(dist, dist + PATH_SECTOR_SIZE * PATH_SECTOR_SIZE, unset);
+		node.cost = 0;
+		node.estimate = 0;
+		node.pos = (from.y - sy) * PATH_SECTOR_SIZE + (from.x - sx);
+		dist[node.pos] = 0;
+		open.push_back(node);
+		//plain cheapest-first flood, the sector is small
+		while (!open.empty()) {
+			std::pop_heap(open.begin(), open.end(), OpenNodeGreater());
+			PathOpenNode cur = open.back();
+			open.pop_back();
+			if (cur.cost > dist[cur.pos]) {
+				continue;
+			}
+			unsigned int cx = sx + cur.pos % PATH_SECTOR_SIZE;
+			unsigned int cy = sy + cur.pos / PATH_SECTOR_SIZE;
+			for (int d = 0; d < 8; d++) {
+				unsigned int nx = cx + PathDirX[d];
+				unsigned int ny = cy + PathDirY[d];
+				if (nx < sx || nx >= maxx || ny < sy || ny >= maxy) {
+					continue;
+				}
+				if (PathRegions[ny * Width + nx] != region) {
+					continue;
+				}
+				unsigned int c = cur.cost + NormalCost;
+				if (d >= 4) {
+					c += AdditionalCost;
+				}
+				unsigned int local = (ny - sy) * PATH_SECTOR_SIZE + (nx - sx);
+				if (c >= dist[local]) {
+					continue;
+				}
+				dist[local] = c;
+				node.cost = c;
+				node.estimate = c;
+				node.pos = local;
+				open.push_back(node);
+				std::push_heap(open.begin(), open.end(), OpenNodeGreater());
+			}
+		}
+
+		for (size_t j = i + 1; j < list.size(); j++) {
+			const Point &to = Portals[list[j]].pos;
+			PathPortalLink link;
+			link.cost = dist[(to.y - sy) * PATH_SECTOR_SIZE + (to.x - sx)];
+			//the region was flooded the same way, so this can't happen
+			if (link.cost == unset) {
+				continue;
+			}
+			link.portal = list[j];
+			Portals[list[i]].links.push_back(link);
+			link.portal = list[i];
+			Portals[list[j]].links.push_back(link);
+		}
+	}
+}
+
+//walks the border between two rows or columns of sectors and puts a pair of
+//portals in the middle of each stretch where the same two regions touch
+void Map::AddBorderPortals(const Point &first, bool vertical)
+{
+	unsigned int length = vertical ? Height : Width;
+	unsigned int runStart = 0;
+	ieDword runA = 0, runB = 0;
+
+	for (unsigned int i = 0; i <= length; i++) {
+		ieDword ra = 0, rb = 0;
+		if (i < length) {
+			unsigned int pos;
+			if (vertical) {
+				pos = i * Width + first.x;
+				ra = PathRegions[pos];
+				rb = PathRegions[pos + 1];
+			} else {
+				pos = first.y * Width + i;
+				ra = PathRegions[pos];
+				rb = PathRegions[pos + Width];
+			}
+			if (!ra || !rb) {
+				ra = rb = 0;
+			}
+		}
+		if (runA && (ra != runA || rb != runB)) {
+			unsigned int mid = (runStart + i - 1) / 2;
+			if (vertical) {
+				AddSectorPortals(Point(first.x, mid), Point(first.x + 1, mid));
+			} else {
+				AddSectorPortals(Point(mid, first.y), Point(mid, first.y + 1));
+			}
+			runA = 0;
+		}
+		if (!runA && ra) {
+			runStart = i;
+			runA = ra;
+			runB = rb;
+		}
+	}
+}
+
+void Map::AddSectorPortals(const Point &a, const Point &b)
+{
+	unsigned int ia = (unsigned int) Portals.size();
+	unsigned int ib = ia + 1;
+	PathPortal portal;
+	PathPortalLink link;
+	link.cost = NormalCost + AdditionalCost;
+
+	portal.pos = a;
+	portal.region = PathRegions[a.y * Width + a.x];
+	link.portal = ib;
+	portal.links.push_back(link);
+	Portals.push_back(portal);
+	RegionPortals[portal.region].push_back(ia);
+
+	portal.pos = b;
+	portal.region = PathRegions[b.y * Width + b.x];
+	portal.links[0].portal = ia;
+	Portals.push_back(portal);
+	RegionPortals[portal.region].push_back(ib);
+}
+
+void Map::FlushSectorRoutes()
+{
+	const char* key;
+	void* route;
+	while (SectorRoutes.getLRU(0, key, route)) {
+		delete (PathRoute *) route;
+		SectorRoutes.Remove(key);
+	}
+}
+
+//A* on the sector graph; the start and goal cells are linked to the portals
+//of their regions, the route is returned as the sector entry cells
+bool Map::FindSectorRoute(const Point &start, const Point &goal, std::vector<Point> &waypoints)
+{
+	const unsigned int unset = (unsigned int) -1;
+	ieDword startRegion = PathRegions[start.y * Width + start.x];
+	ieDword goalRegion = PathRegions[goal.y * Width + goal.x];
+	//the goal is an extra node after the real portals
+	unsigned int target = (unsigned int) Portals.size();
+	std::vector<unsigned int> cost(target + 1, unset);
+	std::vector<unsigned int> parent(target + 1, unset);
+	std::vector<bool> closed(target + 1, false);
+	std::vector<PathOpenNode> open;
+	PathOpenNode node;
+
+	const std::vector<unsigned int> &first = RegionPortals[startRegion];
+	for (size_t i = 0; i < first.size(); i++) {
+		unsigned int idx = first[i];
+		cost[idx] = PathHeuristic(start, Portals[idx].pos);
+		node.cost = cost[idx];
+		node.estimate = node.cost + PathHeuristic(Portals[idx].pos, goal);
+		node.pos = idx;
+		open.push_back(node);
+	}
+	std::make_heap(open.begin(), open.end(), OpenNodeGreater());
+
+	while (!open.empty()) {
+		std::pop_heap(open.begin(), open.end(), OpenNodeGreater());
+		unsigned int idx = open.back().pos;
+		open.pop_back();
+		if (closed[idx]) {
+			continue;
+		}
+		closed[idx] = true;
+
+		if (idx == target) {
+			waypoints.clear();
+			//keep only the cells where the route enters a new sector
+			for (idx = parent[target]; parent[idx] != unset; idx = parent[idx]) {
+				if (Portals[parent[idx]].region != Portals[idx].region) {
+					waypoints.push_back(Portals[idx].pos);
+				}
+			}
+			std::reverse(waypoints.begin(), waypoints.end());
+			return true;
+		}
+
+		const PathPortal &portal = Portals[idx];
+		if (portal.region == goalRegion) {
+			unsigned int c = cost[idx] + PathHeuristic(portal.pos, goal);
+			if (c < cost[target]) {
+				cost[target] = c;
+				parent[target] = idx;
+				node.cost = c;
+				node.estimate = c;
+				node.pos = target;
+				open.push_back(node);
+				std::push_heap(open.begin(), open.end(), OpenNodeGreater());
+			}
+		}
+		for (size_t i = 0; i < portal.links.size(); i++) {
+			unsigned int next = portal.links[i].portal;
+			unsigned int c = cost[idx] + portal.links[i].cost;
+			if (closed[next] || c >= cost[next]) {
+				continue;
+			}
+			cost[next] = c;
+			parent[next] = idx;
+			node.cost = c;
+			node.estimate = c + PathHeuristic(Portals[next].pos, goal);
+			node.pos = next;
+			open.push_back(node);
+			std::push_heap(open.begin(), open.end(), OpenNodeGreater());
+		}
+	}
+	return false;
+}
+
+//returns NULL if the sector graph can't help, the caller should do a full search then
+PathNode* Map::FindSectorPath(const Point &s, const Point &d, unsigned int size)
+{
+	if (PathSectorsDirty) {
+		BuildPathSectors();
+	}
+
+	Point start( s.x/16, s.y/12 );
+	Point goal ( d.x/16, d.y/12 );
+	if ((unsigned int) start.x >= Width || (unsigned int) start.y >= Height) {
+		return NULL;
+	}
+	if ((unsigned int) goal.x >= Width || (unsigned int) goal.y >= Height) {
+		return NULL;
+	}
+	ieDword startRegion = PathRegions[start.y * Width + start.x];
+	ieDword goalRegion = PathRegions[goal.y * Width + goal.x];
+	if (!startRegion || !goalRegion || startRegion == goalRegion) {
+		return NULL;
+	}
+
+	char key[MAX_VARIABLE_LENGTH];
+	snprintf(key, sizeof(key), "%u:%u:%u", (unsigned int) startRegion, (unsigned int) goalRegion, size);
+	void* lookup;
+	PathRoute* route;
+	if (SectorRoutes.Lookup(key, lookup)) {
+		route = (PathRoute *) lookup;
+		SectorRoutes.Touch(key);
+	} else {
+		if (SectorRoutes.GetCount() >= MAX_SECTOR_ROUTES) {
+			const char* oldkey;
+			if (SectorRoutes.getLRU(0, oldkey, lookup)) {
+				delete (PathRoute *) lookup;
+				SectorRoutes.Remove(oldkey);
+			}
+		}
+		route = new PathRoute;
+		// no route could be a diagonal only connection between sectors, so
+		// this is left to the full search too
+		route->found = FindSectorRoute(start, goal, route->waypoints);
+		route->retryTime = 0;
+		SectorRoutes.SetAt(key, route);
+	}
+	ieDword gameTime = core->GetGame()->GameTime;
+	if (!route->found || gameTime < route->retryTime) {
+		return NULL;
+	}
+
+	// walk from sector to sector with the normal pathfinder
+	PathNode* Return = NULL;
+	PathNode* tail = NULL;
+	Point from = s;
+	for (size_t i = 0; i <= route->waypoints.size(); i++) {
+		Point to = d;
+		if (i < route->waypoints.size()) {
+			to.x = route->waypoints[i].x*16 + 8;
+			to.y = route->waypoints[i].y*12 + 6;
+		}
+		PathNode* segment = FindPathDirect( from, to, size );
+		if (!segment->Next && (from.x/16 != to.x/16 || from.y/12 != to.y/12)) {
+			// creatures in the way or too narrow passages for this size,
+			// creatures move and doors flush the routes, so try again later
+			route->retryTime = gameTime + SECTOR_ROUTE_RETRY;
+			FreePath( segment );
+			FreePath( Return );
+			return NULL;
+		}
+		if (!Return) {
+			Return = segment;
+		} else {
+			PathNode* next = segment->Next;
+			delete segment;
+			if (!next) {
+				continue;
+			}
+			tail->Next = next;
+			next->Parent = tail;
+		}
+		tail = Return;
+		while (tail->Next) {
+			tail = tail->Next;
+		}
+		from.x = tail->x*16 + 8;
+		from.y = tail->y*12 + 6;
+	}
+	return Return;
+}
+
 //run away from dX, dY (ie.: find the best path of limited length that brings us the farthest from dX, dY)
 PathNode* Map::RunAway(const Point &s, const Point &d, unsigned int size, unsigned int PathLen, int flags)
 {
@@ -2559,23 +3345,17 @@ PathNode* Map::RunAway(const Point &s, const Point &d, unsigned int size, unsign
 		PathLen = 65535;
 	}
 
-	memset( MapSet, 0, Width * Height * sizeof( unsigned short ) );
-	while (InternalStack.size())
-		InternalStack.pop();
-
 	if (!( GetBlocked( start.x, start.y) & PATH_MAP_PASSABLE )) {
 		AdjustPosition( start );
 	}
-	unsigned int pos = ( start.x << 16 ) | start.y;
-	InternalStack.push( pos );
-	MapSet[start.y * Width + start.x] = 1;
+	//there is no single target here, so this is a cheapest-first flood bounded by PathLen
+	BeginPathSearch( start );
 	dist = 0;
 	Point best = start;
-	while (InternalStack.size()) {
-		pos = InternalStack.front();
-		InternalStack.pop();
-		unsigned int x = pos >> 16;
-		unsigned int y = pos & 0xffff;
+	unsigned int pos;
+	while (PopPathNode( pos )) {
+		unsigned int x = pos % Width;
+		unsigned int y = pos / Width;
 		long tx = (long) x - goal.x;
 		long ty = (long) y - goal.y;
 		unsigned int distance = (unsigned int) std::sqrt( ( double ) ( tx* tx + ty* ty ) );
@@ -2585,20 +3365,10 @@ PathNode* Map::RunAway(const Point &s, const Point &d, unsigned int size, unsign
 			dist=distance;
 		}
 
-		unsigned int Cost = MapSet[y * Width + x] + NormalCost;
-		if (Cost > PathLen) {
+		if ((unsigned int) (MapSet[pos] + NormalCost) > PathLen) {
 			break;
 		}
-		SetupNode( x - 1, y - 1, size, Cost );
-		SetupNode( x + 1, y - 1, size, Cost );
-		SetupNode( x + 1, y + 1, size, Cost );
-		SetupNode( x - 1, y + 1, size, Cost );
-
-		Cost += AdditionalCost;
-		SetupNode( x, y - 1, size, Cost );
-		SetupNode( x + 1, y, size, Cost );
-		SetupNode( x, y + 1, size, Cost );
-		SetupNode( x - 1, y, size, Cost );
+		ExpandPathNode( pos, size, NULL, PathLen );
 	}
 
 	//find path backwards from best to start
@@ -2613,23 +3383,12 @@ PathNode* Map::RunAway(const Point &s, const Point &d, unsigned int size, unsign
 		StartNode->orient = GetOrient( best, start );
 	}
 	Point p = best;
-	unsigned int pos2 = start.y * Width + start.x;
-	while (( pos = p.y * Width + p.x ) != pos2) {
+	Point n;
+	while (GetPathParent( p, n )) {
 		Return = new PathNode;
 		StartNode->Parent = Return;
 		Return->Next = StartNode;
 		StartNode = Return;
-		unsigned int level = MapSet[pos];
-		unsigned int diff = 0;
-		Point n;
-		Leveldown( p.x, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y, level, n, diff );
-		Leveldown( p.x - 1, p.y, level, n, diff );
-		Leveldown( p.x, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y - 1, level, n, diff );
 		Return->x = n.x;
 		Return->y = n.y;
 
@@ -2639,9 +3398,6 @@ PathNode* Map::RunAway(const Point &s, const Point &d, unsigned int size, unsign
 			Return->orient = GetOrient( n, p );
 		}
 		p = n;
-		if (!diff) {
-			break;
-		}
 	}
 	Return->Parent = NULL;
 	return Return;
@@ -2651,9 +3407,6 @@ bool Map::TargetUnreachable(const Point &s, const Point &d, unsigned int size)
 {
 	Point start( s.x/16, s.y/12 );
 	Point goal ( d.x/16, d.y/12 );
-	memset( MapSet, 0, Width * Height * sizeof( unsigned short ) );
-	while (InternalStack.size())
-		InternalStack.pop();
 
 	if (GetBlocked( d.x, d.y, size )) {
 		return true;
@@ -2662,27 +3415,16 @@ bool Map::TargetUnreachable(const Point &s, const Point &d, unsigned int size)
 		return true;
 	}
 
-	unsigned int pos = ( goal.x << 16 ) | goal.y;
-	unsigned int pos2 = ( start.x << 16 ) | start.y;
-	InternalStack.push( pos );
-	MapSet[goal.y * Width + goal.x] = 1;
-
-	while (InternalStack.size() && pos!=pos2) {
-		pos = InternalStack.front();
-		InternalStack.pop();
-		unsigned int x = pos >> 16;
-		unsigned int y = pos & 0xffff;
-
-		SetupNode( x - 1, y - 1, size, 1 );
-		SetupNode( x + 1, y - 1, size, 1 );
-		SetupNode( x + 1, y + 1, size, 1 );
-		SetupNode( x - 1, y + 1, size, 1 );
-		SetupNode( x, y - 1, size, 1 );
-		SetupNode( x + 1, y, size, 1 );
-		SetupNode( x, y + 1, size, 1 );
-		SetupNode( x - 1, y, size, 1 );
+	BeginPathSearch( goal );
+	unsigned int pos;
+	unsigned int pos2 = start.y * Width + start.x;
+	while (PopPathNode( pos )) {
+		if (pos == pos2) {
+			return false;
+		}
+		ExpandPathNode( pos, size, &start );
 	}
-	return pos!=pos2;
+	return true;
 }
 
 /* Use this function when you target something by a straight line projectile (like a lightning bolt, arrow, etc)
@@ -2792,24 +3534,16 @@ PathNode* Map::FindPathNear(const Point &s, const Point &d, unsigned int size, u
 	Point goal ( d.x/16, d.y/12 );
 	Point orig_goal = goal;
 
-	// re-initialise the path finding structures
-	memset( MapSet, 0, Width * Height * sizeof( unsigned short ) );
-	while (InternalStack.size())
-		InternalStack.pop();
-
-	// set the start point in the path finding structures
-	unsigned int pos2 = ( goal.x << 16 ) | goal.y;
-	unsigned int pos = ( start.x << 16 ) | start.y;
-	InternalStack.push( pos );
-	MapSet[start.y * Width + start.x] = 1;
+	// start a new search from the start point, heading for the goal
+	BeginPathSearch( start );
 
+	unsigned int pos2 = goal.y * Width + goal.x;
+	unsigned int pos;
 	unsigned int squaredmindistance = MinDistance * MinDistance;
 	bool found_path = false;
-	while (InternalStack.size()) {
-		pos = InternalStack.front();
-		InternalStack.pop();
-		unsigned int x = pos >> 16;
-		unsigned int y = pos & 0xffff;
+	while (PopPathNode( pos )) {
+		unsigned int x = pos % Width;
+		unsigned int y = pos / Width;
 
 		if (pos == pos2) {
 			// we got all the way to the target!
@@ -2819,8 +3553,6 @@ PathNode* Map::FindPathNear(const Point &s, const Point &d, unsigned int size, u
 			/* check minimum distance:
 			 * as an obvious optimisation we only check squared distance: this is a
 			 * possible overestimate since the sqrt Distance() rounds down
-			 * (some other optimisations could be made here, but you'd be better off
-			 * fixing the pathfinder to do A* properly)
 			 * caller should have already done PersonalDistance adjustments, this is
 			 * simply between the specified points
 			 */
@@ -2840,24 +3572,7 @@ PathNode* Map::FindPathNear(const Point &s, const Point &d, unsigned int size, u
 			}
 		}
 
-		unsigned int Cost = MapSet[y * Width + x] + NormalCost;
-		if (Cost > 65500) {
-			// cost is far too high, no path found
-			break;
-		}
-
-		// diagonal movements
-		SetupNode( x - 1, y - 1, size, Cost );
-		SetupNode( x + 1, y - 1, size, Cost );
-		SetupNode( x + 1, y + 1, size, Cost );
-		SetupNode( x - 1, y + 1, size, Cost );
-
-		// direct movements
-		Cost += AdditionalCost;
-		SetupNode( x, y - 1, size, Cost );
-		SetupNode( x + 1, y, size, Cost );
-		SetupNode( x, y + 1, size, Cost );
-		SetupNode( x - 1, y, size, Cost );
+		ExpandPathNode( pos, size, &orig_goal );
 	}
 
 	// find path from goal to start
@@ -2885,22 +3600,8 @@ PathNode* Map::FindPathNear(const Point &s, const Point &d, unsigned int size, u
 		StartNode->orient = GetOrient( goal, start );
 	}
 	Point p = goal;
-	pos2 = start.y * Width + start.x;
-	while (( pos = p.y * Width + p.x ) != pos2) {
-		unsigned int level = MapSet[pos];
-		unsigned int diff = 0;
-		Point n;
-		Leveldown( p.x, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y, level, n, diff );
-		Leveldown( p.x - 1, p.y, level, n, diff );
-		Leveldown( p.x, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y - 1, level, n, diff );
-		if (!diff)
-			return Return;
-
+	Point n;
+	while (GetPathParent( p, n )) {
 		if (fixup_orient) {
 			// don't change orientation at end of path? this seems best
 			StartNode->orient = GetOrient( p, n );
@@ -2920,48 +3621,27 @@ PathNode* Map::FindPathNear(const Point &s, const Point &d, unsigned int size, u
 	return Return;
 }
 
-PathNode* Map::FindPath(const Point &s, const Point &d, unsigned int size, int MinDistance)
+PathNode* Map::FindPathDirect(const Point &s, const Point &d, unsigned int size)
 {
 	Point start( s.x/16, s.y/12 );
 	Point goal ( d.x/16, d.y/12 );
-	memset( MapSet, 0, Width * Height * sizeof( unsigned short ) );
-	while (InternalStack.size())
-		InternalStack.pop();
 
 	if (GetBlocked( d.x, d.y, size )) {
 		AdjustPosition( goal );
 	}
-	unsigned int pos = ( goal.x << 16 ) | goal.y;
-	unsigned int pos2 = ( start.x << 16 ) | start.y;
-	InternalStack.push( pos );
-	MapSet[goal.y * Width + goal.x] = 1;
-
-	while (InternalStack.size()) {
-		pos = InternalStack.front();
-		InternalStack.pop();
-		unsigned int x = pos >> 16;
-		unsigned int y = pos & 0xffff;
+	// search backwards from the goal, so the parent links lead from start to goal
+	BeginPathSearch( goal );
 
+	unsigned int pos;
+	unsigned int pos2 = start.y * Width + start.x;
+	bool found_path = false;
+	while (PopPathNode( pos )) {
 		if (pos == pos2) {
 			//We've found _a_ path
-			//print("GOAL!!!");
-			break;
-		}
-		unsigned int Cost = MapSet[y * Width + x] + NormalCost;
-		if (Cost > 65500) {
-			//print("Path not found!");
+			found_path = true;
 			break;
 		}
-		SetupNode( x - 1, y - 1, size, Cost );
-		SetupNode( x + 1, y - 1, size, Cost );
-		SetupNode( x + 1, y + 1, size, Cost );
-		SetupNode( x - 1, y + 1, size, Cost );
-
-		Cost += AdditionalCost;
-		SetupNode( x, y - 1, size, Cost );
-		SetupNode( x + 1, y, size, Cost );
-		SetupNode( x, y + 1, size, Cost );
-		SetupNode( x - 1, y, size, Cost );
+		ExpandPathNode( pos, size, &start );
 	}
 
 	//find path from start to goal
@@ -2972,34 +3652,40 @@ PathNode* Map::FindPath(const Point &s, const Point &d, unsigned int size, int M
 	StartNode->x = start.x;
 	StartNode->y = start.y;
 	StartNode->orient = GetOrient( goal, start );
-	if (pos != pos2) {
+	if (!found_path) {
 		return Return;
 	}
 	Point p = start;
-	pos2 = goal.y * Width + goal.x;
-	while (( pos = p.y * Width + p.x ) != pos2) {
+	Point n;
+	while (GetPathParent( p, n )) {
 		StartNode->Next = new PathNode;
 		StartNode->Next->Parent = StartNode;
 		StartNode = StartNode->Next;
 		StartNode->Next = NULL;
-		unsigned int level = MapSet[pos];
-		unsigned int diff = 0;
-		Point n;
-		Leveldown( p.x, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y, level, n, diff );
-		Leveldown( p.x - 1, p.y, level, n, diff );
-		Leveldown( p.x, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y + 1, level, n, diff );
-		Leveldown( p.x + 1, p.y - 1, level, n, diff );
-		Leveldown( p.x - 1, p.y - 1, level, n, diff );
-		if (!diff)
-			return Return;
 		StartNode->x = n.x;
 		StartNode->y = n.y;
 		StartNode->orient = GetOrient( n, p );
 		p = n;
 	}
+	return Return;
+}
+
+PathNode* Map::FindPath(const Point &s, const Point &d, unsigned int size, int MinDistance)
+{
+	PathNode* Return = NULL;
+	// long trips are planned on the sector graph first and then walked piecewise
+	int sectorsx = abs(s.x/16 - d.x/16) / PATH_SECTOR_SIZE;
+	int sectorsy = abs(s.y/12 - d.y/12) / PATH_SECTOR_SIZE;
+	if (sectorsx > 1 || sectorsy > 1) {
+		Return = FindSectorPath( s, d, size );
+	}
+	if (!Return) {
+		Return = FindPathDirect( s, d, size );
+	}
+	PathNode* StartNode = Return;
+	while (StartNode->Next) {
+		StartNode = StartNode->Next;
+	}
 	//stepping back on the calculated path
 	if (MinDistance) {
 		while (StartNode->Parent) {
@@ -3042,61 +3728,102 @@ bool Map::IsVisible(const Point &pos, int explored)
 }
 
 //point a is visible from point b (searchmap)
-bool Map::IsVisibleLOS(const Point &s, const Point &d)
+void Map::UpdateSightMap(unsigned int pos, unsigned short value)
 {
-	int sX=s.x/16;
-	int sY=s.y/12;
-	int dX=d.x/16;
-	int dY=d.y/12;
-	int diffx = sX - dX;
-	int diffy = sY - dY;
-
-	// we basically draw a 'line' from (sX, sY) to (dX, dY)
-	// we want to move along the larger axis, to make sure we don't miss anything
-	if (abs( diffx ) >= abs( diffy )) {
-		// (sX - startX)/elevationy = (sX - startX)/fabs(diffx) * diffy
-		double elevationy = std::fabs((double)diffx ) / diffy;
-		if (sX > dX) {
-			// right to left
-			for (int startx = sX; startx >= dX; startx--) {
-				// sX - startx >= 0, so subtract (due to sign of diffy)
-				//if (GetBlocked( startx, sY - ( int ) ( ( sX - startx ) / elevationy ) ) & PATH_MAP_NO_SEE)
-				if (GetBlocked( startx, sY - ( int ) ( ( sX - startx ) / elevationy ) ) & PATH_MAP_SIDEWALL)
-					return false;
+	// the same cells GetBlocked reports as sidewalls
+	if (value & (PATH_MAP_SIDEWALL|PATH_MAP_DOOR_OPAQUE)) {
+		SightMap[pos>>5] |= 1u<<(pos&31);
+	} else {
+		SightMap[pos>>5] &= ~(1u<<(pos&31));
+	}
+}
+
+bool Map::BlocksSight(int x, int y) const
+{
+	if ((unsigned) x >= Width || (unsigned) y >= Height) {
+		return false;
+	}
+	unsigned int pos = y * Width + x;
+	return (SightMap[pos>>5] & (1u<<(pos&31))) != 0;
+}
+
+// we basically draw a 'line' from (sX, sY) to (dX, dY), moving along the
+// larger axis to make sure we don't miss anything; the other coordinate
+// is truncated towards the start point
+bool Map::WalkSightLine(int sX, int sY, int dX, int dY) const
+{
+	int diffx = dX - sX;
+	int diffy = dY - sY;
+	int stepx = diffx < 0 ? -1 : 1;
+	int stepy = diffy < 0 ? -1 : 1;
+	int adx = abs(diffx);
+	int ady = abs(diffy);
+	int acc = 0;
+
+	if (adx >= ady) {
+		int y = sY;
+		for (int x = sX; ; x += stepx) {
+			if (BlocksSight(x, y)) {
+				return false;
 			}
-		} else {
-			// left to right
-			for (int startx = sX; startx <= dX; startx++) {
-				// sX - startx <= 0, so add (due to sign of diffy)
-				//if (GetBlocked( startx, sY + ( int ) ( ( sX - startx ) / elevationy ) ) & PATH_MAP_NO_SEE)
-				if (GetBlocked( startx, sY + ( int ) ( ( sX - startx ) / elevationy ) ) & PATH_MAP_SIDEWALL)
-					return false;
+			if (x == dX) break;
+			acc += ady;
+			if (acc >= adx) {
+				acc -= adx;
+				y += stepy;
 			}
 		}
 	} else {
-		// (sY - startY)/elevationx = (sY - startY)/fabs(diffy) * diffx
-		double elevationx = std::fabs((double)diffy ) / diffx;
-		if (sY > dY) {
-			// bottom to top
-			for (int starty = sY; starty >= dY; starty--) {
-				// sY - starty >= 0, so subtract (due to sign of diffx)
-				//if (GetBlocked( sX - ( int ) ( ( sY - starty ) / elevationx ), starty ) & PATH_MAP_NO_SEE)
-				if (GetBlocked( sX - ( int ) ( ( sY - starty ) / elevationx ), starty ) & PATH_MAP_SIDEWALL)
-					return false;
+		int x = sX;
+		for (int y = sY; ; y += stepy) {
+			if (BlocksSight(x, y)) {
+				return false;
 			}
-		} else {
-			// top to bottom
-			for (int starty = sY; starty <= dY; starty++) {
-				// sY - starty <= 0, so add (due to sign of diffx)
-				//if (GetBlocked( sX + ( int ) ( ( sY - starty ) / elevationx ), starty ) & PATH_MAP_NO_SEE)
-				if (GetBlocked( sX + ( int ) ( ( sY - starty ) / elevationx ), starty ) & PATH_MAP_SIDEWALL)
-					return false;
+			if (y == dY) break;
+			acc += adx;
+			if (acc >= ady) {
+				acc -= ady;
+				x += stepx;
 			}
 		}
 	}
 	return true;
 }
 
+bool Map::IsVisibleLOS(const Point &s, const Point &d)
+{
+	int sX=s.x/16;
+	int sY=s.y/12;
+	int dX=d.x/16;
+	int dY=d.y/12;
+
+	if (sX == dX && sY == dY) {
+		return true;
+	}
+	// always walk in the same direction, so the answer is symmetric
+	if (sY > dY || (sY == dY && sX > dX)) {
+		std::swap(sX, dX);
+		std::swap(sY, dY);
+	}
+	if ((unsigned) sX >= Width || (unsigned) sY >= Height ||
+		(unsigned) dX >= Width || (unsigned) dY >= Height) {
+		return WalkSightLine(sX, sY, dX, dY);
+	}
+
+	// the walls only change with the doors, so the results stay valid
+	// across ticks until SightEpoch moves on
+	unsigned int from = sY * Width + sX;
+	unsigned int to = dY * Width + dX;
+	LOSCacheEntry &entry = LOSCache[(from * 31 + to) & (LOS_CACHE_SIZE - 1)];
+	if (entry.from != from || entry.to != to || entry.SightEpoch != SightEpoch) {
+		entry.from = from;
+		entry.to = to;
+		entry.SightEpoch = SightEpoch;
+		entry.visible = WalkSightLine(sX, sY, dX, dY);
+	}
+	return entry.visible;
+}
+
 //returns direction of area boundary, returns -1 if it isn't a boundary
 int Map::WhichEdge(const Point &s)
 {
@@ -3356,38 +4083,54 @@ int Map::GetExploredMapSize() const
 void Map::Explore(int setreset)
 {
 	memset (ExploredBitmap, setreset, GetExploredMapSize() );
+	// the visible cells have to stay explored
+	FogStale = true;
 }
 
 void Map::SetMapVisibility(int setreset)
 {
 	memset( VisibleBitmap, setreset, GetExploredMapSize() );
+	FogStale = true;
 }
 
 // x, y are not in tile coordinates
-void Map::ExploreTile(const Point &pos)
+int Map::GetFogCell(const Point &pos) const
 {
 	int h = TMap->YCellCount * 2 + LargeFog;
 	int y = pos.y/32;
 	if (y < 0 || y >= h)
-		return;
+		return -1;
 
 	int w = TMap->XCellCount * 2 + LargeFog;
 	int x = pos.x/32;
 	if (x < 0 || x >= w)
+		return -1;
+
+	return (y * w) + x;
+}
+
+// x, y are not in tile coordinates
+void Map::ExploreTile(const Point &pos)
+{
+	int b0 = GetFogCell(pos);
+	if (b0 < 0)
 		return;
 
-	int b0 = (y * w) + x;
 	int by = b0/8;
 	int bi = 1<<(b0%8);
 
 	ExploredBitmap[by] |= bi;
 	VisibleBitmap[by] |= bi;
+	// not backed by an explorer, the next fog update takes it back
+	FogStale = true;
 }
 
-void Map::ExploreMapChunk(const Point &Pos, int range, int los)
+// collects the fog cells seen from Pos, without duplicates
+void Map::CastVisibility(const Point &Pos, int range, int los, std::vector<unsigned int> &cells)
 {
 	Point Tile;
 
+	cells.clear();
 	if (range>MaxVisibility) {
 		range=MaxVisibility;
 	}
@@ -3417,35 +4160,157 @@ void Map::ExploreMapChunk(const Point &Pos, int range, int los)
 					if (!Pass) break;
 				}
 			}
-			ExploreTile(Tile);
+			int cell = GetFogCell(Tile);
+			if (cell >= 0) {
+				cells.push_back(cell);
+			}
+		}
+	}
+	// neighbouring rays cross the same cells over and over
+	std::sort(cells.begin(), cells.end());
+	cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+}
+
+void Map::ExploreMapChunk(const Point &Pos, int range, int los)
+{
+	CastVisibility(Pos, range, los, FogCells);
+	for (size_t i = 0; i < FogCells.size(); i++) {
+		int by = FogCells[i]/8;
+		int bi = 1<<(FogCells[i]%8);
+
+		ExploredBitmap[by] |= bi;
+		VisibleBitmap[by] |= bi;
+	}
+	FogStale = true;
+}
+
+void Map::ShowFogCells(const std::vector<unsigned int> &cells)
+{
+	for (size_t i = 0; i < cells.size(); i++) {
+		unsigned int cell = cells[i];
+		if (VisibleCount[cell]++) {
+			continue;
+		}
+		int bi = 1<<(cell%8);
+		ExploredBitmap[cell/8] |= bi;
+		VisibleBitmap[cell/8] |= bi;
+	}
+}
+
+void Map::HideFogCells(const std::vector<unsigned int> &cells)
+{
+	for (size_t i = 0; i < cells.size(); i++) {
+		unsigned int cell = cells[i];
+		if (--VisibleCount[cell]) {
+			continue;
+		}
+		VisibleBitmap[cell/8] &= ~(1<<(cell%8));
+	}
+}
+
+// recasts the vision of an actor only if it moved, its range changed or a
+// door changed the line of sight since the last cast
+void Map::CastFog(Actor *actor, int range)
+{
+	std::map<Actor*, FogCaster>::iterator it = FogCasters.find(actor);
+	if (it == FogCasters.end()) {
+		it = FogCasters.insert(std::make_pair(actor, FogCaster())).first;
+	} else {
+		FogCaster &caster = it->second;
+		if (caster.Pos == actor->Pos && caster.Range == range && caster.SightEpoch == SightEpoch) {
+			return;
+		}
+		HideFogCells(caster.Cells);
+	}
+
+	FogCaster &caster = it->second;
+	caster.Pos = actor->Pos;
+	caster.Range = range;
+	caster.SightEpoch = SightEpoch;
+	CastVisibility(actor->Pos, range, 1, caster.Cells);
+	ShowFogCells(caster.Cells);
+}
+
+void Map::DropFogCaster(Actor *actor)
+{
+	if (FogCasters.empty()) {
+		return;
+	}
+	std::map<Actor*, FogCaster>::iterator it = FogCasters.find(actor);
+	if (it == FogCasters.end()) {
+		return;
+	}
+	HideFogCells(it->second.Cells);
+	FogCasters.erase(it);
+}
+
+void Map::ClearFogCasters()
+{
+	if (FogCasters.empty()) {
+		return;
+	}
+	FogCasters.clear();
+	int w = TMap->XCellCount * 2 + LargeFog;
+	int h = TMap->YCellCount * 2 + LargeFog;
+	memset(VisibleCount, 0, w * h * sizeof(ieWord));
+	FogStale = true;
+}
+
+// makes VisibleBitmap match the counters again, dropping transient reveals
+void Map::RebuildVisibility()
+{
+	int cells = (TMap->XCellCount * 2 + LargeFog) * (TMap->YCellCount * 2 + LargeFog);
+	memset(VisibleBitmap, 0, GetExploredMapSize());
+	for (int i = 0; i < cells; i++) {
+		if (VisibleCount[i]) {
+			int bi = 1<<(i%8);
+			ExploredBitmap[i/8] |= bi;
+			VisibleBitmap[i/8] |= bi;
 		}
 	}
+	FogStale = false;
 }
 
 void Map::UpdateFog()
 {
-	if (!(core->FogOfWar&FOG_DRAWFOG) ) {
+	bool drawfog = (core->FogOfWar&FOG_DRAWFOG) != 0;
+
+	if (!drawfog) {
+		ClearFogCasters();
 		SetMapVisibility( -1 );
 		Explore(-1);
-	} else {
-		SetMapVisibility( 0 );
+	} else if (!VisibleCount) {
+		int w = TMap->XCellCount * 2 + LargeFog;
+		int h = TMap->YCellCount * 2 + LargeFog;
+		VisibleCount = (ieWord *) calloc(w * h, sizeof(ieWord));
+		FogStale = true;
 	}
 
 	for (unsigned int e = 0; e<actors.size(); e++) {
 		Actor *actor = actors[e];
-		if (!actor->Modified[ IE_EXPLORE ] ) continue;
-		if (core->FogOfWar&FOG_DRAWFOG) {
+		if (!actor->Modified[ IE_EXPLORE ] ) {
+			DropFogCaster(actor);
+			continue;
+		}
+		if (drawfog) {
 			int state = actor->Modified[IE_STATE_ID];
-			if (state & STATE_CANTSEE) continue;
+			if (state & STATE_CANTSEE) {
+				DropFogCaster(actor);
+				continue;
+			}
 			int vis2 = actor->Modified[IE_VISUALRANGE];
 			if ((state&STATE_BLIND) || (vis2<2)) vis2=2; //can see only themselves
-			ExploreMapChunk (actor->Pos, vis2+actor->GetAnims()->GetCircleSize(), 1);
+			CastFog(actor, vis2+actor->GetAnims()->GetCircleSize());
 		}
 		Spawn *sp = GetSpawnRadius(actor->Pos, SPAWN_RANGE); //30 * 12
 		if (sp) {
 			TriggerSpawn(sp);
 		}
 	}
+
+	if (drawfog && FogStale) {
+		RebuildVisibility();
+	}
 }
 
 //Valid values are - PATH_MAP_FREE, PATH_MAP_PC, PATH_MAP_NPC
@@ -3888,7 +4753,7 @@ AreaAnimation::~AreaAnimation()
 	gamedata->FreePalette(palette, PaletteRef);
 	if (covers) {
 		for(int i=0;i<animcount;i++) {
-			delete covers[i];
+			if (covers[i]) covers[i]->release();
 		}
 		free (covers);
 	}
@@ -4035,7 +4900,7 @@ void AreaAnimation::Draw(const Region &screen, Map *area)
 		Sprite2D *frame = anim->NextFrame();
 		if(covers) {
 			if(!covers[ac] || !covers[ac]->Covers(Pos.x, Pos.y + height, frame->XPos, frame->YPos, frame->Width, frame->Height)) {
-				delete covers[ac];
+				if (covers[ac]) covers[ac]->release();
 				covers[ac] = area->BuildSpriteCover(Pos.x, Pos.y + height, -anim->animArea.x,
 					-anim->animArea.y, anim->animArea.w, anim->animArea.h, 0, true);
 			}
@@ -4104,6 +4969,15 @@ void Map::SetInternalSearchMap(int x, int y, int value)
 	if ((unsigned)x >= Width || (unsigned)y >= Height) {
 		return;
 	}
+	// doors opening or closing change the sector graph
+	if ((SrchMap[x+y*Width] ^ value) & PATH_MAP_NOTACTOR) {
+		PathSectorsDirty = true;
+	}
+	// and what the explorers can see
+	if ((SrchMap[x+y*Width] ^ value) & PATH_MAP_SIGHTMASK) {
+		SightEpoch++;
+		UpdateSightMap(x+y*Width, value);
+	}
 	SrchMap[x+y*Width] = value;
 }
 
@@ -23,12 +23,15 @@
 
 #include "exports.h"
 #include "globals.h"
+#include "ie_stats.h"
 
 #include "Interface.h"
+#include "LRUCache.h"
+#include "PathFinder.h"
+#include "StringMap.h"
 #include "Scriptable/Scriptable.h"
 
 #include <algorithm>
-#include <queue>
 
 namespace GemRB {
 
@@ -44,7 +47,6 @@ class IniSpawn;
 class MapReverb;
 class Palette;
 class Particles;
-struct PathNode;
 class Projectile;
 class ScriptedAnimation;
 class SpriteCover;
@@ -55,6 +57,12 @@ class Wall_Polygon;
 //distance of actors from spawn point
 #define SPAWN_RANGE       400
 
+//sprite covers kept around when nothing uses them
+#define SPRITECOVER_CACHE 256
+
+//actor stats indexed for IDS targeting, see Map::IsIndexedStat
+#define ACTOR_INDEX_STATS 6
+
 //spawn flags
 #define SPF_NOSPAWN		0x0001	//if set don't span if WAIT is set
 #define SPF_ONCE		0x0002	//only spawn a single time
@@ -144,6 +152,24 @@ struct Entrance {
 	ieWord Face;
 };
 
+//the last vision cast of an exploring actor
+struct FogCaster {
+	Point Pos;
+	int Range;
+	ieDword SightEpoch;
+	std::vector<unsigned int> Cells; //fog cells it sees, each only once
+};
+
+//what a sprite cover was built for
+struct SpriteCoverKey {
+	int worldx, worldy;
+	int XPos, YPos, Width, Height;
+	int flags;
+	bool areaanim;
+
+	bool operator<(const SpriteCoverKey &other) const;
+};
+
 class MapNote {
 	void swap(MapNote& mn) {
 		if (&mn == this) return;
@@ -278,6 +304,9 @@ private:
 
 enum AnimationObjectType {AOT_AREA, AOT_SCRIPTED, AOT_ACTOR, AOT_SPARK, AOT_PROJECTILE, AOT_PILE};
 
+//size of the actor grid cells (in pixels) used for proximity searches
+#define ACTOR_GRID_CELL   128
+
 //i believe we need only the active actors/visible inactive actors queues
 #define QUEUE_COUNT 2
 
@@ -319,13 +348,36 @@ private:
 	ieStrRef trackString;
 	int trackFlag;
 	ieWord trackDiff;
-	unsigned short* MapSet;
+	unsigned short* MapSet; //pathfinder: cost of the cheapest known route to each cell
+	ieDword* MapSetGen; //pathfinder: search generation that last touched each cell
+	ieByte* MapSetNode; //pathfinder: parent direction and node state of each cell
+	ieDword SearchGen; //pathfinder: generation of the running search
+	std::vector<PathOpenNode> OpenSet; //pathfinder: open set, reused between searches
+	ieDword* PathRegions; //sector region of each searchmap cell (0 is blocked)
+	std::vector<PathPortal> Portals; //sector graph nodes
+	std::vector< std::vector<unsigned int> > RegionPortals; //portals of each region
+	bool PathSectorsDirty; //static passability changed, the sector graph is stale
+	LRUCache SectorRoutes; //recent region to region routes (PathRoute)
 	unsigned short* SrchMap; //internal searchmap
 	unsigned short* MaterialMap;
-	std::queue< unsigned int> InternalStack;
 	unsigned int Width, Height;
 	std::list< AreaAnimation*> animations;
 	std::vector< Actor*> actors;
+	std::vector< std::vector< Actor*> > ActorGrid; //actors filed by position
+	unsigned int GridWidth, GridHeight;
+	unsigned int GridMaxSize; //the biggest actor filed, widens the searches
+	std::vector< Actor*> NearActors; //reused by ClearSearchMapFor
+	ieWord* VisibleCount; //number of exploring actors seeing each fog cell
+	std::map< Actor*, FogCaster> FogCasters;
+	ieDword SightEpoch; //bumped when doors change what blocks sight
+	ieDword* SightMap; //one bit per searchmap cell that blocks line of sight
+	LOSCacheEntry LOSCache[LOS_CACHE_SIZE];
+	bool FogStale; //VisibleBitmap was changed behind the counters' back
+	std::vector< unsigned int> FogCells; //reused by ExploreMapChunk
+	std::map< SpriteCoverKey, SpriteCover*> SpriteCovers;
+	bool ActorIndexValid; //the indexes below match the actors
+	HashMap<std::string, Actor*> ActorNames; //the last actor with each script name
+	std::map< int, std::vector<unsigned int> > ActorStats[ACTOR_INDEX_STATS]; //actor indices by stat value
 	Wall_Polygon **Walls;
 	unsigned int WallCount;
 	std::list< VEFObject*> vvcCells;
@@ -386,9 +438,11 @@ public:
 	{
 		WallCount = count;
 		Walls = walls;
+		FlushSpriteCovers();
 	}
 	SpriteCover* BuildSpriteCover(int x, int y, int xpos, int ypos,
 		unsigned int width, unsigned int height, int flag, bool areaanim = false);
+	void FlushSpriteCovers();
 	void ActivateWallgroups(unsigned int baseindex, unsigned int count, int flg);
 	void Shout(Actor* actor, int shoutID, unsigned int radius);
 	void ActorSpottedByPlayer(Actor *actor);
@@ -409,9 +463,26 @@ public:
 	Actor* GetActorByGlobalID(ieDword objectID);
 	Actor* GetActor(const Point &p, int flags);
 	Actor* GetActorInRadius(const Point &p, int flags, unsigned int radius);
-	Actor **GetAllActorsInRadius(const Point &p, int flags, unsigned int radius, Scriptable *see=NULL);
+	//fills neighbours (cleared first) and returns their count
+	int GetAllActorsInRadius(std::vector<Actor*> &neighbours, const Point &p, int flags, unsigned int radius, Scriptable *see=NULL);
 	Actor* GetActor(const char* Name, int flags);
 	Actor* GetActor(int i, bool any);
+	/* the stats that IDS targeting can look up in an index */
+	static bool IsIndexedStat(unsigned int stat)
+	{
+		switch (stat) {
+			case IE_EA: case IE_GENERAL: case IE_RACE:
+			case IE_SPECIFIC: case IE_SEX: case IE_ALIGNMENT:
+				return true;
+		}
+		return false;
+	}
+	/* call when a script name or an indexed stat of an actor changed */
+	void InvalidateActorIndex() { ActorIndexValid = false; }
+	//number of actors with the indexed stat in [min, max]
+	unsigned int CountIndexedActors(unsigned int stat, int min, int max);
+	//adds the indices (as for GetActor) of those actors to found, keeping it sorted from the last one
+	void GetIndexedActors(unsigned int stat, int min, int max, std::vector<unsigned int> &found);
 	Scriptable* GetActorByDialog(const char* resref);
 	Scriptable* GetItemByDialog(ieResRef resref);
 	Actor* GetActorByResource(const char* resref);
@@ -420,7 +491,9 @@ public:
 	bool SpawnsAlive() const;
 	void RemoveActor(Actor* actor);
 	//returns actors in rect (onlyparty could be more sophisticated)
-	int GetActorInRect(Actor**& actors, Region& rgn, bool onlyparty);
+	int GetActorInRect(std::vector<Actor*> &actorlist, const Region& rgn, bool onlyparty);
+	//refiles the actor in the actor grid after it moved
+	void UpdateActorCell(Actor *actor);
 	int GetActorCount(bool any) const;
 	//fix actors position if required
 	void JumpActors(bool jump);
@@ -570,9 +643,36 @@ private:
 	void SortQueues();
 	//Actor* GetRoot(int priority, int &index);
 	void DeleteActor(int i);
-	void Leveldown(unsigned int px, unsigned int py, unsigned int& level,
-		Point &p, unsigned int& diff);
-	void SetupNode(unsigned int x, unsigned int y, unsigned int size, unsigned int Cost);
+	unsigned int GetGridCell(const Point &p) const;
+	void GetGridRange(const Region &rgn, unsigned int &x1, unsigned int &y1, unsigned int &x2, unsigned int &y2) const;
+	void FileActor(Actor *actor);
+	void UnfileActor(Actor *actor);
+	void IndexActors();
+	int GetFogCell(const Point &pos) const;
+	void CastVisibility(const Point &Pos, int range, int los, std::vector<unsigned int> &cells);
+	void ShowFogCells(const std::vector<unsigned int> &cells);
+	void HideFogCells(const std::vector<unsigned int> &cells);
+	void CastFog(Actor *actor, int range);
+	void DropFogCaster(Actor *actor);
+	void ClearFogCasters();
+	void RebuildVisibility();
+	void UpdateSightMap(unsigned int pos, unsigned short value);
+	bool BlocksSight(int x, int y) const;
+	bool WalkSightLine(int sX, int sY, int dX, int dY) const;
+	void BeginPathSearch(const Point &root);
+	bool PopPathNode(unsigned int &pos);
+	void ExpandPathNode(unsigned int pos, unsigned int size, const Point *target, unsigned int MaxCost = 65500);
+	bool GetPathParent(const Point &p, Point &parent) const;
+	PathNode* FindPathDirect(const Point &s, const Point &d, unsigned int size);
+	//hierarchical pathfinder
+	bool IsStaticPassable(unsigned int pos) const;
+	void BuildPathSectors();
+	void AddBorderPortals(const Point &first, bool vertical);
+	void AddSectorPortals(const Point &a, const Point &b);
+	void LinkRegionPortals(ieDword region);
+	void FlushSectorRoutes();
+	bool FindSectorRoute(const Point &start, const Point &goal, std::vector<Point> &waypoints);
+	PathNode* FindSectorPath(const Point &s, const Point &d, unsigned int size);
 	//actor uses travel region
 	void UseExit(Actor *pc, InfoPoint *ip);
 	//separated position adjustment, so their order could be randomised */
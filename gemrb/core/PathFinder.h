@@ -20,8 +20,21 @@
 #ifndef PATHFINDER_H
 #define PATHFINDER_H
 
+#include "Region.h"
+
+#include <vector>
+
 namespace GemRB {
 
+//size of the square searchmap cell clusters used by the hierarchical pathfinder
+#define PATH_SECTOR_SIZE 16
+//number of sector routes remembered per area
+#define MAX_SECTOR_ROUTES 64
+//number of line of sight results remembered per area (power of 2)
+#define LOS_CACHE_SIZE 1024
+//game ticks before a route the local pathfinder couldn't follow is tried again
+#define SECTOR_ROUTE_RETRY AI_UPDATE_TIME
+
 //searchmap conversion bits
 
 enum {
@@ -40,7 +53,8 @@ enum {
 	PATH_MAP_DOOR = (PATH_MAP_DOOR_OPAQUE|PATH_MAP_DOOR_IMPASSABLE),
 	PATH_MAP_NOTAREA = (PATH_MAP_ACTOR|PATH_MAP_DOOR),
 	PATH_MAP_NOTDOOR = (PATH_MAP_ACTOR|PATH_MAP_AREAMASK),
-	PATH_MAP_NOTACTOR = (PATH_MAP_DOOR|PATH_MAP_AREAMASK)
+	PATH_MAP_NOTACTOR = (PATH_MAP_DOOR|PATH_MAP_AREAMASK),
+	PATH_MAP_SIGHTMASK = (PATH_MAP_NO_SEE|PATH_MAP_SIDEWALL|PATH_MAP_DOOR_OPAQUE)
 };
 
 struct PathNode {
@@ -51,6 +65,39 @@ struct PathNode {
 	unsigned int orient;
 };
 
+/** entry of the pathfinder's open set (a binary heap ordered by estimate) */
+struct PathOpenNode {
+	unsigned int estimate; //cost so far + heuristic distance to the target
+	unsigned int cost; //cost so far
+	unsigned int pos; //searchmap index (y * Width + x)
+};
+
+/** remembered line of sight between two searchmap cells */
+struct LOSCacheEntry {
+	unsigned int from, to; //searchmap indices, from < to
+	unsigned int SightEpoch; //sight blockers at the time of the walk
+	bool visible;
+};
+
+struct PathPortalLink {
+	unsigned int portal; //index of the linked portal
+	unsigned int cost; //cost of walking there
+};
+
+/** searchmap cell where routes cross from one sector into the next */
+struct PathPortal {
+	Point pos;
+	unsigned int region; //connected part of the sector the cell belongs to
+	std::vector<PathPortalLink> links;
+};
+
+/** cached sector level route between two regions */
+struct PathRoute {
+	std::vector<Point> waypoints; //sector entry cells between start and goal
+	bool found; //false if the sector graph has no route
+	unsigned int retryTime; //game time until which following it is known to fail
+};
+
 }
 
 #endif
@@ -1124,8 +1124,9 @@ void Projectile::SecondaryTarget()
 	}
 
 	int radius = Extension->ExplosionRadius;
-	Actor **actors = area->GetAllActorsInRadius(Pos, CalculateTargetFlag(), radius);
-	Actor **poi=actors;
+	std::vector<Actor*> actors;
+	area->GetAllActorsInRadius(actors, Pos, CalculateTargetFlag(), radius);
+	std::vector<Actor*>::iterator poi = actors.begin();
 
 	if (Extension->DiceCount) {
 		//precalculate the maximum affected target count in case of PAF_AFFECT_ONE 
@@ -1135,7 +1136,7 @@ void Projectile::SecondaryTarget()
 		extension_targetcount = 1;
 	}
 
-	while(*poi) {
+	while(poi != actors.end()) {
 		ieDword Target = (*poi)->GetGlobalID();
 
 		//this flag is actually about ignoring the caster (who is at the center)
@@ -1205,7 +1206,7 @@ void Projectile::SecondaryTarget()
 			}
 			//if target counting is per HD and this target is an actor, use the xp level field
 			//otherwise count it as one
-			if ((Extension->APFlags&APF_COUNT_HD) && ((*poi)->Type==ST_ACTOR) ) {
+			if ((Extension->APFlags&APF_COUNT_HD) && poi != actors.end() && ((*poi)->Type==ST_ACTOR) ) {
 				Actor *actor = (Actor *) *poi;
 				extension_targetcount-= actor->GetXPLevel(true);
 			} else {
@@ -1213,7 +1214,6 @@ void Projectile::SecondaryTarget()
 			}
 		}
 	}
-	free(actors);
 
 	//In case of utter failure, apply a spell of the same name on the caster
 	//this feature is used by SCHARGE, PRTL_OP and PRTL_CL in the HoW pack
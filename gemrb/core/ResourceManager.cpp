@@ -20,17 +20,21 @@
 
 #include "ResourceManager.h"
 
+#include "FileCache.h"
 #include "Interface.h"
 #include "PluginMgr.h"
 #include "Resource.h"
 #include "ResourceDesc.h"
 #include "ResourceSource.h"
+#include "System/FileStream.h"
+#include "System/MemoryStream.h"
 #include "System/StringBuffer.h"
 
 namespace GemRB {
 
 ResourceManager::ResourceManager()
 {
+	FlushLookups();
 }
 
 
@@ -56,9 +60,73 @@ bool ResourceManager::AddSource(const char *path, const char *description, Plugi
 	} else {
 		searchPath.push_back(source);
 	}
+	FlushLookups();
 	return true;
 }
 
+void ResourceManager::FlushLookups() const
+{
+	MutexLock l(lookupMutex);
+	ResetLookups();
+}
+
+void ResourceManager::ResetLookups() const
+{
+	lookups.init(1024, 256);
+	lookupFiles = FileStream::GetCreatedFiles();
+}
+
+bool ResourceManager::ExtractAll()
+{
+	bool ret = true;
+	for (size_t i = 0; i < searchPath.size(); i++) {
+		if (!searchPath[i]->ExtractAll()) {
+			ret = false;
+		}
+	}
+	return ret;
+}
+
+// the sources only change when files get created (in the cache) or
+// sources get added, so both hits and misses are remembered until then
+int ResourceManager::FindSource(const std::string &key, const char *ResRef, SClass_ID type, const ResourceDesc *desc) const
+{
+	MutexLock l(lookupMutex);
+	if (lookupFiles != FileStream::GetCreatedFiles()) {
+		ResetLookups();
+	}
+	const int *found = lookups.get(key);
+	if (found) {
+		return *found;
+	}
+
+	int source = -1;
+	for (size_t i = 0; i < searchPath.size(); i++) {
+		if (desc ? searchPath[i]->HasResource(ResRef, *desc) : searchPath[i]->HasResource(ResRef, type)) {
+			source = (int) i;
+			break;
+		}
+	}
+	lookups.set(key, source);
+	return source;
+}
+
+int ResourceManager::FindSource(const char *ResRef, SClass_ID type) const
+{
+	char key[_MAX_PATH];
+	snprintf(key, sizeof(key), "%s#%x", ResRef, (unsigned int) type);
+	WaitForBackgroundWrite(ResRef, core->TypeExt(type));
+	return FindSource(key, ResRef, type, NULL);
+}
+
+int ResourceManager::FindSource(const char *ResRef, const ResourceDesc &type) const
+{
+	char key[_MAX_PATH];
+	snprintf(key, sizeof(key), "%s.%s", ResRef, type.GetExt());
+	WaitForBackgroundWrite(ResRef, type.GetExt());
+	return FindSource(key, ResRef, 0, &type);
+}
+
 static void PrintPossibleFiles(StringBuffer& buffer, const char* ResRef, const TypeID *type)
 {
 	const std::vector<ResourceDesc>& types = PluginMgr::Get()->GetResourceDesc(type);
@@ -71,11 +139,8 @@ bool ResourceManager::Exists(const char *ResRef, SClass_ID type, bool silent) co
 {
 	if (ResRef[0] == '\0')
 		return false;
-	// TODO: check various caches
-	for (size_t i = 0; i < searchPath.size(); i++) {
-		if (searchPath[i]->HasResource( ResRef, type )) {
-			return true;
-		}
+	if (FindSource(ResRef, type) >= 0) {
+		return true;
 	}
 	if (!silent) {
 		Log(WARNING, "ResourceManager", "'%s.%s' not found...",
@@ -88,13 +153,10 @@ bool ResourceManager::Exists(const char *ResRef, const TypeID *type, bool silent
 {
 	if (ResRef[0] == '\0')
 		return false;
-	// TODO: check various caches
 	const std::vector<ResourceDesc> &types = PluginMgr::Get()->GetResourceDesc(type);
 	for (size_t j = 0; j < types.size(); j++) {
-		for (size_t i = 0; i < searchPath.size(); i++) {
-			if (searchPath[i]->HasResource(ResRef, types[j])) {
-				return true;
-			}
+		if (FindSource(ResRef, types[j]) >= 0) {
+			return true;
 		}
 	}
 	if (!silent) {
@@ -111,7 +173,9 @@ DataStream* ResourceManager::GetResource(const char* ResRef, SClass_ID type, boo
 {
 	if (ResRef[0] == '\0')
 		return NULL;
-	for (size_t i = 0; i < searchPath.size(); i++) {
+	// the sources before the first one having it would only fail
+	int first = FindSource(ResRef, type);
+	for (size_t i = first < 0 ? searchPath.size() : first; i < searchPath.size(); i++) {
 		DataStream *ds = searchPath[i]->GetResource(ResRef, type);
 		if (ds) {
 			if (!silent) {
@@ -129,6 +193,32 @@ DataStream* ResourceManager::GetResource(const char* ResRef, SClass_ID type, boo
 }
 
 Resource* ResourceManager::GetResource(const char* ResRef, const TypeID *type, bool silent, bool useCorrupt) const
+{
+	return LoadResource(ResRef, type, silent, useCorrupt, false);
+}
+
+Resource* ResourceManager::GetDetachedResource(const char* ResRef, const TypeID *type, bool silent) const
+{
+	return LoadResource(ResRef, type, silent, false, true);
+}
+
+// streams of archives share their file and block cache, so only a
+// private copy is safe to hand to another thread
+static DataStream* ReadIntoMemory(DataStream *str)
+{
+	unsigned long size = str->Remains();
+	void *data = malloc(size);
+	if (!data || str->Read(data, size) != (int) size) {
+		free(data);
+		delete str;
+		return NULL;
+	}
+	DataStream *mem = new MemoryStream(str->originalfile, data, size);
+	delete str;
+	return mem;
+}
+
+Resource* ResourceManager::LoadResource(const char* ResRef, const TypeID *type, bool silent, bool useCorrupt, bool detach) const
 {
 	if (ResRef[0] == '\0')
 		return NULL;
@@ -137,7 +227,19 @@ Resource* ResourceManager::GetResource(const char* ResRef, const TypeID *type, b
 	}
 	const std::vector<ResourceDesc> &types = PluginMgr::Get()->GetResourceDesc(type);
 	for (size_t j = 0; j < types.size(); j++) {
-		for (size_t i = 0; i < searchPath.size(); i++) {
+		// the sources before the first one having it would only fail
+		int first = FindSource(ResRef, types[j]);
+		if (first != 0) {
+			if (useCorrupt && core->UseCorruptedHack) {
+				core->UseCorruptedHack = false;
+				return NULL;
+			}
+			core->UseCorruptedHack = false;
+			if (first < 0) {
+				continue;
+			}
+		}
+		for (size_t i = first; i < searchPath.size(); i++) {
 			DataStream *str = searchPath[i]->GetResource(ResRef, types[j]);
 			if (!str && useCorrupt && core->UseCorruptedHack) {
 				// don't look at other paths if requested
@@ -145,6 +247,9 @@ Resource* ResourceManager::GetResource(const char* ResRef, const TypeID *type, b
 				return NULL;
 			}
 			core->UseCorruptedHack = false;
+			if (str && detach) {
+				str = ReadIntoMemory(str);
+			}
 			if (str) {
 				Resource *res = types[j].Create(str);
 				if (res) {
@@ -25,6 +25,8 @@
 #include "exports.h"
 
 #include "Holder.h"
+#include "StringMap.h"
+#include "System/Thread.h"
 
 #include <vector>
 
@@ -38,6 +40,7 @@ namespace GemRB {
 
 class DataStream;
 class Resource;
+class ResourceDesc;
 #ifndef __sgi
 class ResourceSource;
 #endif
@@ -66,9 +69,32 @@ public:
 	DataStream* GetResource(const char* resname, SClass_ID type, bool silent = false) const;
 	/** Returns Resource object associated to given resource */
 	Resource* GetResource(const char* resname, const TypeID *type, bool silent = false, bool useCorrupt = false) const;
+	/**
+	 * Like GetResource, but reads the data into memory first, so the
+	 * returned object can be used off the main thread.
+	 */
+	Resource* GetDetachedResource(const char* resname, const TypeID *type, bool silent = false) const;
+	/** Forgets the remembered lookups, needed when files were removed */
+	void FlushLookups() const;
+	/** Makes the sources extract everything they only keep in memory,
+	 *  returns false if anything was left packed */
+	bool ExtractAll();
 
 private:
 	std::vector<Holder<ResourceSource> > searchPath;
+	/** first source having each looked up resource, -1 if none has it */
+	mutable HashMap<std::string, int> lookups;
+	/** FileStream::GetCreatedFiles() when the lookups were made */
+	mutable unsigned int lookupFiles;
+	/** the ambient thread looks up sounds too */
+	mutable Mutex lookupMutex;
+
+	void ResetLookups() const;
+
+	Resource* LoadResource(const char* resname, const TypeID *type, bool silent, bool useCorrupt, bool detach) const;
+	int FindSource(const char *ResRef, SClass_ID type) const;
+	int FindSource(const char *ResRef, const ResourceDesc &type) const;
+	int FindSource(const std::string &key, const char *ResRef, SClass_ID type, const ResourceDesc *desc) const;
 };
 
 }
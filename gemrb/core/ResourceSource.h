@@ -41,6 +41,9 @@ public:
 	virtual bool HasResource(const char* resname, const ResourceDesc &type) = 0;
 	virtual DataStream* GetResource(const char* resname, SClass_ID type) = 0;
 	virtual DataStream* GetResource(const char* resname, const ResourceDesc &type) = 0;
+	/** Extracts the resources that are only kept packed in memory into the cache.
+	 *  Returns false if any of them could not be extracted. */
+	virtual bool ExtractAll() { return true; }
 	const char *GetDescription() const { return description; }
 protected:
 	char *description;
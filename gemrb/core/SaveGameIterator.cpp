@@ -25,6 +25,7 @@
 #include "win32def.h"
 
 #include "DisplayMessage.h"
+#include "FileCache.h"
 #include "GameData.h" // For ResourceHolder
 #include "ImageMgr.h"
 #include "ImageWriter.h"
@@ -286,6 +287,8 @@ bool SaveGameIterator::RescanSaveGames()
 {
 	// delete old entries
 	save_slots.clear();
+	// and don't look at a save still being written
+	WaitForBackgroundWrites();
 
 	char Path[_MAX_PATH];
 	PathJoin(Path, core->SavePath, SaveDir(), NULL);
@@ -419,7 +422,11 @@ void SaveGameIterator::PruneQuickSave(const char *folder)
 static bool DoSaveGame(const char *Path)
 {
 	Game *game = core->GetGame();
+	//stores are written right away, so before queueing anything
+	gamedata->SaveAllStores();
+
 	//saving areas to cache currently in memory
+	//they are only serialized here, the writing happens in the background
 	unsigned int mc = (unsigned int) game->GetLoadedMapCount();
 	while (mc--) {
 		Map *map = game->GetMap(mc);
@@ -428,10 +435,9 @@ static bool DoSaveGame(const char *Path)
 		}
 	}
 
-	gamedata->SaveAllStores();
-
 	//compress files in cache named: .STO and .ARE
 	//no .CRE would be saved in cache
+	//this also happens in the background, once the areas were written
 	if (core->CompressSave(Path)) {
 		return false;
 	}
@@ -537,18 +543,16 @@ static int CanSave()
 	}
 
 	Point pc1 =  game->GetPC(0, true)->Pos;
-	Actor **nearActors = map->GetAllActorsInRadius(pc1, GA_NO_DEAD|GA_NO_UNSCHEDULED, 15*10);
-	i = 0;
-	while (nearActors[i]) {
-		Actor *actor = nearActors[i];
+	std::vector<Actor*> nearActors;
+	map->GetAllActorsInRadius(nearActors, pc1, GA_NO_DEAD|GA_NO_UNSCHEDULED, 15*10);
+	for (size_t j = 0; j < nearActors.size(); j++) {
+		Actor *actor = nearActors[j];
 		if (actor->GetInternalFlag() & IF_NOINT) {
 			// dialog about to start or similar
 			displaymsg->DisplayConstantString(STR_CANTSAVEDIALOG2, DMC_BG2XPGREEN);
 			return 8;
 		}
-		i++;
 	}
-	free(nearActors);
 
 	//TODO: can't save while AOE spells are in effect -> CANTSAVE
 	//TODO: can't save  during a rest, chapter information or movie -> CANTSAVEMOVIE
@@ -591,6 +595,9 @@ int SaveGameIterator::CreateSaveGame(int index, bool mqs)
 		qsave = atoi(tab->QueryField(index, 1));
 	}
 
+	//the previous save may still be written in the background
+	WaitForBackgroundWrites();
+
 	if (mqs) {
 		assert(qsave);
 		PruneQuickSave(slotname);
@@ -650,6 +657,8 @@ int SaveGameIterator::CreateSaveGame(Holder<SaveGame> save, const char *slotname
 	if (int cansave = CanSave())
 		return cansave;
 
+	//the previous save may still be written in the background
+	WaitForBackgroundWrites();
 	GameControl *gc = core->GetGameControl();
 	int index;
 
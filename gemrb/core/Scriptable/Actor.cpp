@@ -131,6 +131,8 @@ static ieDword footsteps = 1;
 static ieDword always_dither = 1;
 static ieDword GameDifficulty = DIFF_CORE;
 static ieDword NoExtraDifficultyDmg = 0;
+//#define CHECK_FX_REFRESH //reapply the effects even when the cached stats could be used and compare them
+
 //the chance to issue one of the rare select verbal constants
 #define RARE_SELECT_CHANCE 5
 //these are the max number of select sounds -- the size of the pool to choose from
@@ -440,6 +442,9 @@ Actor::Actor()
 		Modified[i] = 0;
 	}
 	PrevStats = NULL;
+	FxStats = NULL;
+	FxSignature = 0;
+	FxStatsValid = false;
 
 	SmallPortrait[0] = 0;
 	LargePortrait[0] = 0;
@@ -472,6 +477,7 @@ Actor::Actor()
 	lastattack = 0;
 	InTrap = 0;
 	PathTries = 0;
+	GridCell = -1;
 	TargetDoor = 0;
 	attackProjectile = NULL;
 	lastInit = 0;
@@ -548,6 +554,7 @@ Actor::~Actor(void)
 	core->FreeString( ShortName );
 
 	delete PCStats;
+	delete [] FxStats;
 
 	for (i = 0; i < vvcOverlays.size(); i++) {
 		if (vvcOverlays[i]) {
@@ -562,7 +569,7 @@ Actor::~Actor(void)
 		}
 	}
 	for (i = 0; i < EXTRA_ACTORCOVERS; i++)
-		delete extraCovers[i];
+		if (extraCovers[i]) extraCovers[i]->release();
 
 	delete attackProjectile;
 	delete polymorphCache;
@@ -2783,6 +2790,10 @@ bool Actor::SetStat(unsigned int StatIndex, ieDword Value, int pcf)
 	unsigned int previous = GetSafeStat(StatIndex);
 	if (Modified[StatIndex]!=Value) {
 		Modified[StatIndex] = Value;
+		//RefreshEffects checks the indexes once it is done
+		if (area && !PrevStats && Map::IsIndexedStat(StatIndex)) {
+			area->InvalidateActorIndex();
+		}
 	}
 	if (previous!=Value) {
 		if (pcf) {
@@ -3036,7 +3047,34 @@ void Actor::RefreshEffects(EffectQueue *fx)
 		}
 	}
 
-	fxqueue.ApplyAllEffects( this );
+	// if neither the effects nor the stats they start from changed since the
+	// last refresh, the result is known already
+	ieDword signature = 0;
+	bool cached = false;
+	if (!fx && !first && FxStatsValid && fxqueue.GetStatSignature(signature) && signature == FxSignature) {
+		cached = !memcmp(FxStats, Modified, MAX_STATS * sizeof(ieDword));
+	}
+#ifdef CHECK_FX_REFRESH
+	if (cached) {
+		fxqueue.ApplyAllEffects( this );
+		if (memcmp(FxStats+MAX_STATS, Modified, MAX_STATS * sizeof(ieDword))) {
+			Log(ERROR, "Actor", "Cached effect stats of %s are stale!", LongName);
+		}
+	}
+#else
+	if (cached) {
+		memcpy( Modified, FxStats+MAX_STATS, MAX_STATS * sizeof( ieDword ) );
+	}
+#endif
+	if (!cached) {
+		if (!FxStats) {
+			FxStats = new ieDword[MAX_STATS*2];
+		}
+		memcpy( FxStats, Modified, MAX_STATS * sizeof( ieDword ) );
+		fxqueue.ApplyAllEffects( this );
+		memcpy( FxStats+MAX_STATS, Modified, MAX_STATS * sizeof( ieDword ) );
+		FxStatsValid = fxqueue.GetStatSignature(FxSignature);
+	}
 
 	if (previous[IE_PUPPETID]) {
 		CheckPuppet(core->GetGame()->GetActorByGlobalID(previous[IE_PUPPETID]), previous[IE_PUPPETTYPE]);
@@ -3092,6 +3130,9 @@ void Actor::RefreshEffects(EffectQueue *fx)
 
 	for (i=0;i<MAX_STATS;i++) {
 		if (first || Modified[i]!=previous[i]) {
+			if (area && Map::IsIndexedStat(i)) {
+				area->InvalidateActorIndex();
+			}
 			PostChangeFunctionType f = post_change_functions[i];
 			if (f) {
 				(*f)(this, previous[i], Modified[i]);
@@ -3741,6 +3782,32 @@ void Actor::ReactToDeath(const char * deadname)
 	}
 }
 
+static const int prefetchedConstants[] = { VB_ATTACK, VB_ATTACK+1, VB_ATTACK+2, VB_ATTACK+3, VB_DAMAGE, VB_DIE };
+
+void Actor::PrefetchSounds() const
+{
+	Audio *audio = core->GetAudioDrv();
+	for (size_t i = 0; i < sizeof(prefetchedConstants)/sizeof(int); i++) {
+		//main characters use sound files instead of strrefs
+		if (PCStats && PCStats->SoundSet[0]) {
+			ieResRef soundref;
+			char chrsound[256];
+			ResolveStringConstant(soundref, prefetchedConstants[i]);
+			GetSoundFolder(chrsound, 1, soundref);
+			audio->Prefetch(chrsound);
+			continue;
+		}
+		ieStrRef strref = GetVerbalConstant(prefetchedConstants[i]);
+		if (strref == (ieStrRef) -1) {
+			continue;
+		}
+		StringBlock sb = core->strings->GetStringBlock(strref);
+		if (sb.Sound[0]) {
+			audio->Prefetch(sb.Sound);
+		}
+	}
+}
+
 //issue area specific comments
 void Actor::GetAreaComment(int areaflag) const
 {
@@ -5039,10 +5106,11 @@ static const char *GetVarName(const char *table, int value)
 void Actor::SendDiedTrigger()
 {
 	if (!area) return;
-	Actor **neighbours = area->GetAllActorsInRadius(Pos, GA_NO_LOS|GA_NO_DEAD|GA_NO_UNSCHEDULED, GetSafeStat(IE_VISUALRANGE));
-	Actor **poi = neighbours;
+	std::vector<Actor*> neighbours;
+	area->GetAllActorsInRadius(neighbours, Pos, GA_NO_LOS|GA_NO_DEAD|GA_NO_UNSCHEDULED, GetSafeStat(IE_VISUALRANGE));
+	std::vector<Actor*>::iterator poi = neighbours.begin();
 	ieDword ea = Modified[IE_EA];
-	while (*poi) {
+	while (poi != neighbours.end()) {
 		(*poi)->AddTrigger(TriggerEntry(trigger_died, GetGlobalID()));
 
 		// allies take a hit on morale and nobody cares about neutrals
@@ -5055,7 +5123,6 @@ void Actor::SendDiedTrigger()
 
 		poi++;
 	}
-	free(neighbours);
 }
 
 void Actor::Die(Scriptable *killer)
@@ -7408,13 +7475,13 @@ void Actor::ApplyModal(ieResRef modalSpell)
 		// target actors around us manually
 		// used for iwd2 songs, as the spells don't use an aoe projectile
 		if (!area) return;
-		Actor **neighbours = area->GetAllActorsInRadius(Pos, GA_NO_LOS|GA_NO_DEAD|GA_NO_UNSCHEDULED, GetSafeStat(IE_VISUALRANGE)*VOODOO_SPL_RANGE_F);
-		Actor **poi = neighbours;
-		while (*poi) {
+		std::vector<Actor*> neighbours;
+		area->GetAllActorsInRadius(neighbours, Pos, GA_NO_LOS|GA_NO_DEAD|GA_NO_UNSCHEDULED, GetSafeStat(IE_VISUALRANGE)*VOODOO_SPL_RANGE_F);
+		std::vector<Actor*>::iterator poi = neighbours.begin();
+		while (poi != neighbours.end()) {
 			core->ApplySpell(modalSpell, *poi, this, 0);
 			poi++;
 		}
-		free(neighbours);
 	} else {
 		core->ApplySpell(modalSpell, this, this, 0);
 	}
@@ -7698,7 +7765,7 @@ void Actor::DrawVideocells(const Region &screen, vvcVector &vvcCells, const Colo
 }
 
 void Actor::DrawActorSprite(const Region &screen, int cx, int cy, const Region& bbox,
-			SpriteCover*& newsc, Animation** anims,
+			SpriteCover*& sc, Animation** anims,
 			unsigned char Face, const Color& tint)
 {
 	CharAnimations* ca = GetAnims();
@@ -7723,19 +7790,20 @@ void Actor::DrawActorSprite(const Region &screen, int cx, int cy, const Region&
 		if (anim)
 			nextFrame = anim->GetFrame(anim->GetCurrentFrame());
 		if (nextFrame && bbox.IntersectsRegion( vp ) ) {
-			if (!newsc || !newsc->Covers(cx, cy, nextFrame->XPos, nextFrame->YPos, nextFrame->Width, nextFrame->Height)) {
+			if (!sc || !sc->Covers(cx, cy, nextFrame->XPos, nextFrame->YPos, nextFrame->Width, nextFrame->Height)) {
+				if (sc) sc->release();
 				// the first anim contains the animarea for
 				// the entire multi-part animation
-				newsc = area->BuildSpriteCover(cx,
+				sc = area->BuildSpriteCover(cx,
 					cy, -anims[0]->animArea.x,
 					-anims[0]->animArea.y,
 					anims[0]->animArea.w,
 					anims[0]->animArea.h, WantDither() );
 			}
-			assert(newsc->Covers(cx, cy, nextFrame->XPos, nextFrame->YPos, nextFrame->Width, nextFrame->Height));
+			assert(sc->Covers(cx, cy, nextFrame->XPos, nextFrame->YPos, nextFrame->Width, nextFrame->Height));
 
 			video->BlitGameSprite( nextFrame, cx + screen.x, cy + screen.y,
-				flags, tint, newsc, ca->GetPartPalette(partnum), &screen);
+				flags, tint, sc, ca->GetPartPalette(partnum), &screen);
 		}
 	}
 }
@@ -8076,7 +8144,6 @@ void Actor::Draw(const Region &screen)
 		// it could be divided so it will become a 0-15 number.
 		//
 
-		SpriteCover *sc = 0, *newsc = 0;
 		int blurx = cx;
 		int blury = cy;
 		int blurdx = (OrientdX[Face]*(int)Modified[IE_MOVEMENTRATE])/20;
@@ -8099,16 +8166,11 @@ void Actor::Draw(const Region &screen)
 				if (area->GetBlocked(iPos) & (PATH_MAP_PASSABLE|PATH_MAP_ACTOR)) {
 					sbbox.x += 3*OrientdX[dir];
 					sbbox.y += 3*OrientdY[dir];
-					newsc = sc = extraCovers[3+m];
-					DrawActorSprite(screen, icx, icy, sbbox, newsc,
+					DrawActorSprite(screen, icx, icy, sbbox, extraCovers[3+m],
 						anims, Face, mirrortint);
-					if (newsc != sc) {
-						delete sc;
-						extraCovers[3+m] = newsc;
-					}
 				}
 			} else {
-				delete extraCovers[3+m];
+				if (extraCovers[3+m]) extraCovers[3+m]->release();
 				extraCovers[3+m] = NULL;
 			}
 		}
@@ -8122,13 +8184,8 @@ void Actor::Draw(const Region &screen)
 				for (i = 0; i < 3; ++i) {
 					sbbox.x += blurdx; sbbox.y += blurdy;
 					blurx += blurdx; blury += blurdy;
-					newsc = sc = extraCovers[i];
-					DrawActorSprite(screen, blurx, blury, sbbox, newsc,
+					DrawActorSprite(screen, blurx, blury, sbbox, extraCovers[i],
 						anims, Face, tint);
-					if (newsc != sc) {
-						delete sc;
-						extraCovers[i] = newsc;
-					}
 				}
 			}
 		}
@@ -8152,15 +8209,17 @@ void Actor::Draw(const Region &screen)
 			}
 		}
 
-		newsc = sc = GetSpriteCover();
+		// DrawActorSprite releases the cover it replaces
+		SpriteCover *sc = GetSpriteCover();
+		if (sc) sc->acquire();
 		Animation **shadowAnimations = ca->GetShadowAnimation(StanceID, Face);
 		if (shadowAnimations) {
-			DrawActorSprite(screen, cx, cy, BBox, newsc, shadowAnimations, Face, tint);
+			DrawActorSprite(screen, cx, cy, BBox, sc, shadowAnimations, Face, tint);
 		}
 
 		// actor itself
-		DrawActorSprite(screen, cx, cy, BBox, newsc, anims, Face, tint);
-		if (newsc != sc) SetSpriteCover(newsc);
+		DrawActorSprite(screen, cx, cy, BBox, sc, anims, Face, tint);
+		SetSpriteCover(sc);
 
 		// blur sprites in front of the actor
 		if (State & STATE_BLUR) {
@@ -8169,13 +8228,8 @@ void Actor::Draw(const Region &screen)
 				for (i = 0; i < 3; ++i) {
 					sbbox.x -= blurdx; sbbox.y -= blurdy;
 					blurx -= blurdx; blury -= blurdy;
-					newsc = sc = extraCovers[i];
-					DrawActorSprite(screen, blurx, blury, sbbox, newsc,
+					DrawActorSprite(screen, blurx, blury, sbbox, extraCovers[i],
 						anims, Face, tint);
-					if (newsc != sc) {
-						delete sc;
-						extraCovers[i] = newsc;
-					}
 				}
 			}
 		}
@@ -8192,16 +8246,11 @@ void Actor::Draw(const Region &screen)
 				if (area->GetBlocked(iPos) & (PATH_MAP_PASSABLE|PATH_MAP_ACTOR)) {
 					sbbox.x += 3*OrientdX[dir];
 					sbbox.y += 3*OrientdY[dir];
-					newsc = sc = extraCovers[3+m];
-					DrawActorSprite(screen, icx, icy, sbbox, newsc,
+					DrawActorSprite(screen, icx, icy, sbbox, extraCovers[3+m],
 						anims, Face, mirrortint);
-					if (newsc != sc) {
-						delete sc;
-						extraCovers[3+m] = newsc;
-					}
 				}
 			} else {
-				delete extraCovers[3+m];
+				if (extraCovers[3+m]) extraCovers[3+m]->release();
 				extraCovers[3+m] = NULL;
 			}
 		}
@@ -10105,13 +10154,14 @@ bool Actor::SeeAnyOne(bool enemy, bool seenby)
 			flag|=GA_NO_ALLY|GA_NO_NEUTRAL;
 		} else return false; //neutrals got no enemy
 	}
-	Actor** visActors = area->GetAllActorsInRadius(Pos, flag, seenby?15*10:GetSafeStat(IE_VISUALRANGE)*10, this);
+	std::vector<Actor*> visActors;
+	area->GetAllActorsInRadius(visActors, Pos, flag, seenby?15*10:GetSafeStat(IE_VISUALRANGE)*10, this);
 
-	Actor** poi = visActors;
+	std::vector<Actor*>::iterator poi = visActors.begin();
 	bool seeEnemy = false;
 
 	//we need to look harder if we look for seenby anyone
-	while (*poi && !seeEnemy) {
+	while (poi != visActors.end() && !seeEnemy) {
 		Actor *toCheck = *poi++;
 		if (toCheck==this) continue;
 		if (seenby) {
@@ -10119,7 +10169,6 @@ bool Actor::SeeAnyOne(bool enemy, bool seenby)
 		}
 		else seeEnemy = true;
 	}
-	free(visActors);
 	return seeEnemy;
 }
 
@@ -10189,8 +10238,9 @@ bool Actor::TryToHide()
 // skill check when trying to maintain invisibility: separate move silently and visibility check
 bool Actor::TryToHideIWD2()
 {
-	Actor **neighbours = area->GetAllActorsInRadius(Pos, GA_NO_DEAD|GA_NO_LOS|GA_NO_ALLY|GA_NO_NEUTRAL|GA_NO_SELF|GA_NO_UNSCHEDULED, 60);
-	Actor **poi = neighbours;
+	std::vector<Actor*> neighbours;
+	area->GetAllActorsInRadius(neighbours, Pos, GA_NO_DEAD|GA_NO_LOS|GA_NO_ALLY|GA_NO_NEUTRAL|GA_NO_SELF|GA_NO_UNSCHEDULED, 60);
+	std::vector<Actor*>::iterator poi = neighbours.begin();
 	ieDword roll = LuckyRoll(1, 20, GetArmorSkillPenalty(0));
 	int targetDC = 0;
 	bool checked = false;
@@ -10200,7 +10250,7 @@ bool Actor::TryToHideIWD2()
 	// TODO: use crehidemd.2da as a skill bonus/malus (after refreshing effects, not here)
 	ieDword skill = GetStat(IE_HIDEINSHADOWS);
 	bool seen = false;
-	while (*poi) {
+	while (poi != neighbours.end()) {
 		Actor *toCheck = *poi++;
 		if (toCheck->GetStat(IE_STATE_ID)&STATE_BLIND) {
 			continue;
@@ -10215,7 +10265,6 @@ bool Actor::TryToHideIWD2()
 		seen = skill < (roll + targetDC);
 		if (seen) {
 			HideFailed(this, 1, skill, roll, targetDC);
-			free(neighbours);
 			return false;
 		} else {
 			// ~You were not seen by creature! Hide check %d vs. creature's Level+Wisdom+Race modifier  %d + %d D20 Roll.~
@@ -10225,15 +10274,14 @@ bool Actor::TryToHideIWD2()
 
 	// we're stationary, so no need to check if we're making movement sounds
 	if (!InMove() && !checked) {
-		free(neighbours);
 		return true;
 	}
 
 	// separate move silently check
 	skill = GetStat(IE_STEALTH);
-	poi = neighbours;
+	poi = neighbours.begin();
 	bool heard = false;
-	while (*poi) {
+	while (poi != neighbours.end()) {
 		Actor *toCheck = *poi++;
 		if (toCheck->HasSpellState(SS_DEAF)) {
 			continue;
@@ -10245,7 +10293,6 @@ bool Actor::TryToHideIWD2()
 		heard = skill < (roll + targetDC);
 		if (heard) {
 			HideFailed(this, 2, skill, roll, targetDC);
-			free(neighbours);
 			return false;
 		} else {
 			// ~You were not heard by creature! Move silently check %d vs. creature's Level+Wisdom+Race modifier  %d + %d D20 Roll.~
@@ -10253,7 +10300,6 @@ bool Actor::TryToHideIWD2()
 		}
 	}
 
-	free(neighbours);
 	return true;
 }
 
@@ -10595,10 +10641,11 @@ bool Actor::ConcentrationCheck() const
 	if (Modified[IE_SPECFLAGS]&SPECF_DRIVEN) return true;
 
 	// anyone in a 5' radius?
-	Actor **neighbours = area->GetAllActorsInRadius(Pos, GA_NO_DEAD|GA_NO_ALLY|GA_NO_SELF|GA_NO_UNSCHEDULED|GA_NO_HIDDEN, 5*VOODOO_SPL_RANGE_F);
-	Actor **poi = neighbours;
+	std::vector<Actor*> neighbours;
+	area->GetAllActorsInRadius(neighbours, Pos, GA_NO_DEAD|GA_NO_ALLY|GA_NO_SELF|GA_NO_UNSCHEDULED|GA_NO_HIDDEN, 5*VOODOO_SPL_RANGE_F);
+	std::vector<Actor*>::iterator poi = neighbours.begin();
 	bool enemyFound = false;
-	while (*poi) {
+	while (poi != neighbours.end()) {
 		Actor *neighbour = *poi;
 		if (neighbour->GetStat(IE_EA) > EA_EVILCUTOFF) {
 			enemyFound = true;
@@ -10606,7 +10653,6 @@ bool Actor::ConcentrationCheck() const
 		}
 		poi++;
 	}
-	free(neighbours);
 	if (!enemyFound) return true;
 
 	// so there is someone out to get us and we should do the real concentration check
@@ -278,6 +278,9 @@ public:
 	ieDword BaseStats[MAX_STATS];
 	ieDword Modified[MAX_STATS];
 	ieDword *PrevStats;
+	ieDword *FxStats; //Modified before and after the last effect application, see RefreshEffects
+	ieDword FxSignature; //the fxqueue signature belonging to FxStats
+	bool FxStatsValid;
 	ieByteSigned DeathCounters[4];   //PST specific (good, law, lady, murder)
 
 	ieResRef ModalSpell;             //apply this spell once per round
@@ -314,6 +317,7 @@ public:
 	ieDword appearance;
 	ieDword ModalState;
 	int PathTries; //the # of previous tries to pick up a new walkpath
+	int GridCell; //the area's actor grid cell we are filed in, -1 if none
 	ArmorClass AC;
 	ToHitStats ToHit;
 public:
@@ -686,6 +690,8 @@ public:
 	void ResolveStringConstant(ieResRef sound, unsigned int index) const;
 	void GetSoundFromINI(ieResRef Sound, unsigned int index) const;
 	void GetSoundFrom2DA(ieResRef Sound, unsigned int index) const;
+	/* start decoding the sounds likely played in a fight */
+	void PrefetchSounds() const;
 	/* generate area specific oneliner */
 	void GetAreaComment(int areaflag) const;
 	/* handle oneliner interaction, -1: unsuccessful (may comment area), 0: dialog banter, 1: oneliner */
@@ -63,7 +63,7 @@ void Container::FreeGroundIcons()
 			groundicons[i]=NULL;
 		}
 	}
-	delete groundiconcover;
+	if (groundiconcover) groundiconcover->release();
 	groundiconcover = 0;
 }
 
@@ -123,7 +123,7 @@ void Container::CreateGroundIconCover()
 	if (!groundiconcover ||
 		!groundiconcover->Covers(Pos.x, Pos.y, xpos, ypos, width, height))
 	{
-		delete groundiconcover;
+		if (groundiconcover) groundiconcover->release();
 		groundiconcover = NULL;
 		if (width*height > 0) {
 			groundiconcover = GetCurrentArea()->BuildSpriteCover
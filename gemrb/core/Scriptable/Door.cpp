@@ -217,11 +217,11 @@ bool Door::BlockedOpen(int Open, int ForceOpen)
 	rgn.w = 16;
 	rgn.h = 12;
 	for(int i = 0;i<count;i++) {
-		Actor** ab;
 		rgn.x = points[i].x*16;
 		rgn.y = points[i].y*12;
 		unsigned char tmp = area->GetInternalSearchMap(points[i].x, points[i].y) & PATH_MAP_ACTOR;
 		if (tmp) {
+			std::vector<Actor*> ab;
 			int ac = area->GetActorInRect(ab, rgn, false);
 			while(ac--) {
 				if (ab[ac]->GetBase(IE_DONOTJUMP)) {
@@ -230,9 +230,6 @@ bool Door::BlockedOpen(int Open, int ForceOpen)
 				ab[ac]->SetBase(IE_DONOTJUMP, DNJ_JUMP);
 				blocked = true;
 			}
-			if (ab) {
-				free(ab);
-			}
 		}
 	}
 
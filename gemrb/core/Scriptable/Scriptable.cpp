@@ -148,6 +148,9 @@ void Scriptable::SetScriptName(const char* text)
 	//lets hope this won't break anything
 	if (text) {
 		strnspccpy( scriptName, text, 32 );
+		if (Type == ST_ACTOR && area) {
+			area->InvalidateActorIndex();
+		}
 	}
 }
 
@@ -944,14 +947,12 @@ void Scriptable::DisplaySpellCastMessage(ieDword tgt, Spell *spl)
 
 void Scriptable::SendTriggerToAll(TriggerEntry entry)
 {
-	Actor** nearActors = area->GetAllActorsInRadius(Pos, GA_NO_DEAD|GA_NO_UNSCHEDULED, 15*10);
-	int i=0;
-	while(nearActors[i]!=NULL) {
+	std::vector<Actor*> nearActors;
+	area->GetAllActorsInRadius(nearActors, Pos, GA_NO_DEAD|GA_NO_UNSCHEDULED, 15*10);
+	for (size_t i = 0; i < nearActors.size(); i++) {
 		nearActors[i]->AddTrigger(entry);
-		++i;
 	}
 	area->AddTrigger(entry);
-	free(nearActors);
 }
 
 inline void Scriptable::ResetCastingState(Actor *caster) {
@@ -1203,9 +1204,10 @@ void Scriptable::SpellcraftCheck(const Actor *caster, const ieResRef SpellResRef
 	Spell* spl = gamedata->GetSpell(SpellResRef);
 	assert(spl); // only a bad surge could make this fail and we want to catch it
 	int AdjustedSpellLevel = spl->SpellLevel + 15;
-	Actor **neighbours = area->GetAllActorsInRadius(caster->Pos, GA_NO_DEAD|GA_NO_ENEMY|GA_NO_SELF|GA_NO_UNSCHEDULED, 10*caster->GetBase(IE_VISUALRANGE));
-	Actor **poi = neighbours;
-	while (*poi) {
+	std::vector<Actor*> neighbours;
+	area->GetAllActorsInRadius(neighbours, caster->Pos, GA_NO_DEAD|GA_NO_ENEMY|GA_NO_SELF|GA_NO_UNSCHEDULED, 10*caster->GetBase(IE_VISUALRANGE));
+	std::vector<Actor*>::iterator poi = neighbours.begin();
+	while (poi != neighbours.end()) {
 		Actor *detective = *poi;
 		// disallow neutrals from helping the party
 		if (detective->GetStat(IE_EA) > EA_CONTROLLABLE) {
@@ -1237,7 +1239,6 @@ void Scriptable::SpellcraftCheck(const Actor *caster, const ieResRef SpellResRef
 		poi++;
 	}
 	gamedata->FreeSpell(spl, SpellResRef, false);
-	free(neighbours);
 }
 
 // shortcut for internal use when there is no wait
@@ -1704,13 +1705,13 @@ Selectable::Selectable(ScriptableType type)
 
 void Selectable::SetSpriteCover(SpriteCover* c)
 {
-	delete cover;
+	if (cover) cover->release();
 	cover = c;
 }
 
 Selectable::~Selectable(void)
 {
-	delete cover;
+	if (cover) cover->release();
 }
 
 void Selectable::SetBBox(const Region &newBBox)
@@ -2354,6 +2355,9 @@ void Movable::MoveTo(const Point &Des)
 	area->ClearSearchMapFor(this);
 	Pos = Des;
 	Destination = Des;
+	if (Type == ST_ACTOR) {
+		area->UpdateActorCell((Actor *) this);
+	}
 	if (BlocksSearchMap()) {
 		area->BlockSearchMap( Pos, size, IsPC()?PATH_MAP_PC:PATH_MAP_NPC);
 	}
@@ -337,6 +337,7 @@ public:
 	void InitTriggers();
 	void AddTrigger(TriggerEntry trigger);
 	bool MatchTrigger(unsigned short id, ieDword param = 0);
+	bool HasTriggers() const { return !triggers.empty(); }
 	bool MatchTriggerWithObject(unsigned short id, class Object *obj, ieDword param = 0);
 	const TriggerEntry *GetMatchingTrigger(unsigned short id, unsigned int notflags = 0);
 	void SendTriggerToAll(TriggerEntry entry);
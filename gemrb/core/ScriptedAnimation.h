@@ -130,7 +130,7 @@ public:
 	//sets complete palette to own name+index
 	void SetFullPalette(int idx);
 	//sets spritecover
-	void SetSpriteCover(SpriteCover* c) { delete cover; cover = c; }
+	void SetSpriteCover(SpriteCover* c) { if (cover) cover->release(); cover = c; }
 	/* get stored SpriteCover */
 	SpriteCover* GetSpriteCover() const { return cover; }
 	int GetCurrentFrame();
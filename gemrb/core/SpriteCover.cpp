@@ -29,6 +29,7 @@ SpriteCover::SpriteCover()
 {
 	pixels = 0;
 	worldx = worldy = XPos = YPos = Width = Height = flags = 0;
+	RefCount = 1;
 }
 
 SpriteCover::~SpriteCover()
@@ -36,6 +37,14 @@ SpriteCover::~SpriteCover()
 	core->GetVideoDriver()->DestroySpriteCover(this);
 }
 
+void SpriteCover::release()
+{
+	assert(RefCount > 0);
+	if (--RefCount == 0) {
+		delete this;
+	}
+}
+
 bool SpriteCover::Covers(int x, int y, int xpos, int ypos,
 						 int width, int height) const
 {
@@ -25,16 +25,22 @@
 
 namespace GemRB {
 
+// covers are shared between their users (see Map::BuildSpriteCover),
+// so they are released instead of deleted
 class GEM_EXPORT SpriteCover {
 public:
-	unsigned char* pixels;
+	unsigned char* pixels; // NULL if no wall covers any of it
 	int worldx, worldy; // world coords for which the cover has been computed
 	int XPos, YPos, Width, Height;
 	int flags;
+	int RefCount;
 	SpriteCover(void);
-	~SpriteCover(void);
 
+	void acquire() { ++RefCount; }
+	void release();
 	bool Covers(int x, int y, int xpos, int ypos, int width, int height) const;
+private:
+	~SpriteCover(void);
 };
 
 
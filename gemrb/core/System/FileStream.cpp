@@ -23,12 +23,16 @@
 #include "win32def.h"
 
 #include "Interface.h"
+#include "System/Thread.h"
 
 namespace GemRB {
 
 #ifdef _DEBUG
 int FileStream::FileStreamPtrCount = 0;
 #endif
+unsigned int FileStream::CreatedFiles = 0;
+// save entries are extracted on worker threads
+static Mutex CreatedFilesMutex;
 
 #ifdef WIN32
 struct FileStream::File {
@@ -246,6 +250,9 @@ bool FileStream::Create(const char *path)
 	if (!str->OpenNew(originalfile)) {
 		return false;
 	}
+	CreatedFilesMutex.Lock();
+	CreatedFiles++;
+	CreatedFilesMutex.Unlock();
 	opened = true;
 	created = true;
 	Pos = 0;
@@ -322,6 +329,12 @@ int FileStream::Seek(int newpos, int type)
 	return GEM_OK;
 }
 
+unsigned int FileStream::GetCreatedFiles()
+{
+	MutexLock l(CreatedFilesMutex);
+	return CreatedFiles;
+}
+
 FileStream* FileStream::OpenFile(const char* filename)
 {
 	FileStream *fs = new FileStream();
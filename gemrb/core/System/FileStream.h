@@ -69,7 +69,12 @@ public:
 	 *  Returns NULL, if the file can't be opened.
 	 */
 	static FileStream* OpenFile(const char* filename);
+	/** Returns the number of files created so far, on any thread,
+	 *  so lookup caches can tell when they may be stale.
+	 */
+	static unsigned int GetCreatedFiles();
 private:
+	static unsigned int CreatedFiles;
 	void FindLength();
 };
 
@@ -20,18 +20,59 @@
 
 #include "System/Logger.h"
 #include "System/StringBuffer.h"
+#include "System/Thread.h"
 
 #if defined(__sgi)
 #  include <stdarg.h>
 #else
 #  include <cstdarg>
 #endif
+#include <string>
 #include <vector>
 
 namespace GemRB {
 
 static std::vector<Logger*> theLogger;
 
+//the loggers may touch the gui, so messages of other threads are
+//kept here until the main thread logs something
+struct DeferredMessage {
+	log_level level;
+	std::string owner;
+	std::string message;
+	log_color color;
+};
+static std::vector<DeferredMessage> deferred;
+static Mutex deferredLock;
+
+static bool DeferMessage(log_level level, const char* owner, const char* message, log_color color)
+{
+	if (IsMainThread()) {
+		return false;
+	}
+	DeferredMessage msg;
+	msg.level = level;
+	msg.owner = owner;
+	msg.message = message;
+	msg.color = color;
+	MutexLock lock(deferredLock);
+	deferred.push_back(msg);
+	return true;
+}
+
+static void LogDeferred()
+{
+	std::vector<DeferredMessage> messages;
+	deferredLock.Lock();
+	messages.swap(deferred);
+	deferredLock.Unlock();
+	for (size_t i = 0; i < messages.size(); ++i) {
+		for (size_t j = 0; j < theLogger.size(); ++j) {
+			theLogger[j]->log(messages[i].level, messages[i].owner.c_str(), messages[i].message.c_str(), messages[i].color);
+		}
+	}
+}
+
 void ShutdownLogging()
 {
 	for (size_t i = 0; i < theLogger.size(); ++i) {
@@ -42,6 +83,7 @@ void ShutdownLogging()
 
 void InitializeLogging()
 {
+	SetMainThread();
 	AddLogger(createDefaultLogger());
 }
 
@@ -92,6 +134,10 @@ static void vLog(log_level level, const char* owner, const char* message, log_co
 #endif
 	char buf[len+1];
 	vsnprintf(buf, len + 1, message, ap);
+	if (DeferMessage(level, owner, buf, color)) {
+		return;
+	}
+	LogDeferred();
 	for (size_t i = 0; i < theLogger.size(); ++i) {
 		theLogger[i]->log(level, owner, buf, color);
 	}
@@ -127,6 +173,10 @@ void Log(log_level level, const char* owner, const char* message, ...)
 
 void Log(log_level level, const char* owner, StringBuffer const& buffer)
 {
+	if (DeferMessage(level, owner, buffer.get().c_str(), WHITE)) {
+		return;
+	}
+	LogDeferred();
 	for (size_t i = 0; i < theLogger.size(); ++i) {
 		theLogger[i]->log(level, owner, buffer.get().c_str(), WHITE);
 	}
@@ -0,0 +1,215 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "System/MappedFileStream.h"
+
+#include "win32def.h"
+
+#include "Interface.h"
+#include "System/Thread.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace GemRB {
+
+// clones and slices are released on whichever thread loaded them
+static Mutex RefcountMutex;
+
+// the mapped file, shared by all the streams looking into it
+#ifdef WIN32
+struct MappedFileStream::Mapping {
+	HANDLE file, mapping;
+	char* data;
+	unsigned long length;
+	int refcount;
+
+	Mapping() : file(INVALID_HANDLE_VALUE), mapping(NULL), data(NULL), length(0), refcount(1) {}
+	~Mapping() {
+		if (data) UnmapViewOfFile(data);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+	}
+	bool Map(const char *name) {
+		file = CreateFile(name,
+			GENERIC_READ,
+			FILE_SHARE_READ,
+			NULL,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		DWORD high;
+		DWORD low = GetFileSize(file, &high);
+		if (high || (low == 0xFFFFFFFF && GetLastError() != NO_ERROR)) {
+			return false;
+		}
+		length = low;
+		if (!length) {
+			return true;
+		}
+		mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!mapping) {
+			return false;
+		}
+		data = (char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		return data != NULL;
+	}
+};
+#else
+struct MappedFileStream::Mapping {
+	char* data;
+	unsigned long length;
+	int refcount;
+
+	Mapping() : data(NULL), length(0), refcount(1) {}
+	~Mapping() {
+		if (data) munmap(data, length);
+	}
+	bool Map(const char *name) {
+		int fd = open(name, O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+			close(fd);
+			return false;
+		}
+		length = st.st_size;
+		if (!length) {
+			close(fd);
+			return true;
+		}
+		void *ptr = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		// the mapping stays valid without the descriptor
+		close(fd);
+		if (ptr == MAP_FAILED) {
+			return false;
+		}
+		data = (char *) ptr;
+		return true;
+	}
+};
+#endif
+
+MappedFileStream::MappedFileStream(Mapping* map, const char* name, unsigned long offset, unsigned long size)
+	: map(map), offset(offset)
+{
+	RefcountMutex.Lock();
+	map->refcount++;
+	RefcountMutex.Unlock();
+	this->size = size;
+	ExtractFileFromPath(filename, name);
+	strlcpy(originalfile, name, _MAX_PATH);
+}
+
+MappedFileStream::~MappedFileStream(void)
+{
+	RefcountMutex.Lock();
+	bool last = !--map->refcount;
+	RefcountMutex.Unlock();
+	if (last) {
+		delete map;
+	}
+}
+
+DataStream* MappedFileStream::Clone()
+{
+	return new MappedFileStream(map, originalfile, offset, size + (Encrypted ? 2 : 0));
+}
+
+MappedFileStream* MappedFileStream::Slice(unsigned long startpos, unsigned long size)
+{
+	if (startpos > this->size) {
+		startpos = this->size;
+	}
+	if (size > this->size - startpos) {
+		size = this->size - startpos;
+	}
+	return new MappedFileStream(map, originalfile, offset + startpos, size);
+}
+
+int MappedFileStream::Read(void* dest, unsigned int length)
+{
+	//we don't allow partial reads anyway, so it isn't a problem that
+	//i don't adjust length here (partial reads are evil)
+	if (Pos+length>size ) {
+		return GEM_ERROR;
+	}
+
+	memcpy(dest, map->data + offset + Pos + (Encrypted ? 2 : 0), length);
+	if (Encrypted) {
+		ReadDecrypted( dest, length );
+	}
+	Pos += length;
+	return length;
+}
+
+int MappedFileStream::Write(const void* /*src*/, unsigned int /*length*/)
+{
+	return GEM_ERROR;
+}
+
+int MappedFileStream::Seek(int newpos, int type)
+{
+	switch (type) {
+		case GEM_CURRENT_POS:
+			Pos += newpos;
+			break;
+
+		case GEM_STREAM_START:
+			Pos = newpos;
+			break;
+
+		case GEM_STREAM_END:
+			Pos = size - newpos;
+			break;
+
+		default:
+			return GEM_ERROR;
+	}
+	//we went past the buffer
+	if (Pos>size) {
+		print("[Streams]: Invalid seek position %ld in file %s(limit: %ld)", Pos, filename, size);
+		return GEM_ERROR;
+	}
+	return GEM_OK;
+}
+
+MappedFileStream* MappedFileStream::OpenFile(const char* filename)
+{
+	Mapping *map = new Mapping();
+	if (!map->Map(filename)) {
+		delete map;
+		return NULL;
+	}
+	MappedFileStream *ms = new MappedFileStream(map, filename, 0, map->length);
+	// the stream holds the only reference now
+	map->refcount--;
+	return ms;
+}
+
+}
@@ -0,0 +1,72 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+/**
+ * @file MappedFileStream.h
+ * Declares MappedFileStream class, read-only stream over a memory mapped file.
+ * @author The GemRB Project
+ */
+
+
+#ifndef MAPPEDFILESTREAM_H
+#define MAPPEDFILESTREAM_H
+
+#include "System/DataStream.h"
+
+#include "exports.h"
+#include "globals.h"
+
+namespace GemRB {
+
+/**
+ * @class MappedFileStream
+ * Reads data from a file mapped into memory. Clones and slices share the
+ * mapping, so handing out a part of the file costs no I/O and no copying.
+ */
+
+class GEM_EXPORT MappedFileStream : public DataStream {
+private:
+	struct Mapping;
+	Mapping* map;
+	unsigned long offset; //start of this view in the mapping
+	MappedFileStream(Mapping* map, const char* name, unsigned long offset, unsigned long size);
+public:
+	~MappedFileStream(void);
+	DataStream* Clone();
+
+	int Read(void* dest, unsigned int length);
+	int Write(const void* src, unsigned int length);
+	int Seek(int pos, int startpos);
+
+	/** Returns a stream over size bytes starting at startpos,
+	 *  sharing the mapping of this one.
+	 */
+	MappedFileStream* Slice(unsigned long startpos, unsigned long size);
+public:
+	/** Maps the specified file.
+	 *
+	 *  Returns NULL, if the file can't be opened or mapped.
+	 */
+	static MappedFileStream* OpenFile(const char* filename);
+};
+
+}
+
+#endif  // ! MAPPEDFILESTREAM_H
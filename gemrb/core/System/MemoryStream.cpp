@@ -25,11 +25,14 @@
 
 #include "Interface.h"
 
+#include <cassert>
+
 namespace GemRB {
 
 MemoryStream::MemoryStream(char *name, void* data, unsigned long size)
-	: data((char*)data)
+	: data((char*)data), capacity(size)
 {
+	assert(data || !size);
 	this->size = size;
 	ExtractFileFromPath(filename, name);
 	strlcpy(originalfile, name, _MAX_PATH);
@@ -65,12 +68,24 @@ int MemoryStream::Read(void* dest, unsigned int length)
 
 int MemoryStream::Write(const void* src, unsigned int length)
 {
-	if (Pos+length>size ) {
-		//error("MemoryStream", "We don't support appending to memory streams yet.");
-		return GEM_ERROR;
+	if (Pos+length>capacity) {
+		//appending, grow geometrically so it stays linear
+		unsigned long wanted = capacity * 2;
+		if (wanted < Pos+length) {
+			wanted = Pos+length;
+		}
+		char *grown = (char *) realloc(data, wanted);
+		if (!grown) {
+			return GEM_ERROR;
+		}
+		data = grown;
+		capacity = wanted;
 	}
 	memcpy(data+Pos, src, length);
 	Pos += length;
+	if (Pos>size) {
+		size = Pos;
+	}
 	return length;
 }
 
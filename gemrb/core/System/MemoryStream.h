@@ -31,7 +31,11 @@ class GEM_EXPORT MemoryStream : public DataStream
 {
 private:
 	char *data;
+	//allocated bytes, writes past the end grow it ahead of size
+	unsigned long capacity;
 public:
+	/** Takes over data, which has to be malloced, since it gets
+	 *  realloced by writes past the end and freed with the stream. */
 	MemoryStream(char *name, void* data, unsigned long size);
 	~MemoryStream();
 	DataStream* Clone();
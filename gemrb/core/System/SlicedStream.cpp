@@ -20,6 +20,7 @@
 
 #include "System/SlicedStream.h"
 
+#include "System/MappedFileStream.h"
 #include "System/MemoryStream.h"
 
 #include "win32def.h"
@@ -100,6 +101,11 @@ int SlicedStream::Seek(int newpos, int type)
 
 DataStream* SliceStream(DataStream* str, unsigned long startpos, unsigned long size, bool preservepos)
 {
+	// mapped files can hand out a view of themselves without any copying
+	MappedFileStream *mapped = dynamic_cast<MappedFileStream*>(str);
+	if (mapped) {
+		return mapped->Slice(startpos, size);
+	}
 	if (size <= 16384) {
 		// small (or empty) substream, just read it into a buffer instead of expensive file I/O
 		unsigned long oldpos;
@@ -0,0 +1,271 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2015 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "System/Thread.h"
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+namespace GemRB {
+
+//more threads than this don't pay off for our short jobs
+#define MAX_WORKERS 8
+
+static bool mainThreadSet = false;
+#ifdef WIN32
+static DWORD mainThread;
+#else
+static pthread_t mainThread;
+#endif
+
+void SetMainThread()
+{
+#ifdef WIN32
+	mainThread = GetCurrentThreadId();
+#else
+	mainThread = pthread_self();
+#endif
+	mainThreadSet = true;
+}
+
+bool IsMainThread()
+{
+	if (!mainThreadSet) {
+		return true;
+	}
+#ifdef WIN32
+	return GetCurrentThreadId() == mainThread;
+#else
+	return pthread_equal(pthread_self(), mainThread) != 0;
+#endif
+}
+
+#ifdef WIN32
+
+Mutex::Mutex()
+{
+	InitializeCriticalSection(&cs);
+}
+
+Mutex::~Mutex()
+{
+	DeleteCriticalSection(&cs);
+}
+
+void Mutex::Lock()
+{
+	EnterCriticalSection(&cs);
+}
+
+void Mutex::Unlock()
+{
+	LeaveCriticalSection(&cs);
+}
+
+ConditionVariable::ConditionVariable()
+{
+	InitializeConditionVariable(&cond);
+}
+
+ConditionVariable::~ConditionVariable()
+{
+}
+
+void ConditionVariable::Wait(Mutex &mutex)
+{
+	SleepConditionVariableCS(&cond, &mutex.cs, INFINITE);
+}
+
+void ConditionVariable::Signal()
+{
+	WakeConditionVariable(&cond);
+}
+
+void ConditionVariable::Broadcast()
+{
+	WakeAllConditionVariable(&cond);
+}
+
+#else
+
+Mutex::Mutex()
+{
+	pthread_mutex_init(&mutex, NULL);
+}
+
+Mutex::~Mutex()
+{
+	pthread_mutex_destroy(&mutex);
+}
+
+void Mutex::Lock()
+{
+	pthread_mutex_lock(&mutex);
+}
+
+void Mutex::Unlock()
+{
+	pthread_mutex_unlock(&mutex);
+}
+
+ConditionVariable::ConditionVariable()
+{
+	pthread_cond_init(&cond, NULL);
+}
+
+ConditionVariable::~ConditionVariable()
+{
+	pthread_cond_destroy(&cond);
+}
+
+void ConditionVariable::Wait(Mutex &m)
+{
+	pthread_cond_wait(&cond, &m.mutex);
+}
+
+void ConditionVariable::Signal()
+{
+	pthread_cond_signal(&cond);
+}
+
+void ConditionVariable::Broadcast()
+{
+	pthread_cond_broadcast(&cond);
+}
+
+#endif
+
+unsigned int WorkerPool::GetProcessorCount()
+{
+	long count;
+#ifdef WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	count = info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	count = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+	count = 1;
+#endif
+	if (count < 1) {
+		count = 1;
+	}
+	return (unsigned int) count;
+}
+
+WorkerPool::WorkerPool(unsigned int count)
+	: pending(0), quit(false)
+{
+	if (!count) {
+		count = GetProcessorCount();
+	}
+	if (count > MAX_WORKERS) {
+		count = MAX_WORKERS;
+	}
+	for (unsigned int i = 0; i < count; i++) {
+#ifdef WIN32
+		HANDLE thread = CreateThread(NULL, 0, Start, this, 0, NULL);
+		if (!thread) {
+			break;
+		}
+#else
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, Start, this)) {
+			break;
+		}
+#endif
+		threads.push_back(thread);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	mutex.Lock();
+	quit = true;
+	wake.Broadcast();
+	mutex.Unlock();
+	for (size_t i = 0; i < threads.size(); i++) {
+#ifdef WIN32
+		WaitForSingleObject(threads[i], INFINITE);
+		CloseHandle(threads[i]);
+#else
+		pthread_join(threads[i], NULL);
+#endif
+	}
+}
+
+#ifdef WIN32
+DWORD WINAPI WorkerPool::Start(void *pool)
+{
+	((WorkerPool *) pool)->Work();
+	return 0;
+}
+#else
+void *WorkerPool::Start(void *pool)
+{
+	((WorkerPool *) pool)->Work();
+	return NULL;
+}
+#endif
+
+void WorkerPool::Work()
+{
+	MutexLock lock(mutex);
+	while (true) {
+		while (queue.empty() && !quit) {
+			wake.Wait(mutex);
+		}
+		//the queue is drained before quitting
+		if (queue.empty()) {
+			return;
+		}
+		Task *task = queue.front();
+		queue.pop_front();
+		mutex.Unlock();
+		task->Run();
+		mutex.Lock();
+		if (!--pending) {
+			done.Broadcast();
+		}
+	}
+}
+
+void WorkerPool::Submit(Task *task)
+{
+	if (threads.empty()) {
+		task->Run();
+		return;
+	}
+	MutexLock lock(mutex);
+	queue.push_back(task);
+	pending++;
+	wake.Signal();
+}
+
+void WorkerPool::Wait()
+{
+	MutexLock lock(mutex);
+	while (pending) {
+		done.Wait(mutex);
+	}
+}
+
+}
@@ -0,0 +1,142 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2015 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+/**
+ * @file Thread.h
+ * Declares minimal threading primitives and a worker pool for the core.
+ * The core itself is single threaded; these are only meant for offloading
+ * self contained jobs (compression, decoding) that touch no shared state
+ * without locking it.
+ * @author The GemRB Project
+ */
+
+#ifndef THREAD_H
+#define THREAD_H
+
+#include "exports.h"
+
+#include <deque>
+#include <vector>
+
+#ifdef WIN32
+# include "win32def.h"
+#else
+# include <pthread.h>
+#endif
+
+namespace GemRB {
+
+class GEM_EXPORT Mutex {
+public:
+	Mutex();
+	~Mutex();
+	void Lock();
+	void Unlock();
+private:
+	Mutex(const Mutex &);
+	Mutex &operator=(const Mutex &);
+#ifdef WIN32
+	CRITICAL_SECTION cs;
+#else
+	pthread_mutex_t mutex;
+#endif
+	friend class ConditionVariable;
+};
+
+/** Locks a mutex for the lifetime of the object. */
+class MutexLock {
+public:
+	MutexLock(Mutex &m) : mutex(m) { mutex.Lock(); }
+	~MutexLock() { mutex.Unlock(); }
+private:
+	MutexLock(const MutexLock &);
+	MutexLock &operator=(const MutexLock &);
+	Mutex &mutex;
+};
+
+class GEM_EXPORT ConditionVariable {
+public:
+	ConditionVariable();
+	~ConditionVariable();
+	/** Waits for a signal; the mutex must be locked by the caller. */
+	void Wait(Mutex &mutex);
+	void Signal();
+	void Broadcast();
+private:
+	ConditionVariable(const ConditionVariable &);
+	ConditionVariable &operator=(const ConditionVariable &);
+#ifdef WIN32
+	CONDITION_VARIABLE cond;
+#else
+	pthread_cond_t cond;
+#endif
+};
+
+/** Remembers the calling thread as the one running the core. */
+GEM_EXPORT void SetMainThread();
+/** True if called from the thread running the core (or before it was set). */
+GEM_EXPORT bool IsMainThread();
+
+/** A unit of work for the WorkerPool. The pool does not take ownership. */
+class GEM_EXPORT Task {
+public:
+	virtual ~Task() {}
+	virtual void Run() = 0;
+};
+
+/**
+ * @class WorkerPool
+ * Runs submitted tasks on a fixed set of threads. If no thread could be
+ * started, Submit runs the task inline, so callers need no serial fallback.
+ */
+class GEM_EXPORT WorkerPool {
+public:
+	/** Zero threads means one per processor. */
+	WorkerPool(unsigned int threads = 0);
+	/** Finishes the queued tasks and joins the threads. */
+	~WorkerPool();
+	void Submit(Task *task);
+	/** Blocks until every submitted task has run. */
+	void Wait();
+	unsigned int GetThreadCount() const { return (unsigned int) threads.size(); }
+
+	static unsigned int GetProcessorCount();
+private:
+	WorkerPool(const WorkerPool &);
+	WorkerPool &operator=(const WorkerPool &);
+	void Work();
+#ifdef WIN32
+	static DWORD WINAPI Start(void *pool);
+	std::vector<HANDLE> threads;
+#else
+	static void *Start(void *pool);
+	std::vector<pthread_t> threads;
+#endif
+	std::deque<Task *> queue;
+	unsigned int pending;
+	bool quit;
+	Mutex mutex;
+	ConditionVariable wake;
+	ConditionVariable done;
+};
+
+}
+
+#endif
@@ -25,6 +25,8 @@
 
 namespace GemRB {
 
+ieDword Variables::Changes = 0;
+
 /////////////////////////////////////////////////////////////////////////////
 // private inlines 
 inline bool Variables::MyCopyKey(char*& dest, const char* key) const
@@ -66,7 +68,7 @@ inline unsigned int Variables::MyCompareKey(const char* key, const char *str) co
 	return 0;
 }
 
-inline unsigned int Variables::MyHashKey(const char* key) const
+unsigned int Variables::HashKey(const char* key)
 {
 	unsigned int nHash = 0;
 	for (int i = 0; key[i] && i < MAX_VARIABLE_LENGTH; i++) {
@@ -146,6 +148,9 @@ void Variables::InitHashTable(unsigned int nHashSize, bool bAllocNow)
 
 void Variables::RemoveAll(ReleaseFun fun)
 {
+	if (m_nCount && m_type == GEM_VARIABLES_INT) {
+		Changes++;
+	}
 	if (m_pHashTable != NULL) {
 		// destroy elements (values and keys)
 		for (unsigned int nHash = 0; nHash < m_nHashTableSize; nHash++) {
@@ -246,10 +251,28 @@ void Variables::FreeAssoc(Variables::MyAssoc* pAssoc)
 	}
 }
 
+Variables::MyAssoc* Variables::NewAssocAt(const char* key, unsigned int hash, unsigned int nHash)
+{
+	if (m_pHashTable == NULL)
+		InitHashTable( m_nHashTableSize );
+
+	Variables::MyAssoc* pAssoc = NewAssoc( key );
+	pAssoc->nKeyHash = hash;
+	// put into hash table
+	pAssoc->pNext = m_pHashTable[nHash];
+	m_pHashTable[nHash] = pAssoc;
+	return pAssoc;
+}
+
 Variables::MyAssoc* Variables::GetAssocAt(const char* key, unsigned int& nHash) const
+{
+	return GetAssocAt( key, HashKey( key ), nHash );
+}
+
+Variables::MyAssoc* Variables::GetAssocAt(const char* key, unsigned int hash, unsigned int& nHash) const
 	// find association (or return NULL)
 {
-	nHash = MyHashKey( key ) % m_nHashTableSize;
+	nHash = hash % m_nHashTableSize;
 
 	if (m_pHashTable == NULL) {
 		return NULL;
@@ -260,6 +283,9 @@ Variables::MyAssoc* Variables::GetAssocAt(const char* key, unsigned int& nHash)
 	for (pAssoc = m_pHashTable[nHash];
 		pAssoc != NULL;
 		pAssoc = pAssoc->pNext) {
+		if (pAssoc->nKeyHash != hash) {
+			continue;
+		}
 		if (m_lParseKey) {
 			if (!MyCompareKey( pAssoc->key, key) ) {
 				return pAssoc;
@@ -326,10 +352,15 @@ bool Variables::Lookup(const char* key, void *&dest) const
 }
 
 bool Variables::Lookup(const char* key, ieDword& rValue) const
+{
+	return Lookup( key, HashKey( key ), rValue );
+}
+
+bool Variables::Lookup(const char* key, unsigned int hash, ieDword& rValue) const
 {
 	unsigned int nHash;
 	assert(m_type==GEM_VARIABLES_INT);
-	Variables::MyAssoc* pAssoc = GetAssocAt( key, nHash );
+	Variables::MyAssoc* pAssoc = GetAssocAt( key, hash, nHash );
 	if (pAssoc == NULL) {
 		return false;
 	} // not in map
@@ -366,15 +397,10 @@ void Variables::SetAt(const char* key, char* value)
 #endif
 
 	assert( m_type == GEM_VARIABLES_STRING );
-	if (( pAssoc = GetAssocAt( key, nHash ) ) == NULL) {
-		if (m_pHashTable == NULL)
-			InitHashTable( m_nHashTableSize );
-
+	unsigned int hash = HashKey( key );
+	if (( pAssoc = GetAssocAt( key, hash, nHash ) ) == NULL) {
 		// it doesn't exist, add a new Association
-		pAssoc = NewAssoc( key );
-		// put into hash table
-		pAssoc->pNext = m_pHashTable[nHash];
-		m_pHashTable[nHash] = pAssoc;
+		pAssoc = NewAssocAt( key, hash, nHash );
 	} else {
 		if (pAssoc->Value.sValue) {
 			free( pAssoc->Value.sValue );
@@ -395,15 +421,10 @@ void Variables::SetAt(const char* key, void* value)
 	Variables::MyAssoc* pAssoc;
 
 	assert( m_type == GEM_VARIABLES_POINTER );
-	if (( pAssoc = GetAssocAt( key, nHash ) ) == NULL) {
-		if (m_pHashTable == NULL)
-			InitHashTable( m_nHashTableSize );
-
+	unsigned int hash = HashKey( key );
+	if (( pAssoc = GetAssocAt( key, hash, nHash ) ) == NULL) {
 		// it doesn't exist, add a new Association
-		pAssoc = NewAssoc( key );
-		// put into hash table
-		pAssoc->pNext = m_pHashTable[nHash];
-		m_pHashTable[nHash] = pAssoc;
+		pAssoc = NewAssocAt( key, hash, nHash );
 	} else {
 		if (pAssoc->Value.sValue) {
 			free( pAssoc->Value.sValue );
@@ -421,25 +442,27 @@ void Variables::SetAt(const char* key, void* value)
 
 
 void Variables::SetAt(const char* key, ieDword value, bool nocreate)
+{
+	SetAt( key, HashKey( key ), value, nocreate );
+}
+
+void Variables::SetAt(const char* key, unsigned int hash, ieDword value, bool nocreate)
 {
 	unsigned int nHash;
 	Variables::MyAssoc* pAssoc;
 
 	assert( m_type == GEM_VARIABLES_INT );
-	if (( pAssoc = GetAssocAt( key, nHash ) ) == NULL) {
+	if (( pAssoc = GetAssocAt( key, hash, nHash ) ) == NULL) {
 		if (nocreate) {
 			Log(WARNING, "Variables", "Cannot create new variable: %s", key);
 			return;
 		}
 
-		if (m_pHashTable == NULL)
-			InitHashTable( m_nHashTableSize );
-
 		// it doesn't exist, add a new Association
-		pAssoc = NewAssoc( key );
-		// put into hash table
-		pAssoc->pNext = m_pHashTable[nHash];
-		m_pHashTable[nHash] = pAssoc;
+		pAssoc = NewAssocAt( key, hash, nHash );
+		Changes++;
+	} else if (pAssoc->Value.nValue != value) {
+		Changes++;
 	}
 	//set value only if we have a key
 	if (pAssoc->key) {
@@ -455,6 +478,9 @@ void Variables::Remove(const char* key)
 
 	pAssoc = GetAssocAt( key, nHash );
 	if (!pAssoc) return; // not in there
+	if (m_type == GEM_VARIABLES_INT) {
+		Changes++;
+	}
 
 	if (pAssoc == m_pHashTable[nHash]) {
 		// head
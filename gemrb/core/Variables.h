@@ -51,6 +51,7 @@ protected:
 			void* pValue;
 		} Value;
 		unsigned long nHashValue;
+		unsigned int nKeyHash; //HashKey(key), checked before comparing the keys
 		friend class Variables;
 	};
 	struct MemBlock {
@@ -86,11 +87,20 @@ public:
 	{
 		return m_nCount == 0;
 	}
+	//bumped on every change of an integer variable anywhere
+	static ieDword GetChanges()
+	{
+		return Changes;
+	}
+
+	//the same for any table, so callers may precompute it for their keys
+	static unsigned int HashKey(const char* key);
 
 	// Lookup
 	int GetValueLength(const char* key) const;
 	bool Lookup(const char* key, char* dest, int MaxLength) const;
 	bool Lookup(const char* key, ieDword& rValue) const;
+	bool Lookup(const char* key, unsigned int hash, ieDword& rValue) const;
 	bool Lookup(const char* key, char*& dest) const;
 	bool Lookup(const char* key, void*& dest) const;
 
@@ -100,6 +110,7 @@ public:
 	void SetAt(const char* key, char* newValue);
 	void SetAt(const char* key, void* newValue);
 	void SetAt(const char* key, ieDword newValue, bool nocreate=false);
+	void SetAt(const char* key, unsigned int hash, ieDword newValue, bool nocreate=false);
 	void Remove(const char* key);
 	void RemoveAll(ReleaseFun fun);
 	void InitHashTable(unsigned int hashSize, bool bAllocNow = true);
@@ -119,13 +130,15 @@ protected:
 	MemBlock* m_pBlocks;
 	int m_nBlockSize;
 	int m_type; //could be string or ieDword 
+	static ieDword Changes;
 
 	Variables::MyAssoc* NewAssoc(const char* key);
 	void FreeAssoc(Variables::MyAssoc*);
 	Variables::MyAssoc* GetAssocAt(const char*, unsigned int&) const;
+	Variables::MyAssoc* GetAssocAt(const char*, unsigned int, unsigned int&) const;
+	Variables::MyAssoc* NewAssocAt(const char*, unsigned int, unsigned int);
 	inline bool MyCopyKey(char*& dest, const char* key) const;
 	inline unsigned int MyCompareKey(const char* key, const char *str) const;
-	inline unsigned int MyHashKey(const char*) const;
 
 public:
 	~Variables();
@@ -90,7 +90,8 @@ enum {
 	PLUGIN_RESOURCE_CACHEDDIRECTORY,
 	PLUGIN_RESOURCE_NULL,
 	PLUGIN_IMAGE_WRITER_BMP,
-	PLUGIN_COMPRESSION_ZLIB
+	PLUGIN_COMPRESSION_ZLIB,
+	PLUGIN_RESOURCE_SAVEGAME
 };
 
 }
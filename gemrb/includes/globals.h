@@ -210,6 +210,27 @@ inline unsigned long GetTickCount()
 	gettimeofday(&tv, NULL);
 	return (tv.tv_usec/1000) + (tv.tv_sec*1000);
 }
+
+//only for measuring short intervals (profiling), it wraps around
+inline unsigned long GetMicroTicks()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_usec + (tv.tv_sec*1000000);
+}
+#else
+inline unsigned long GetMicroTicks()
+{
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER now;
+	if (!frequency.QuadPart) {
+		QueryPerformanceFrequency(&frequency);
+	}
+	QueryPerformanceCounter(&now);
+	//split, so the scaling can't overflow
+	return (unsigned long) ((now.QuadPart / frequency.QuadPart) * 1000000 +
+		(now.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart);
+}
 #endif
 
 inline bool valid_number(const char* string, long& val)
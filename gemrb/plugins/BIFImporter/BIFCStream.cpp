@@ -0,0 +1,249 @@
+/* GemRB - Infinity Engine Emulator
+ * Copyright (C) 2003 The GemRB Project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include "BIFCStream.h"
+
+#include "win32def.h"
+
+#include "Compressor.h"
+#include "Interface.h"
+#include "PluginMgr.h"
+#include "System/MemoryStream.h"
+#include "System/Thread.h"
+
+#include <list>
+#include <vector>
+
+namespace GemRB {
+
+struct BIFCBlock {
+	ieDword compOffset; //offset of the compressed data in the archive
+	ieDword compSize;
+	ieDword start; //offset of the inflated data in the bif
+	ieDword size;
+	MemoryStream* data; //the inflated block, NULL if not cached
+	std::list<size_t>::iterator lru;
+};
+
+// the index and the inflated blocks, shared by the clones
+// the clones may be read on the ambient thread, so the blocks, the source
+// and the refcount are only touched with the mutex held
+struct BIFCStream::Archive {
+	DataStream* source;
+	std::vector<BIFCBlock> blocks;
+	std::list<size_t> recent; //cached blocks, most recently used first
+	unsigned int cached, cacheSize; //bytes
+	int refcount;
+	PluginHolder<Compressor> comp;
+	Mutex mutex;
+
+	Archive(DataStream* source, unsigned int cacheSize)
+		: source(source), cached(0), cacheSize(cacheSize), refcount(1),
+		comp(PLUGIN_COMPRESSION_ZLIB)
+	{
+	}
+	~Archive()
+	{
+		for (size_t i = 0; i < blocks.size(); i++) {
+			delete blocks[i].data;
+		}
+		delete source;
+	}
+	size_t FindBlock(unsigned long pos) const;
+	MemoryStream* GetBlock(size_t i);
+};
+
+size_t BIFCStream::Archive::FindBlock(unsigned long pos) const
+{
+	size_t lo = 0;
+	size_t hi = blocks.size();
+	while (hi - lo > 1) {
+		size_t mid = (lo + hi) / 2;
+		if (blocks[mid].start <= pos) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+MemoryStream* BIFCStream::Archive::GetBlock(size_t i)
+{
+	BIFCBlock &block = blocks[i];
+	if (block.data) {
+		recent.splice(recent.begin(), recent, block.lru);
+		return block.data;
+	}
+
+	// make room, but always keep the block being read
+	while (!recent.empty() && cached + block.size > cacheSize) {
+		BIFCBlock &old = blocks[recent.back()];
+		cached -= old.size;
+		delete old.data;
+		old.data = NULL;
+		recent.pop_back();
+	}
+
+	source->Seek(block.compOffset, GEM_STREAM_START);
+	MemoryStream *data = new MemoryStream(source->originalfile, malloc(block.size), block.size);
+	if (comp->Decompress(data, source, block.compSize) != GEM_OK || data->GetPos() != block.size) {
+		Log(ERROR, "BIFCStream", "Cannot decompress block %d of %s.", (int) i, source->originalfile);
+		delete data;
+		return NULL;
+	}
+	block.data = data;
+	recent.push_front(i);
+	block.lru = recent.begin();
+	cached += block.size;
+	return data;
+}
+
+BIFCStream::BIFCStream(Archive* archive)
+	: archive(archive)
+{
+	archive->mutex.Lock();
+	archive->refcount++;
+	archive->mutex.Unlock();
+	size = archive->blocks.back().start + archive->blocks.back().size;
+	strlcpy(originalfile, archive->source->originalfile, _MAX_PATH);
+	strlcpy(filename, archive->source->filename, sizeof(filename));
+}
+
+BIFCStream::~BIFCStream(void)
+{
+	archive->mutex.Lock();
+	bool last = !--archive->refcount;
+	archive->mutex.Unlock();
+	if (last) {
+		delete archive;
+	}
+}
+
+DataStream* BIFCStream::Clone()
+{
+	return new BIFCStream(archive);
+}
+
+int BIFCStream::Read(void* dest, unsigned int length)
+{
+	//we don't allow partial reads anyway, so it isn't a problem that
+	//i don't adjust length here (partial reads are evil)
+	if (Pos+length>size ) {
+		return GEM_ERROR;
+	}
+
+	MutexLock l(archive->mutex);
+	char *out = (char *) dest;
+	unsigned int left = length;
+	size_t i = archive->FindBlock(Pos);
+	while (left) {
+		MemoryStream *data = archive->GetBlock(i);
+		if (!data) {
+			return GEM_ERROR;
+		}
+		const BIFCBlock &block = archive->blocks[i];
+		unsigned int offset = Pos - block.start;
+		unsigned int chunk = block.size - offset;
+		if (chunk > left) {
+			chunk = left;
+		}
+		data->Seek(offset, GEM_STREAM_START);
+		data->Read(out, chunk);
+		out += chunk;
+		left -= chunk;
+		Pos += chunk;
+		i++;
+	}
+	return length;
+}
+
+int BIFCStream::Write(const void* /*src*/, unsigned int /*length*/)
+{
+	return GEM_ERROR;
+}
+
+int BIFCStream::Seek(int newpos, int type)
+{
+	switch (type) {
+		case GEM_CURRENT_POS:
+			Pos += newpos;
+			break;
+
+		case GEM_STREAM_START:
+			Pos = newpos;
+			break;
+
+		case GEM_STREAM_END:
+			Pos = size - newpos;
+			break;
+
+		default:
+			return GEM_ERROR;
+	}
+	//we went past the buffer
+	if (Pos>size) {
+		print("[Streams]: Invalid seek position %ld in file %s(limit: %ld)", Pos, filename, size);
+		return GEM_ERROR;
+	}
+	return GEM_OK;
+}
+
+BIFCStream* BIFCStream::OpenArchive(DataStream* compressed, unsigned int cacheSize)
+{
+	if (!core->IsAvailable( PLUGIN_COMPRESSION_ZLIB )) {
+		delete compressed;
+		return NULL;
+	}
+	Archive *archive = new Archive(compressed, cacheSize);
+
+	// every block is preceded by its inflated and compressed length
+	ieDword unCompBifSize;
+	ieDword finalsize = 0;
+	compressed->ReadDword( &unCompBifSize );
+	while (finalsize < unCompBifSize) {
+		BIFCBlock block;
+		if (compressed->ReadDword( &block.size ) != 4 ||
+			compressed->ReadDword( &block.compSize ) != 4 ||
+			!block.size) {
+			break;
+		}
+		block.compOffset = compressed->GetPos();
+		block.start = finalsize;
+		block.data = NULL;
+		if (compressed->Seek( block.compSize, GEM_CURRENT_POS ) != GEM_OK) {
+			break;
+		}
+		archive->blocks.push_back(block);
+		finalsize += block.size;
+	}
+	if (finalsize < unCompBifSize || archive->blocks.empty()) {
+		Log(ERROR, "BIFCStream", "Broken block list in %s.", compressed->originalfile);
+		delete archive;
+		return NULL;
+	}
+
+	BIFCStream *str = new BIFCStream(archive);
+	// the stream holds the only reference now
+	archive->refcount--;
+	return str;
+}
+
+}
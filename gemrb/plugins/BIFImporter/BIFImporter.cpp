@@ -20,6 +20,8 @@
 
 #include "BIFImporter.h"
 
+#include "BIFCStream.h"
+
 #include "win32def.h"
 
 #include "Compressor.h"
@@ -28,6 +30,7 @@
 #include "PluginMgr.h"
 #include "System/SlicedStream.h"
 #include "System/FileStream.h"
+#include "System/MappedFileStream.h"
 
 using namespace GemRB;
 
@@ -94,7 +97,7 @@ DataStream* BIFImporter::DecompressBIFC(DataStream* compressed, const char* path
 	}
 	//print("\n");
 	out.Close(); // This is necesary, since windows won't open the file otherwise.
-	return FileStream::OpenFile(path);
+	return OpenBIF(path);
 }
 
 DataStream* BIFImporter::DecompressBIF(DataStream* compressed, const char* /*path*/)
@@ -108,6 +111,16 @@ DataStream* BIFImporter::DecompressBIF(DataStream* compressed, const char* /*pat
 	return CacheCompressedStream(compressed, compressed->filename, complen);
 }
 
+// maps the archive if possible, so GetStream can hand out views of it
+DataStream* BIFImporter::OpenBIF(const char* path)
+{
+	DataStream* str = MappedFileStream::OpenFile(path);
+	if (!str) {
+		str = FileStream::OpenFile(path);
+	}
+	return str;
+}
+
 int BIFImporter::OpenArchive(const char* path)
 {
 	if (stream) {
@@ -120,11 +133,11 @@ int BIFImporter::OpenArchive(const char* path)
 
 	char cachePath[_MAX_PATH];
 	PathJoin(cachePath, core->CachePath, filename, NULL);
-	stream = FileStream::OpenFile(cachePath);
+	stream = OpenBIF(cachePath);
 
 	char Signature[8];
 	if (!stream) {
-		FileStream* file = FileStream::OpenFile(path);
+		DataStream* file = OpenBIF(path);
 		if (!file) {
 			return GEM_ERROR;
 		}
@@ -137,8 +150,13 @@ int BIFImporter::OpenArchive(const char* path)
 			stream = DecompressBIF(file, cachePath);
 			delete file;
 		} else if (strncmp(Signature, "BIFCV1.0", 8) == 0) {
-			stream = DecompressBIFC(file, cachePath);
-			delete file;
+			if (core->BIFCacheSize) {
+				//the blocks get inflated as they are needed
+				stream = BIFCStream::OpenArchive(file, core->BIFCacheSize * 1024);
+			} else {
+				stream = DecompressBIFC(file, cachePath);
+				delete file;
+			}
 		} else if (strncmp( Signature, "BIFFV1  ", 8 ) == 0) {
 			file->Seek(0, GEM_STREAM_START);
 			stream = file;
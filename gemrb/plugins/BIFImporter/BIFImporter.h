@@ -60,6 +60,7 @@ public:
 private:
 	static DataStream* DecompressBIF(DataStream* compressed, const char* path);
 	static DataStream* DecompressBIFC(DataStream* compressed, const char* path);
+	static DataStream* OpenBIF(const char* path);
 	void ReadBIF(void);
 };
 
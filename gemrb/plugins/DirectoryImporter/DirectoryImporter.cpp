@@ -24,6 +24,7 @@
 #include "Interface.h"
 #include "ResourceDesc.h"
 #include "System/FileStream.h"
+#include "System/MappedFileStream.h"
 
 using namespace GemRB;
 
@@ -149,6 +150,17 @@ void CachedDirectoryImporter::Refresh()
 	} while (++it);
 }
 
+// the cached directories hold the read-only game data, so their files can
+// be mapped; the plain ones (like the cache) get rewritten while in use
+static DataStream *OpenMapped(const char *path)
+{
+	DataStream *str = MappedFileStream::OpenFile(path);
+	if (!str) {
+		str = FileStream::OpenFile(path);
+	}
+	return str;
+}
+
 static const char *ConstructFilename(const char* resname, const char* ext)
 {
 	static char buf[_MAX_PATH];
@@ -180,7 +192,7 @@ DataStream* CachedDirectoryImporter::GetResource(const char* resname, SClass_ID
 	char buf[_MAX_PATH];
 	strcpy(buf, path);
 	PathAppend(buf, s->c_str());
-	return FileStream::OpenFile(buf);
+	return OpenMapped(buf);
 }
 
 DataStream* CachedDirectoryImporter::GetResource(const char* resname, const ResourceDesc &type)
@@ -192,7 +204,7 @@ DataStream* CachedDirectoryImporter::GetResource(const char* resname, const Reso
 	char buf[_MAX_PATH];
 	strcpy(buf, path);
 	PathAppend(buf, s->c_str());
-	return FileStream::OpenFile(buf);
+	return OpenMapped(buf);
 }
 
 #include "plugindef.h"
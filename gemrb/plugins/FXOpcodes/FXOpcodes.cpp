@@ -437,16 +437,16 @@ int fx_unknown (Scriptable* Owner, Actor* target, Effect* fx);//???
 // FIXME: Make this an ordered list, so we could use bsearch!
 static EffectDesc effectnames[] = {
 	{ "*Crash*", fx_crash, EFFECT_NO_ACTOR, -1 },
-	{ "AcidResistanceModifier", fx_acid_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "AcidResistanceModifier", fx_acid_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
 	{ "ACVsCreatureType", fx_generic_effect, 0, -1 }, //0xdb
 	{ "ACVsDamageTypeModifier", fx_ac_vs_damage_type_modifier, 0, -1 },
 	{ "ACVsDamageTypeModifier2", fx_ac_vs_damage_type_modifier, 0, -1 }, // used in IWD
 	{ "AidNonCumulative", fx_set_aid_state, 0, -1 },
 	{ "AIIdentifierModifier", fx_ids_modifier, 0, -1 },
-	{ "AlchemyModifier", fx_alchemy_modifier, 0, -1 },
-	{ "Alignment:Change", fx_alignment_change, 0, -1 },
+	{ "AlchemyModifier", fx_alchemy_modifier, EFFECT_STAT_ONLY, -1 },
+	{ "Alignment:Change", fx_alignment_change, EFFECT_STAT_ONLY, -1 },
 	{ "Alignment:Invert", fx_alignment_invert, 0, -1 },
-	{ "AlwaysBackstab", fx_always_backstab_modifier, 0, -1 },
+	{ "AlwaysBackstab", fx_always_backstab_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "AnimationIDModifier", fx_animation_id_modifier, 0, -1 },
 	{ "AnimationStateChange", fx_animation_stance, 0, -1 },
 	{ "ApplyEffect", fx_apply_effect, EFFECT_NO_ACTOR, -1 },
@@ -455,14 +455,14 @@ static EffectDesc effectnames[] = {
 	{ "ApplyEffectItemType", fx_apply_effect_item_type, 0, -1 },
 	{ "ApplyEffectRepeat", fx_apply_effect_repeat, 0, -1 },
 	{ "CutScene2", fx_cutscene2, EFFECT_NO_ACTOR, -1 },
-	{ "AttackSpeedModifier", fx_attackspeed_modifier, 0, -1 },
+	{ "AttackSpeedModifier", fx_attackspeed_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "AttacksPerRoundModifier", fx_attacks_per_round_modifier, 0, -1 },
-	{ "AuraCleansingModifier", fx_auracleansing_modifier, 0, -1 },
+	{ "AuraCleansingModifier", fx_auracleansing_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "SummonDisable", fx_summon_disable, 0, -1 }, //unknown
-	{ "AvatarRemovalModifier", fx_avatar_removal_modifier, 0, -1 },
+	{ "AvatarRemovalModifier", fx_avatar_removal_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "BackstabModifier", fx_backstab_modifier, 0, -1 },
-	{ "BerserkStage1Modifier", fx_berserkstage1_modifier, 0, -1 },
-	{ "BerserkStage2Modifier", fx_berserkstage2_modifier, 0, -1 },
+	{ "BerserkStage1Modifier", fx_berserkstage1_modifier, EFFECT_STAT_ONLY, -1 },
+	{ "BerserkStage2Modifier", fx_berserkstage2_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "BlessNonCumulative", fx_set_bless_state, 0, -1 },
 	{ "Bounce:School", fx_bounce_school, 0, -1 },
 	{ "Bounce:SchoolDec", fx_bounce_school_dec, 0, -1 },
@@ -476,12 +476,12 @@ static EffectDesc effectnames[] = {
 	{ "Bounce:Projectile", fx_bounce_projectile, 0, -1 },
 	{ "CantUseItem", fx_generic_effect, EFFECT_NO_ACTOR, -1 },
 	{ "CantUseItemType", fx_generic_effect, 0, -1 },
-	{ "CanUseAnyItem", fx_can_use_any_item_modifier, 0, -1 },
+	{ "CanUseAnyItem", fx_can_use_any_item_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "CastFromList", fx_select_spell, 0, -1 },
 	{ "CastingGlow", fx_casting_glow, 0, -1 },
 	{ "CastingGlow2", fx_casting_glow, 0, -1 }, //used in iwd
 	{ "CastingLevelModifier", fx_castinglevel_modifier, 0, -1 },
-	{ "CastingSpeedModifier", fx_castingspeed_modifier, 0, -1 },
+	{ "CastingSpeedModifier", fx_castingspeed_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "CastSpellOnCondition", fx_cast_spell_on_condition, 0, -1 },
 	{ "ChangeBardSong", fx_change_bardsong, 0, -1 },
 	{ "ChangeName", fx_change_name, 0, -1 },
@@ -490,8 +490,8 @@ static EffectDesc effectnames[] = {
 	{ "ChantNonCumulative", fx_set_chant_state, 0, -1 },
 	{ "ChaosShieldModifier", fx_chaos_shield_modifier, 0, -1 },
 	{ "CharismaModifier", fx_charisma_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "CheckForBerserkModifier", fx_checkforberserk_modifier, 0, -1 },
-	{ "ColdResistanceModifier", fx_cold_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "CheckForBerserkModifier", fx_checkforberserk_modifier, EFFECT_STAT_ONLY, -1 },
+	{ "ColdResistanceModifier", fx_cold_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
 	{ "Color:BriefRGB", fx_brief_rgb, 0, -1 },
 	{ "Color:GlowRGB", fx_glow_rgb, 0, -1 },
 	{ "Color:DarkenRGB", fx_darken_rgb, 0, -1 },
@@ -503,8 +503,8 @@ static EffectDesc effectnames[] = {
 	{ "ConstitutionModifier", fx_constitution_modifier, EFFECT_SPECIAL_UNDO, -1 },
 	{ "ControlCreature", fx_set_charmed_state, 0, -1 }, //0xf1 same as charm
 	{ "CreateContingency", fx_create_contingency, 0, -1 },
-	{ "CriticalHitModifier", fx_critical_hit_modifier, 0, -1 },
-	{ "CrushingResistanceModifier", fx_crushing_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "CriticalHitModifier", fx_critical_hit_modifier, EFFECT_STAT_ONLY, -1 },
+	{ "CrushingResistanceModifier", fx_crushing_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
 	{ "Cure:Berserk", fx_cure_berserk_state, 0, -1 },
 	{ "Cure:Blind", fx_cure_blind_state, 0, -1 },
 	{ "Cure:CasterHold", fx_unpause_caster, 0, -1 },
@@ -533,20 +533,20 @@ static EffectDesc effectnames[] = {
 	{ "CurrentHPModifier", fx_current_hp_modifier, EFFECT_DICED, -1 },
 	{ "Damage", fx_damage, EFFECT_DICED, -1 },
 	{ "DamageAnimation", fx_damage_animation, 0, -1 },
-	{ "DamageBonusModifier", fx_damage_bonus_modifier, 0, -1 },
+	{ "DamageBonusModifier", fx_damage_bonus_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "DamageBonusModifier2", fx_damage_bonus_modifier2, 0, -1 }, // override for iwd, eventually used in ees and for tobex
-	{ "DamageLuckModifier", fx_damageluck_modifier, 0, -1 },
+	{ "DamageLuckModifier", fx_damageluck_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "DamageVsCreature", fx_generic_effect, 0, -1 },
 	{ "Death", fx_death, 0, -1 },
 	{ "Death2", fx_death, 0, -1 }, //(iwd2 effect)
 	{ "Death3", fx_death, 0, -1 }, //(iwd2 effect too, Banish)
 	{ "DetectAlignment", fx_detect_alignment, 0, -1 },
-	{ "DetectIllusionsModifier", fx_detect_illusion_modifier, 0, -1 },
+	{ "DetectIllusionsModifier", fx_detect_illusion_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "DexterityModifier", fx_dexterity_modifier, EFFECT_SPECIAL_UNDO, -1 },
 	{ "DimensionDoor", fx_dimension_door, 0, -1 },
 	{ "DisableButton", fx_disable_button, 0, -1 }, //sets disable button flag
-	{ "DisableChunk", fx_disable_chunk_modifier, 0, -1 },
-	{ "DisableOverlay", fx_disable_overlay_modifier, 0, -1 },
+	{ "DisableChunk", fx_disable_chunk_modifier, EFFECT_STAT_ONLY, -1 },
+	{ "DisableOverlay", fx_disable_overlay_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "DisableCasting", fx_disable_spellcasting, 0, -1 },
 	{ "Disintegrate", fx_disintegrate, 0, -1 },
 	{ "DispelEffects", fx_dispel_effects, 0, -1 },
@@ -556,40 +556,40 @@ static EffectDesc effectnames[] = {
 	{ "DispelSecondaryTypeOne", fx_dispel_secondary_type_one, 0, -1 },
 	{ "DisplayString", fx_display_string, 0, -1 },
 	{ "Dither", fx_dither, 0, -1 },
-	{ "DontJumpModifier", fx_dontjump_modifier, 0, -1 },
+	{ "DontJumpModifier", fx_dontjump_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "DrainItems", fx_drain_items, 0, -1 },
 	{ "DrainSpells", fx_drain_spells, 0, -1 },
 	{ "DropWeapon", fx_drop_weapon, 0, -1 },
-	{ "ElectricityResistanceModifier", fx_electricity_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "ElectricityResistanceModifier", fx_electricity_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
 	{ "ExistanceDelayModifier", fx_existance_delay_modifier , 0, -1 }, //unknown
 	{ "ExperienceModifier", fx_experience_modifier, 0, -1 },
 	{ "ExploreModifier", fx_explore_modifier, 0, -1 },
 	{ "FamiliarBond", fx_familiar_constitution_loss, 0, -1 },
 	{ "FamiliarMarker", fx_familiar_marker, 0, -1 },
 	{ "Farsee", fx_farsee, 0, -1 },
-	{ "FatigueModifier", fx_fatigue_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "FatigueModifier", fx_fatigue_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
 	{ "FindFamiliar", fx_find_familiar, 0, -1 },
 	{ "FindTraps", fx_find_traps, 0, -1 },
-	{ "FindTrapsModifier", fx_find_traps_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "FireResistanceModifier", fx_fire_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "FistDamageModifier", fx_fist_damage_modifier, 0, -1 },
-	{ "FistHitModifier", fx_fist_to_hit_modifier, 0, -1 },
+	{ "FindTrapsModifier", fx_find_traps_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
+	{ "FireResistanceModifier", fx_fire_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
+	{ "FistDamageModifier", fx_fist_damage_modifier, EFFECT_STAT_ONLY, -1 },
+	{ "FistHitModifier", fx_fist_to_hit_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "ForceSurgeModifier", fx_force_surge_modifier, 0, -1 },
 	{ "ForceVisible", fx_force_visible, 0, -1 }, //not invisible but improved invisible
 	{ "FreeAction", fx_cure_slow_state, 0, -1 },
 	{ "GenerateWish", fx_generate_wish, 0, -1 },
 	{ "GoldModifier", fx_gold_modifier, 0, -1 },
-	{ "HideInShadowsModifier", fx_hide_in_shadows_modifier, 0, -1 },
+	{ "HideInShadowsModifier", fx_hide_in_shadows_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "HLA", fx_generic_effect, 0, -1 },
 	{ "HolyNonCumulative", fx_set_holy_state, 0, -1 },
 	{ "Icon:Disable", fx_disable_portrait_icon, 0, -1 },
 	{ "Icon:Display", fx_display_portrait_icon, 0, -1 },
 	{ "Icon:Remove", fx_remove_portrait_icon, 0, -1 },
 	{ "Identify", fx_identify, 0, -1 },
-	{ "IgnoreDialogPause", fx_ignore_dialogpause_modifier, 0, -1 },
+	{ "IgnoreDialogPause", fx_ignore_dialogpause_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "IntelligenceModifier", fx_intelligence_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "IntoxicationModifier", fx_intoxication_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "InvisibleDetection", fx_see_invisible_modifier, 0, -1 },
+	{ "IntoxicationModifier", fx_intoxication_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
+	{ "InvisibleDetection", fx_see_invisible_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "Item:CreateDays", fx_create_item_days, 0, -1 },
 	{ "Item:CreateInSlot", fx_create_item_in_slot, 0, -1 },
 	{ "Item:CreateInventory", fx_create_inventory_item, 0, -1 },
@@ -598,44 +598,44 @@ static EffectDesc effectnames[] = {
 	{ "Item:Remove", fx_remove_item, 0, -1 }, //70
 	{ "Item:RemoveInventory", fx_remove_inventory_item, 0, -1 },
 	{ "KillCreatureType", fx_kill_creature_type, 0, -1 },
-	{ "LevelModifier", fx_level_modifier, 0, -1 },
+	{ "LevelModifier", fx_level_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "LevelDrainModifier", fx_leveldrain_modifier, 0, -1 },
 	{ "LoreModifier", fx_lore_modifier, EFFECT_SPECIAL_UNDO, -1 },
 	{ "LuckModifier", fx_luck_modifier, EFFECT_NO_LEVEL_CHECK|EFFECT_SPECIAL_UNDO, -1 },
 	{ "LuckCumulative", fx_luck_cumulative, 0, -1 },
 	{ "LuckNonCumulative", fx_luck_non_cumulative, 0, -1 },
-	{ "MagicalColdResistanceModifier", fx_magical_cold_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "MagicalFireResistanceModifier", fx_magical_fire_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "MagicalColdResistanceModifier", fx_magical_cold_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
+	{ "MagicalFireResistanceModifier", fx_magical_fire_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
 	{ "MagicalRest", fx_magical_rest, 0, -1 },
-	{ "MagicDamageResistanceModifier", fx_magic_damage_resistance_modifier, 0, -1 },
+	{ "MagicDamageResistanceModifier", fx_magic_damage_resistance_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "MagicResistanceModifier", fx_magic_resistance_modifier, 0, -1 },
 	{ "MassRaiseDead", fx_mass_raise_dead, EFFECT_NO_ACTOR, -1 },
 	{ "MaximumHPModifier", fx_maximum_hp_modifier, EFFECT_DICED|EFFECT_SPECIAL_UNDO, -1 },
 	{ "Maze", fx_maze, 0, -1 },
-	{ "MeleeDamageModifier", fx_melee_damage_modifier, 0, -1 },
-	{ "MeleeHitModifier", fx_melee_to_hit_modifier, 0, -1 },
-	{ "MinimumHPModifier", fx_minimum_hp_modifier, 0, -1 },
+	{ "MeleeDamageModifier", fx_melee_damage_modifier, EFFECT_STAT_ONLY, -1 },
+	{ "MeleeHitModifier", fx_melee_to_hit_modifier, EFFECT_STAT_ONLY, -1 },
+	{ "MinimumHPModifier", fx_minimum_hp_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "MiscastMagicModifier", fx_miscast_magic_modifier, 0, -1 },
-	{ "MissileDamageModifier", fx_missile_damage_modifier, 0, -1 },
-	{ "MissileHitModifier", fx_missile_to_hit_modifier, 0, -1 },
-	{ "MissilesResistanceModifier", fx_missiles_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "MissileDamageModifier", fx_missile_damage_modifier, EFFECT_STAT_ONLY, -1 },
+	{ "MissileHitModifier", fx_missile_to_hit_modifier, EFFECT_STAT_ONLY, -1 },
+	{ "MissilesResistanceModifier", fx_missiles_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
 	{ "MirrorImage", fx_mirror_image, 0, -1 },
 	{ "MirrorImageModifier", fx_mirror_image_modifier, 0, -1 },
 	{ "ModifyGlobalVariable", fx_modify_global_variable, EFFECT_NO_ACTOR, -1 },
 	{ "ModifyLocalVariable", fx_modify_local_variable, 0, -1 },
 	{ "MonsterSummoning", fx_monster_summoning, EFFECT_NO_ACTOR, -1 },
 	{ "MoraleBreakModifier", fx_morale_break_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "MoraleModifier", fx_morale_modifier, 0, -1 },
+	{ "MoraleModifier", fx_morale_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "MovementRateModifier", fx_movement_modifier, 0, -1 }, //fast (7e)
 	{ "MovementRateModifier2", fx_movement_modifier, 0, -1 },//slow (b0)
 	{ "MovementRateModifier3", fx_movement_modifier, 0, -1 },//forced (IWD - 10a)
 	{ "MovementRateModifier4", fx_movement_modifier, 0, -1 },//slow (IWD2 - 1b9)
 	{ "MoveToArea", fx_move_to_area, 0, -1 }, //0xba
-	{ "NoCircleState", fx_no_circle_state, 0, -1 },
-	{ "NPCBump", fx_npc_bump, 0, -1 },
+	{ "NoCircleState", fx_no_circle_state, EFFECT_STAT_ONLY, -1 },
+	{ "NPCBump", fx_npc_bump, EFFECT_STAT_ONLY, -1 },
 	{ "OffscreenAIModifier", fx_offscreenai_modifier, 0, -1 },
-	{ "OffhandHitModifier", fx_left_to_hit_modifier, 0, -1 },
-	{ "OpenLocksModifier", fx_open_locks_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "OffhandHitModifier", fx_left_to_hit_modifier, EFFECT_STAT_ONLY, -1 },
+	{ "OpenLocksModifier", fx_open_locks_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
 	{ "Overlay:Entangle", fx_set_entangle_state, 0, -1 },
 	{ "Overlay:Grease", fx_set_grease_state, 0, -1 },
 	{ "Overlay:MinorGlobe", fx_set_minorglobe_state, 0, -1 },
@@ -643,12 +643,12 @@ static EffectDesc effectnames[] = {
 	{ "Overlay:ShieldGlobe", fx_set_shieldglobe_state, 0, -1 },
 	{ "Overlay:Web", fx_set_web_state, 0, -1 },
 	{ "PauseTarget", fx_pause_target, 0, -1 }, //also known as casterhold
-	{ "PickPocketsModifier", fx_pick_pockets_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "PiercingResistanceModifier", fx_piercing_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "PickPocketsModifier", fx_pick_pockets_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
+	{ "PiercingResistanceModifier", fx_piercing_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
 	{ "PlayMovie", fx_play_movie, EFFECT_NO_ACTOR, -1 },
 	{ "PlaySound", fx_playsound, EFFECT_NO_ACTOR, -1 },
 	{ "PlayVisualEffect", fx_play_visual_effect, EFFECT_REINIT_ON_LOAD, -1 },
-	{ "PoisonResistanceModifier", fx_poison_resistance_modifier, 0, -1 },
+	{ "PoisonResistanceModifier", fx_poison_resistance_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "Polymorph", fx_polymorph, 0, -1 },
 	{ "PortraitChange", fx_portrait_change, 0, -1 },
 	{ "PowerWordKill", fx_power_word_kill, 0, -1 },
@@ -660,8 +660,8 @@ static EffectDesc effectnames[] = {
 	{ "Protection:Animation", fx_generic_effect, 0, -1 },
 	{ "Protection:Backstab", fx_no_backstab_modifier, 0, -1 },
 	{ "Protection:Creature", fx_generic_effect, 0, -1 },
-	{ "Protection:Opcode", fx_protection_opcode, 0, -1 },
-	{ "Protection:Opcode2", fx_protection_opcode, 0, -1 },
+	{ "Protection:Opcode", fx_protection_opcode, EFFECT_STAT_ONLY, -1 },
+	{ "Protection:Opcode2", fx_protection_opcode, EFFECT_STAT_ONLY, -1 },
 	{ "Protection:Projectile",fx_protection_from_projectile, 0, -1 },
 	{ "Protection:School",fx_generic_effect, 0, -1 },//overlay?
 	{ "Protection:SchoolDec",fx_protection_school_dec, 0, -1 },//overlay?
@@ -672,8 +672,8 @@ static EffectDesc effectnames[] = {
 	{ "Protection:SpellLevel",fx_protection_spelllevel, 0, -1 },//overlay?
 	{ "Protection:SpellLevelDec",fx_protection_spelllevel_dec, 0, -1 },//overlay?
 	{ "Protection:String", fx_generic_effect, 0, -1 },
-	{ "Protection:Tracking", fx_protection_from_tracking, 0, -1 },
-	{ "Protection:Turn", fx_protection_from_turn, 0, -1 },
+	{ "Protection:Tracking", fx_protection_from_tracking, EFFECT_STAT_ONLY, -1 },
+	{ "Protection:Turn", fx_protection_from_turn, EFFECT_STAT_ONLY, -1 },
 	{ "Protection:Weapons", fx_immune_to_weapon, EFFECT_NO_ACTOR|EFFECT_REINIT_ON_LOAD, -1 },
 	{ "PuppetMarker", fx_puppet_marker, 0, -1 },
 	{ "ProjectImage", fx_puppet_master, 0, -1 },
@@ -691,12 +691,12 @@ static EffectDesc effectnames[] = {
 	{ "ReputationModifier", fx_reputation_modifier, 0, -1 },
 	{ "RestoreSpells", fx_restore_spell_level, 0, -1 },
 	{ "RetreatFrom2", fx_turn_undead, 0, -1 },
-	{ "RightHitModifier", fx_right_to_hit_modifier, 0, -1 },
-	{ "SaveVsBreathModifier", fx_save_vs_breath_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "SaveVsDeathModifier", fx_save_vs_death_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "SaveVsPolyModifier", fx_save_vs_poly_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "SaveVsSpellsModifier", fx_save_vs_spell_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "SaveVsWandsModifier", fx_save_vs_wands_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "RightHitModifier", fx_right_to_hit_modifier, EFFECT_STAT_ONLY, -1 },
+	{ "SaveVsBreathModifier", fx_save_vs_breath_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
+	{ "SaveVsDeathModifier", fx_save_vs_death_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
+	{ "SaveVsPolyModifier", fx_save_vs_poly_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
+	{ "SaveVsSpellsModifier", fx_save_vs_spell_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
+	{ "SaveVsWandsModifier", fx_save_vs_wands_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
 	{ "ScreenShake", fx_screenshake, EFFECT_NO_ACTOR, -1 },
 	{ "ScriptingState", fx_scripting_state, 0, -1 },
 	{ "Sequencer:Activate", fx_activate_spell_sequencer, EFFECT_PRESET_TARGET, -1 },
@@ -708,9 +708,9 @@ static EffectDesc effectnames[] = {
 	{ "SetMeleeEffect", fx_generic_effect, 0, -1 },
 	{ "SetRangedEffect", fx_generic_effect, 0, -1 },
 	{ "SetTrap", fx_set_area_effect, 0, -1 },
-	{ "SetTrapsModifier", fx_set_traps_modifier, 0, -1 },
+	{ "SetTrapsModifier", fx_set_traps_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "SexModifier", fx_sex_modifier, 0, -1 },
-	{ "SlashingResistanceModifier", fx_slashing_resistance_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "SlashingResistanceModifier", fx_slashing_resistance_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
 	{ "Sparkle", fx_sparkle, 0, -1 },
 	{ "SpellDurationModifier", fx_spell_duration_modifier, 0, -1 },
 	{ "Spell:Add", fx_add_innate, 0, -1 },
@@ -739,33 +739,33 @@ static EffectDesc effectnames[] = {
 	{ "State:HoldNoIcon2", fx_hold_creature_no_icon, 0, -1 }, //0xfb (iwd/iwd2)
 	{ "State:HoldNoIcon3", fx_hold_creature_no_icon, 0, -1 }, //0x1a8 (iwd2)
 	{ "State:Imprisonment", fx_imprisonment, 0, -1 },
-	{ "State:Infravision", fx_set_infravision_state, 0, -1 },
+	{ "State:Infravision", fx_set_infravision_state, EFFECT_STAT_ONLY, -1 },
 	{ "State:Invisible", fx_set_invisible_state, 0, -1 }, //both invis or improved invis
-	{ "State:Nondetection", fx_set_nondetection_state, 0, -1 },
+	{ "State:Nondetection", fx_set_nondetection_state, EFFECT_STAT_ONLY, -1 },
 	{ "State:Panic", fx_set_panic_state, 0, -1 },
 	{ "State:Petrification", fx_set_petrified_state, 0, -1 },
 	{ "State:Poisoned", fx_set_poisoned_state, 0, -1 },
 	{ "State:Regenerating", fx_set_regenerating_state, 0, -1 },
-	{ "State:Silenced", fx_set_silenced_state, 0, -1 },
+	{ "State:Silenced", fx_set_silenced_state, EFFECT_STAT_ONLY, -1 },
 	{ "State:Helpless", fx_set_unconscious_state, 0, -1 },
 	{ "State:Sleep", fx_set_unconscious_state, 0, -1 },
 	{ "State:Slowed", fx_set_slowed_state, 0, -1 },
 	{ "State:Stun", fx_set_stun_state, 0, -1 },
-	{ "StealthModifier", fx_stealth_modifier, 0, -1 },
+	{ "StealthModifier", fx_stealth_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "StoneSkinModifier", fx_stoneskin_modifier, 0, -1 },
 	{ "StoneSkin2Modifier", fx_golem_stoneskin_modifier, 0, -1 },
 	{ "StrengthModifier", fx_strength_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "StrengthBonusModifier", fx_strength_bonus_modifier, 0, -1 },
+	{ "StrengthBonusModifier", fx_strength_bonus_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "SummonCreature", fx_summon_creature, EFFECT_NO_ACTOR, -1 },
 	{ "RandomTeleport", fx_teleport_field, 0, -1 },
 	{ "TeleportToTarget", fx_teleport_to_target, 0, -1 },
-	{ "TimelessState", fx_timeless_modifier, 0, -1 },
+	{ "TimelessState", fx_timeless_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "Timestop", fx_timestop, 0, -1 },
 	{ "TitleModifier", fx_title_modifier, 0, -1 },
 	{ "ToHitModifier", fx_to_hit_modifier, EFFECT_SPECIAL_UNDO, -1 },
-	{ "ToHitBonusModifier", fx_to_hit_bonus_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "ToHitBonusModifier", fx_to_hit_bonus_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
 	{ "ToHitVsCreature", fx_generic_effect, 0, -1 },
-	{ "TrackingModifier", fx_tracking_modifier, EFFECT_SPECIAL_UNDO, -1 },
+	{ "TrackingModifier", fx_tracking_modifier, EFFECT_SPECIAL_UNDO|EFFECT_STAT_ONLY, -1 },
 	{ "TransparencyModifier", fx_transparency_modifier, 0, -1 },
 	{ "TurnUndead", fx_turn_undead, 0, -1 },
 	{ "UncannyDodge", fx_uncanny_dodge, 0, -1 },
@@ -774,9 +774,9 @@ static EffectDesc effectnames[] = {
 	{ "UnsummonCreature", fx_unsummon_creature, 0, -1 },
 	{ "Variable:StoreLocalVariable", fx_local_variable, 0, -1 },
 	{ "VisualAnimationEffect", fx_visual_animation_effect, 0, -1 }, //unknown
-	{ "VisualRangeModifier", fx_visual_range_modifier, 0, -1 },
+	{ "VisualRangeModifier", fx_visual_range_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "VisualSpellHit", fx_visual_spell_hit, 0, -1 },
-	{ "WildSurgeModifier", fx_wild_surge_modifier, 0, -1 },
+	{ "WildSurgeModifier", fx_wild_surge_modifier, EFFECT_STAT_ONLY, -1 },
 	{ "WingBuffet", fx_wing_buffet, 0, -1 },
 	{ "WisdomModifier", fx_wisdom_modifier, EFFECT_SPECIAL_UNDO, -1 },
 	{ "WizardSpellSlotsModifier", fx_bonus_wizard_spells, 0, -1 },
@@ -6187,6 +6187,40 @@ static PyObject* GemRB_DumpActor(PyObject * /*self*/, PyObject * args)
 	Py_RETURN_NONE;
 }
 
+PyDoc_STRVAR( GemRB_DumpScriptProfile__doc,
+"===== DumpScriptProfile =====\n\
+\n\
+**Prototype:** GemRB.DumpScriptProfile ([Reset, FileName])\n\
+\n\
+**Description:** Logs the script blocks and triggers that took the most \n\
+time so far. Profiling has to be enabled first with the 32 bit of the \n\
+ScriptDebugMode option, or the Debug(32) action.\n\
+\n\
+**Parameters:**\n\
+  * Reset    - if nonzero, the counting starts over\n\
+  * FileName - if given, all the counters are also written there as CSV\n\
+\n\
+**Return value:** N/A\n\
+\n\
+**Example:**\n\
+  GemRB.DumpScriptProfile (1, 'profile.csv')"
+);
+static PyObject* GemRB_DumpScriptProfile(PyObject * /*self*/, PyObject * args)
+{
+	int reset = 0;
+	const char *filename = NULL;
+
+	if (!PyArg_ParseTuple( args, "|is", &reset, &filename )) {
+		return AttributeError( GemRB_DumpScriptProfile__doc );
+	}
+
+	if (filename && !WriteScriptProfile(filename)) {
+		return RuntimeError( "Cannot write the script profile!\n" );
+	}
+	DumpScriptProfile(reset != 0);
+	Py_RETURN_NONE;
+}
+
 PyDoc_STRVAR( GemRB_SaveCharacter__doc,
 "===== SaveCharacter =====\n\
 \n\
@@ -15364,6 +15398,7 @@ static PyMethodDef GemRBMethods[] = {
 	METHOD(DrawWindows, METH_NOARGS),
 	METHOD(DropDraggedItem, METH_VARARGS),
 	METHOD(DumpActor, METH_VARARGS),
+	METHOD(DumpScriptProfile, METH_VARARGS),
 	METHOD(EnableCheatKeys, METH_VARARGS),
 	METHOD(EndCutSceneMode, METH_NOARGS),
 	METHOD(EnterGame, METH_NOARGS),
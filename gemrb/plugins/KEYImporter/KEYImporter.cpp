@@ -33,6 +33,7 @@ using namespace GemRB;
 KEYImporter::KEYImporter(void)
 {
 	description = NULL;
+	archiveUse = 0;
 }
 
 KEYImporter::~KEYImporter(void)
@@ -200,7 +201,8 @@ bool KEYImporter::Open(const char *resfile, const char *desc)
 
 bool KEYImporter::HasResource(const char* resname, SClass_ID type)
 {
-	return resources.has(resname, type);
+	//the same synonym hack as in GetResource
+	return resources.has(resname, type&0xFFFF);
 }
 
 bool KEYImporter::HasResource(const char* resname, const ResourceDesc &type)
@@ -208,6 +210,31 @@ bool KEYImporter::HasResource(const char* resname, const ResourceDesc &type)
 	return HasResource(resname, type.GetKeyType());
 }
 
+// the archives are mapped, so keeping a few of them open makes the
+// lookups into the same bif free of any file access
+IndexedArchive *KEYImporter::GetArchive(unsigned int bifnum)
+{
+	KEYCache *slot = archives;
+	for (int i = 0; i < KEY_OPEN_ARCHIVES; i++) {
+		if (archives[i].bifnum == bifnum) {
+			archives[i].lastUse = ++archiveUse;
+			return archives[i].plugin.get();
+		}
+		if (archives[i].lastUse < slot->lastUse) {
+			slot = archives + i;
+		}
+	}
+
+	PluginHolder<IndexedArchive> ai(IE_BIF_CLASS_ID);
+	if (ai->OpenArchive( biffiles[bifnum].path ) == GEM_ERROR) {
+		return NULL;
+	}
+	slot->bifnum = bifnum;
+	slot->lastUse = ++archiveUse;
+	slot->plugin = ai;
+	return ai.get();
+}
+
 DataStream* KEYImporter::GetStream(const char *resname, ieWord type)
 {
 	if (type == 0)
@@ -225,13 +252,17 @@ DataStream* KEYImporter::GetStream(const char *resname, ieWord type)
 		return NULL;
 	}
 
-	PluginHolder<IndexedArchive> ai(IE_BIF_CLASS_ID);
-	if (ai->OpenArchive( biffiles[bifnum].path ) == GEM_ERROR) {
-		print("Cannot open archive %s", biffiles[bifnum].path);
-		return NULL;
+	DataStream* ret;
+	{
+		// the slot may get reused for another bif once unlocked
+		MutexLock l(archiveMutex);
+		IndexedArchive *ai = GetArchive(bifnum);
+		if (!ai) {
+			print("Cannot open archive %s", biffiles[bifnum].path);
+			return NULL;
+		}
+		ret = ai->GetStream( *ResLocator, type );
 	}
-
-	DataStream* ret = ai->GetStream( *ResLocator, type );
 	if (ret) {
 		strnlwrcpy( ret->filename, resname, 8 );
 		strcat( ret->filename, "." );
@@ -27,6 +27,7 @@
 #include "PluginMgr.h"
 
 #include "StringMap.h"
+#include "System/Thread.h"
 
 #include <vector>
 
@@ -44,10 +45,14 @@ struct BIFEntry {
 	bool found;
 };
 
+//number of archives kept open between lookups
+#define KEY_OPEN_ARCHIVES 8
+
 struct KEYCache {
-	KEYCache() { bifnum = 0xffffffff; }
+	KEYCache() { bifnum = 0xffffffff; lastUse = 0; }
 
 	unsigned int bifnum;
+	unsigned int lastUse;
 	PluginHolder<IndexedArchive> plugin;
 };
 
@@ -131,7 +136,14 @@ class KEYImporter : public ResourceSource {
 private:
 	std::vector< BIFEntry> biffiles;
 	KEYMap resources;
-
+	KEYCache archives[KEY_OPEN_ARCHIVES];
+	unsigned int archiveUse;
+	/** guards the open archives, the ambient thread loads sounds too */
+	Mutex archiveMutex;
+
+	/** Returns the opened archive, reusing recently opened ones;
+	 *  the caller must hold archiveMutex while using it */
+	IndexedArchive *GetArchive(unsigned int bifnum);
 	/** Gets the stream assoicated to a RESKey */
 	DataStream *GetStream(const char *resname, ieWord type);
 public:
@@ -67,6 +67,53 @@ static void showALCError(const char* msg, log_level level, ALCdevice *device) {
 	}
 }
 
+namespace GemRB {
+
+/** Decodes a whole sound, on the decoder thread or inline */
+class DecodeJob : public Task {
+public:
+	DecodeJob(const Holder<SoundMgr> &reader, Mutex *lock, ConditionVariable *finished)
+		: acm(reader), memory(NULL), size(0), samples(0), channels(0), samplerate(0),
+		done(false), cancelled(false), lock(lock), finished(finished) { }
+	~DecodeJob() { free(memory); }
+	void Run();
+
+	Holder<SoundMgr> acm;
+	short* memory;
+	int size;
+	int samples;
+	int channels;
+	int samplerate;
+	// guarded by lock
+	bool done;
+	bool cancelled;
+private:
+	Mutex *lock;
+	ConditionVariable *finished;
+};
+
+void DecodeJob::Run()
+{
+	lock->Lock();
+	bool skip = cancelled;
+	lock->Unlock();
+
+	if (!skip) {
+		samples = acm->get_length();
+		channels = acm->get_channels();
+		samplerate = acm->get_samplerate();
+		//multiply always by 2 because it is in 16 bits
+		memory = (short*) malloc(samples * 2);
+		size = acm->read_samples(memory, samples) * 2;
+	}
+
+	MutexLock l(*lock);
+	done = true;
+	finished->Broadcast();
+}
+
+}
+
 void OpenALSoundHandle::SetPos(int XPos, int YPos) {
 	if (!parent) return;
 
@@ -123,6 +170,9 @@ void AudioStream::ClearProcessedBuffers()
 			alDeleteBuffers(processed, b);
 			checkALError("Failed to delete buffers", WARNING);
 #endif
+		} else {
+			// buffers are unqueued in the order they were queued
+			UnpinCached(processed);
 		}
 
 		delete[] b;
@@ -130,6 +180,24 @@ void AudioStream::ClearProcessedBuffers()
 
 }
 
+// takes over the pin loadSound made
+void AudioStream::QueueCached(const char* ResRef)
+{
+	cached.push_back(ResRef);
+}
+
+void AudioStream::UnpinCached(size_t count)
+{
+	if (cached.empty()) {
+		return;
+	}
+	MutexLock l(*cacheLock);
+	while (count-- && !cached.empty()) {
+		cache->Unpin(cached.front().c_str());
+		cached.pop_front();
+	}
+}
+
 void AudioStream::ClearIfStopped()
 {
 	if (free || locked) return;
@@ -147,6 +215,7 @@ void AudioStream::ClearIfStopped()
 		ClearProcessedBuffers();
 		alDeleteSources( 1, &Source );
 		checkALError("Failed to delete source", WARNING);
+		UnpinCached(cached.size());
 		Source = 0;
 		Buffer = 0;
 		free = true;
@@ -168,16 +237,24 @@ void AudioStream::ForceClear()
 }
 
 OpenALAudioDriver::OpenALAudioDriver(void)
+	: buffercache(BUFFER_CACHE_SIZE)
 {
 	alutContext = NULL;
 	MusicPlaying = false;
 	music_memory = (short*) malloc(ACM_BUFFERSIZE);
 	MusicSource = num_streams = 0;
 	memset(MusicBuffer, 0, MUSICBUFFERS*sizeof(ALuint));
+	speech.cache = &buffercache;
+	speech.cacheLock = &cacheMutex;
+	for (int i = 0; i < MAX_STREAMS; i++) {
+		streams[i].cache = &buffercache;
+		streams[i].cacheLock = &cacheMutex;
+	}
 	musicMutex = SDL_CreateMutex();
 	ambim = NULL;
 	musicThread = NULL;
 	stayAlive = false;
+	decoder = NULL;
 	hasReverbProperties = false;
 #ifdef HAVE_OPENAL_EFX_H
 	hasEFX = false;
@@ -253,6 +330,9 @@ bool OpenALAudioDriver::Init(void)
 		Log(MESSAGE, "OpenAL", "EFX not available.");
 	}
 
+	// a single thread, since it only has to keep ahead of the game
+	decoder = new WorkerPool(1);
+
 	ambim = new AmbientMgrAL;
 	speech.free = true;
 	speech.ambient = false;
@@ -352,11 +432,26 @@ OpenALAudioDriver::~OpenALAudioDriver(void)
 	SDL_WaitThread(musicThread, NULL);
 #endif
 
+	// nobody will play the prefetched sounds anymore
+	std::map<std::string, DecodeJob*>::iterator it;
+	decodeMutex.Lock();
+	for (it = decoding.begin(); it != decoding.end(); ++it) {
+		it->second->cancelled = true;
+	}
+	decodeMutex.Unlock();
+	delete decoder;
+	for (it = decoding.begin(); it != decoding.end(); ++it) {
+		delete it->second;
+	}
+	decoding.clear();
+
 	for(int i =0; i<num_streams; i++) {
 		streams[i].ForceClear();
 	}
 	speech.ForceClear();
 	ResetMusics();
+	Log(MESSAGE, "OpenAL", "Sound buffer cache: %lu hits, %lu misses, %lu evictions.",
+		buffercache.GetHits(), buffercache.GetMisses(), buffercache.GetEvictions());
 	clearBufferCache(true);
 
 #ifdef HAVE_OPENAL_EFX_H
@@ -385,48 +480,111 @@ OpenALAudioDriver::~OpenALAudioDriver(void)
 	delete ambim;
 }
 
-ALuint OpenALAudioDriver::loadSound(const char *ResRef, unsigned int &time_length)
+void OpenALAudioDriver::Prefetch(const char* ResRef)
 {
-	ALuint Buffer = 0;
-
-	CacheEntry *e;
 	void* p;
 
-	if (!ResRef[0]) {
+	if (!decoder || !ResRef || !ResRef[0]) {
+		return;
+	}
+	UploadDecoded();
+	cacheMutex.Lock();
+	bool cached = buffercache.Lookup(ResRef, p);
+	cacheMutex.Unlock();
+	if (cached) {
+		return;
+	}
+
+	decodeMutex.Lock();
+	bool queued = decoding.size() >= MAX_PREFETCH || decoding.count(ResRef);
+	decodeMutex.Unlock();
+	if (queued) {
+		return;
+	}
+	// archive streams aren't safe to read from the decoder thread
+	Holder<SoundMgr> acm(static_cast<SoundMgr*>(gamedata->GetDetachedResource(ResRef, &SoundMgr::ID, true)));
+	if (!acm) {
+		return;
+	}
+
+	MutexLock l(decodeMutex);
+	// the ambient thread may have queued it meanwhile
+	if (decoding.size() >= MAX_PREFETCH || decoding.count(ResRef)) {
+		return;
+	}
+	DecodeJob *job = new DecodeJob(acm, &decodeMutex, &decoded);
+	decoding[ResRef] = job;
+	decoder->Submit(job);
+}
+
+// removes the prefetch of the sound, waiting for it to finish decoding
+DecodeJob* OpenALAudioDriver::TakeDecodeJob(const char* ResRef)
+{
+	MutexLock l(decodeMutex);
+	std::map<std::string, DecodeJob*>::iterator it = decoding.find(ResRef);
+	if (it == decoding.end()) {
+		return NULL;
+	}
+	DecodeJob *job = it->second;
+	decoding.erase(it);
+	while (!job->done) {
+		decoded.Wait(decodeMutex);
+	}
+	return job;
+}
+
+// moves the finished prefetches into the buffer cache
+void OpenALAudioDriver::UploadDecoded()
+{
+	std::map<std::string, DecodeJob*> finished;
+
+	decodeMutex.Lock();
+	std::map<std::string, DecodeJob*>::iterator it = decoding.begin();
+	while (it != decoding.end()) {
+		if (it->second->done) {
+			finished.insert(*it);
+			decoding.erase(it++);
+		} else {
+			++it;
+		}
+	}
+	decodeMutex.Unlock();
+
+	unsigned int time_length;
+	for (it = finished.begin(); it != finished.end(); ++it) {
+		StoreBuffer(it->first.c_str(), it->second, time_length, false);
+		delete it->second;
+	}
+}
+
+// pin keeps the buffer from being evicted until it is released
+ALuint OpenALAudioDriver::StoreBuffer(const char* ResRef, DecodeJob* job, unsigned int &time_length, bool pin)
+{
+	ALuint Buffer = 0;
+
+	if (!job->memory || !job->channels || !job->samplerate) {
 		return 0;
 	}
-	if(buffercache.Lookup(ResRef, p))
-	{
-		e = (CacheEntry*) p;
+
+	MutexLock l(cacheMutex);
+	// both threads may have decoded it (Touch doesn't count as a lookup)
+	void* p;
+	if (buffercache.Touch(ResRef) && buffercache.Lookup(ResRef, p)) {
+		CacheEntry *e = (CacheEntry*) p;
 		time_length = e->Length;
+		if (pin) {
+			buffercache.Pin(ResRef);
+		}
 		return e->Buffer;
 	}
 
-	//no cache entry...
 	alGenBuffers(1, &Buffer);
 	if (checkALError("Unable to create sound buffer", ERROR)) {
 		return 0;
 	}
 
-	ResourceHolder<SoundMgr> acm(ResRef);
-	if (!acm) {
-		alDeleteBuffers( 1, &Buffer );
-		checkALError("Unable to delete buffer!", ERROR);
-		return 0;
-	}
-	int cnt = acm->get_length();
-	int riff_chans = acm->get_channels();
-	int samplerate = acm->get_samplerate();
-	//multiply always by 2 because it is in 16 bits
-	int rawsize = cnt * 2;
-	short* memory = (short*) malloc(rawsize);
-	//multiply always with 2 because it is in 16 bits
-	int cnt1 = acm->read_samples( memory, cnt ) * 2;
-	//Sound Length in milliseconds
-	time_length = ((cnt / riff_chans) * 1000) / samplerate;
 	//it is always reading the stuff into 16 bits
-	alBufferData( Buffer, GetFormatEnum( riff_chans, 16 ), memory, cnt1, samplerate );
-	free(memory);
+	alBufferData( Buffer, GetFormatEnum( job->channels, 16 ), job->memory, job->size, job->samplerate );
 
 	if (checkALError("Unable to fill buffer", ERROR)) {
 		alDeleteBuffers( 1, &Buffer );
@@ -434,19 +592,69 @@ ALuint OpenALAudioDriver::loadSound(const char *ResRef, unsigned int &time_lengt
 		return 0;
 	}
 
-	e = new CacheEntry;
+	CacheEntry *e = new CacheEntry;
 	e->Buffer = Buffer;
-	e->Length = ((cnt / riff_chans) * 1000) / samplerate;
+	//Sound Length in milliseconds
+	e->Length = ((job->samples / job->channels) * 1000) / job->samplerate;
+	time_length = e->Length;
 
-	buffercache.SetAt(ResRef, (void*)e);
+	buffercache.SetAt(ResRef, (void*)e, job->size);
 	//print("LoadSound: added %s to cache: %d. Cache size now %d", ResRef, e->Buffer, buffercache.GetCount());
 
-	if (buffercache.GetCount() > BUFFER_CACHE_SIZE) {
-		evictBuffer();
+	// don't evict the new buffer itself, if it's bigger than the rest
+	buffercache.Pin(ResRef);
+	evictBuffers();
+	if (!pin) {
+		buffercache.Unpin(ResRef);
+	}
+	return Buffer;
+}
+
+// the buffer stays pinned, until a stream takes it over with QueueCached
+// or it is given back with releaseSound
+ALuint OpenALAudioDriver::loadSound(const char *ResRef, unsigned int &time_length)
+{
+	CacheEntry *e;
+	void* p;
+
+	if (!ResRef[0]) {
+		return 0;
+	}
+	UploadDecoded();
+	cacheMutex.Lock();
+	if(buffercache.Lookup(ResRef, p))
+	{
+		buffercache.Touch(ResRef);
+		buffercache.Pin(ResRef);
+		e = (CacheEntry*) p;
+		time_length = e->Length;
+		cacheMutex.Unlock();
+		return e->Buffer;
 	}
+	cacheMutex.Unlock();
+
+	//no cache entry, but maybe it is still being prefetched
+	DecodeJob *job = TakeDecodeJob(ResRef);
+	if (!job) {
+		ResourceHolder<SoundMgr> acm(ResRef);
+		if (!acm) {
+			return 0;
+		}
+		job = new DecodeJob(acm, &decodeMutex, &decoded);
+		job->Run();
+	}
+	ALuint Buffer = StoreBuffer(ResRef, job, time_length, true);
+	delete job;
 	return Buffer;
 }
 
+// drops the pin of a loaded sound that didn't get queued after all
+void OpenALAudioDriver::releaseSound(const char* ResRef)
+{
+	MutexLock l(cacheMutex);
+	buffercache.Unpin(ResRef);
+}
+
 Holder<SoundHandle> OpenALAudioDriver::Play(const char* ResRef, int XPos, int YPos, unsigned int flags, unsigned int *length)
 {
 	ALuint Buffer;
@@ -515,6 +723,7 @@ Holder<SoundHandle> OpenALAudioDriver::Play(const char* ResRef, int XPos, int YP
 		if (stream == NULL) {
 			// Failed to assign new sound.
 			// The buffercache will handle deleting Buffer.
+			releaseSound(ResRef);
 			return Holder<SoundHandle>();
 		}
 	}
@@ -525,6 +734,7 @@ Holder<SoundHandle> OpenALAudioDriver::Play(const char* ResRef, int XPos, int YP
 	if(!Source || !alIsSource(Source)) {
 		alGenSources( 1, &Source );
 		if (checkALError("Error creating source", ERROR)) {
+			releaseSound(ResRef);
 			return Holder<SoundHandle>();
 		}
 	}
@@ -555,8 +765,10 @@ Holder<SoundHandle> OpenALAudioDriver::Play(const char* ResRef, int XPos, int YP
 	stream->free = false;
 
 	if (QueueALBuffer(Source, Buffer) != GEM_OK) {
+		releaseSound(ResRef);
 		return Holder<SoundHandle>();
 	}
+	stream->QueueCached(ResRef);
 
 	stream->handle = new OpenALSoundHandle(stream);
 	return stream->handle.get();
@@ -815,8 +1027,10 @@ int OpenALAudioDriver::QueueAmbient(int stream, const char* sound)
 	assert(!streams[stream].delete_buffers);
 
 	if (QueueALBuffer(source, Buffer) != GEM_OK) {
+		releaseSound(sound);
 		return GEM_ERROR;
 	}
+	streams[stream].QueueCached(sound);
 
 	return time_length;
 }
@@ -841,45 +1055,31 @@ void OpenALAudioDriver::SetAmbientStreamPitch(int stream, int pitch)
 	checkALError("Unable to set ambient pitch", WARNING);
 }
 
-bool OpenALAudioDriver::evictBuffer()
+void OpenALAudioDriver::evictBuffers()
 {
-	// Note: this function assumes the caller holds bufferMutex
-
-	// Room for optimization: this is O(n^2) in the number of buffers
-	// at the tail that are used. It can be O(n) if LRUCache supports it.
-
-	unsigned int n = 0;
+	// Note: this function assumes the caller holds cacheMutex
+	// buffers attached to a source are pinned, so all evicted ones are unused
 	void* p;
-	const char* k;
-	bool res;
-
-	while ((res = buffercache.getLRU(n, k, p)) == true) {
+	while (buffercache.Evict(p)) {
 		CacheEntry* e = (CacheEntry*)p;
 		alDeleteBuffers(1, &e->Buffer);
-		if (alGetError() == AL_NO_ERROR) {
-			// Buffer was unused. An error would have indicated
-			// the buffer was still attached to a source.
-
-			delete e;
-			buffercache.Remove(k);
-
-			//print("Removed buffer %s from ACMImp cache", k);
-			break;
-		}
-		++n;
+		checkALError("Unable to delete evicted buffer", WARNING);
+		delete e;
 	}
-
-	return res;
 }
 
 void OpenALAudioDriver::clearBufferCache(bool force)
 {
-	// Room for optimization: any method of iterating over the buffers
-	// would suffice. It doesn't have to be in LRU-order.
+	MutexLock l(cacheMutex);
 	void* p;
 	const char* k;
 	int n = 0;
 	while (buffercache.getLRU(n, k, p)) {
+		// the pinned buffers come last and are still queued on a stream,
+		// which unpins them by name later
+		if (!force && buffercache.IsPinned(k)) {
+			break;
+		}
 		CacheEntry* e = (CacheEntry*)p;
 		alDeleteBuffers(1, &e->Buffer);
 		if (force || alGetError() == AL_NO_ERROR) {
@@ -888,6 +1088,13 @@ void OpenALAudioDriver::clearBufferCache(bool force)
 		} else
 			++n;
 	}
+	if (force) {
+		// so a stale name can't release a later entry's pin
+		speech.cached.clear();
+		for (int i = 0; i < MAX_STREAMS; i++) {
+			streams[i].cached.clear();
+		}
+	}
 }
 
 ALenum OpenALAudioDriver::GetFormatEnum(int channels, int bits)
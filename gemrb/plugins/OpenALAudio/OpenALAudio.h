@@ -33,10 +33,15 @@
 #include "MusicMgr.h"
 #include "SoundMgr.h"
 #include "System/FileStream.h"
+#include "System/Thread.h"
 #include "MapReverb.h"
 
 #include <SDL.h>
 
+#include <deque>
+#include <map>
+#include <string>
+
 #ifndef WIN32
 #ifdef __APPLE_CC__
 #include <OpenAL/al.h>
@@ -65,7 +70,10 @@
 #endif
 
 #define RETRY 5
-#define BUFFER_CACHE_SIZE 100
+// bytes of decoded sound kept in buffers
+#define BUFFER_CACHE_SIZE (16 * 1024 * 1024)
+// prefetching more than this would only push itself out of the cache again
+#define MAX_PREFETCH 50
 #define MAX_STREAMS 30
 #define MUSICBUFFERS 10
 #define REFERENCE_DISTANCE 50
@@ -90,7 +98,7 @@ public:
 };
 
 struct AudioStream {
-	AudioStream() : Buffer(0), Source(0), Duration(0), free(true), ambient(false), locked(false), delete_buffers(false) { }
+	AudioStream() : Buffer(0), Source(0), Duration(0), free(true), ambient(false), locked(false), delete_buffers(false), cache(NULL), cacheLock(NULL) { }
 
 	ALuint Buffer;
 	ALuint Source;
@@ -99,10 +107,16 @@ struct AudioStream {
 	bool ambient;
 	bool locked;
 	bool delete_buffers;
+	// cached buffers queued on the source, pinned until they are processed
+	LRUCache* cache;
+	Mutex* cacheLock;
+	std::deque<std::string> cached;
 
+	void QueueCached(const char* ResRef);
 	void ClearIfStopped();
 	void ClearProcessedBuffers();
 	void ForceClear();
+	void UnpinCached(size_t count);
 
 	Holder<OpenALSoundHandle> handle;
 };
@@ -112,6 +126,8 @@ struct CacheEntry {
 	unsigned int Length;
 };
 
+class DecodeJob;
+
 class OpenALAudioDriver : public Audio {
 public:
 	OpenALAudioDriver(void);
@@ -140,8 +156,12 @@ public:
 				int channels, short* memory,
 				int size, int samplerate);
 	void UpdateMapAmbient(MapReverb&);
+	void Prefetch(const char* ResRef);
 private:
 	int QueueALBuffer(ALuint source, ALuint buffer);
+	DecodeJob* TakeDecodeJob(const char* ResRef);
+	void UploadDecoded();
+	ALuint StoreBuffer(const char* ResRef, DecodeJob* job, unsigned int &time_length, bool pin);
 
 private:
 	ALCcontext *alutContext;
@@ -150,16 +170,25 @@ private:
 	SDL_mutex* musicMutex;
 	ALuint MusicBuffer[MUSICBUFFERS];
 	Holder<SoundMgr> MusicReader;
+	// the ambient thread loads sounds too
 	LRUCache buffercache;
+	Mutex cacheMutex;
 	AudioStream speech;
 	AudioStream streams[MAX_STREAMS];
 	ALuint loadSound(const char* ResRef, unsigned int &time_length);
+	void releaseSound(const char* ResRef);
 	int num_streams;
 	int CountAvailableSources(int limit);
-	bool evictBuffer();
+	void evictBuffers();
 	void clearBufferCache(bool force);
 	ALenum GetFormatEnum(int channels, int bits);
 	static int MusicManager(void* args);
+	WorkerPool* decoder;
+	// prefetched sounds by resref; guarded by decodeMutex, since the
+	// ambient thread loads sounds too
+	std::map<std::string, DecodeJob*> decoding;
+	Mutex decodeMutex;
+	ConditionVariable decoded;
 	bool stayAlive;
 	short* music_memory;
 	SDL_Thread* musicThread;
@@ -21,9 +21,16 @@
 #include "win32def.h"
 
 #include "Compressor.h"
-#include "FileCache.h"
 #include "Interface.h"
 #include "PluginMgr.h"
+#include "ResourceDesc.h"
+#include "System/FileStream.h"
+#include "System/MemoryStream.h"
+#include "System/Thread.h"
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 using namespace GemRB;
 
@@ -35,6 +42,144 @@ SAVImporter::~SAVImporter()
 {
 }
 
+// growable sink for compressed entries, only supports appending
+class BufferStream : public DataStream {
+public:
+	std::vector<char> buffer;
+
+	int Read(void* /*dest*/, unsigned int /*length*/)
+	{
+		return GEM_ERROR;
+	}
+	int Write(const void* src, unsigned int length)
+	{
+		buffer.insert(buffer.end(), (const char *) src, (const char *) src + length);
+		Pos += length;
+		size = Pos;
+		return length;
+	}
+	int Seek(int /*pos*/, int /*startpos*/)
+	{
+		return GEM_ERROR;
+	}
+};
+
+// inflates one archive entry into the cache on a worker thread
+class InflateTask : public Task {
+public:
+	char path[_MAX_PATH];
+	char *data;
+	ieDword complen;
+	const Compressor *comp;
+	int status;
+
+	InflateTask(const char *fname, char *data, ieDword complen, const Compressor *comp)
+		: data(data), complen(complen), comp(comp), status(GEM_ERROR)
+	{
+		char file[_MAX_PATH];
+		ExtractFileFromPath(file, fname);
+		PathJoin(path, core->CachePath, file, NULL);
+	}
+	void Run()
+	{
+		//the memory stream takes over the data
+		MemoryStream in(path, data, complen);
+		FileStream out;
+		if (!out.Create(path)) {
+			return;
+		}
+		status = comp->Decompress(&out, &in, complen);
+	}
+};
+
+// deflates one cached file into memory on a worker thread
+class DeflateTask : public Task {
+public:
+	std::string path;
+	char name[16];
+	ieDword declen;
+	BufferStream out;
+	const Compressor *comp;
+	int status;
+
+	DeflateTask(const std::string &path, const Compressor *comp)
+		: path(path), declen(0), comp(comp), status(GEM_ERROR)
+	{
+		name[0] = 0;
+	}
+	void Run()
+	{
+		FileStream in;
+		if (!in.Open(path.c_str())) {
+			return;
+		}
+		memcpy(name, in.filename, sizeof(name));
+		declen = in.Size();
+		status = comp->Compress(&out, &in);
+	}
+};
+
+static void LogThroughput(const char *what, size_t entries, unsigned long packed,
+	unsigned long unpacked, unsigned long start, unsigned int threads)
+{
+	unsigned long usecs = GetMicroTicks() - start;
+	if (!usecs) {
+		usecs = 1;
+	}
+	Log(MESSAGE, "SAVImporter", "%s %d entries (%lu bytes packed, %lu unpacked) in %lu ms on %d thread(s): %.0f KB/s.",
+		what, (int) entries, packed, unpacked, usecs / 1000, threads ? threads : 1,
+		(double) unpacked * 1000000 / usecs / 1024);
+}
+
+// reads the header and the still compressed data of the next entry
+static bool ReadEntry(DataStream *str, std::string &name, ieDword &declen, ieDword &complen, char *&data)
+{
+	ieDword fnlen;
+	str->ReadDword( &fnlen );
+	if (!fnlen || fnlen > str->Remains()) {
+		Log(ERROR, "SAVImporter", "Corrupt Save Detected");
+		return false;
+	}
+	char* fname = ( char* ) malloc( fnlen );
+	str->Read( fname, fnlen );
+	fname[fnlen - 1] = 0;
+	strlwr(fname);
+	name = fname;
+	free( fname );
+	str->ReadDword( &declen );
+	str->ReadDword( &complen );
+	data = (char *) malloc(complen);
+	if (str->Read(data, complen) != (int) complen) {
+		Log(ERROR, "SAVImporter", "Corrupt Save Detected");
+		free(data);
+		return false;
+	}
+	return true;
+}
+
+// waits for the inflating entries and reports the failed ones
+static int FinishInflating(WorkerPool &pool, std::vector<InflateTask *> &tasks)
+{
+	int ret = GEM_OK;
+	pool.Wait();
+	for (size_t i = 0; i < tasks.size(); i++) {
+		if (tasks[i]->status != GEM_OK) {
+			Log(ERROR, "SAVImporter", "Failed to decompress %s.", tasks[i]->path);
+			ret = GEM_ERROR;
+		}
+		delete tasks[i];
+	}
+	return ret;
+}
+
+// a copy of packed data for an InflateTask to take over
+static char *CopyData(const char *packed, ieDword complen)
+{
+	char *data = (char *) malloc(complen);
+	memcpy(data, packed, complen);
+	return data;
+}
+
 int SAVImporter::DecompressSaveGame(DataStream *compressed)
 {
 	char Signature[8];
@@ -46,34 +191,50 @@ int SAVImporter::DecompressSaveGame(DataStream *compressed)
 	int Current;
 	int percent, last_percent = 20;
 	if (!All) return GEM_ERROR;
+	if (!core->IsAvailable(PLUGIN_COMPRESSION_ZLIB)) {
+		Log(ERROR, "SAVImporter", "No Compression Manager Available. Cannot Load Compressed File.");
+		return GEM_ERROR;
+	}
+
+	//every entry is an independent zlib stream, so they are read in here
+	//and inflated on the worker threads
+	PluginHolder<Compressor> comp(PLUGIN_COMPRESSION_ZLIB);
+	std::vector<InflateTask *> tasks;
+	unsigned long start = GetMicroTicks();
+	unsigned long packed = 0, unpacked = 0;
+	int ret = GEM_OK;
+	WorkerPool pool;
 	do {
-		ieDword fnlen, complen, declen;
-		compressed->ReadDword( &fnlen );
-		if (!fnlen) {
-			Log(ERROR, "SAVImporter", "Corrupt Save Detected");
-			return GEM_ERROR;
+		std::string fname;
+		ieDword complen, declen;
+		char *data;
+		if (!ReadEntry(compressed, fname, declen, complen, data)) {
+			ret = GEM_ERROR;
+			break;
 		}
-		char* fname = ( char* ) malloc( fnlen );
-		compressed->Read( fname, fnlen );
-		strlwr(fname);
-		compressed->ReadDword( &declen );
-		compressed->ReadDword( &complen );
-		print("Decompressing %s", fname);
-		DataStream* cached = CacheCompressedStream(compressed, fname, complen, true);
-		free( fname );
-		if (!cached)
-			return GEM_ERROR;
-		delete cached;
+		print("Decompressing %s", fname.c_str());
+		InflateTask *task = new InflateTask(fname.c_str(), data, complen, comp.get());
+		tasks.push_back(task);
+		pool.Submit(task);
+		packed += complen;
+		unpacked += declen;
+
 		Current = compressed->Remains();
-		//starting at 20% going up to 70%
-		percent = (20 + (All - Current) * 50 / All);
+		//starting at 20% going up to 45%, the rest is spent waiting on the workers
+		percent = (20 + (All - Current) * 25 / All);
 		if (percent - last_percent > 5) {
 			core->LoadProgress(percent);
 			last_percent = percent;
 		}
 	}
 	while(Current);
-	return GEM_OK;
+
+	if (FinishInflating(pool, tasks) != GEM_OK) {
+		ret = GEM_ERROR;
+	}
+	core->LoadProgress(70);
+	LogThroughput("Decompressed", tasks.size(), packed, unpacked, start, pool.GetThreadCount());
+	return ret;
 }
 
 //this one can create .sav files only
@@ -117,8 +278,269 @@ int SAVImporter::AddToSaveGame(DataStream *str, DataStream *uncompressed)
 	return GEM_OK;
 }
 
+int SAVImporter::AddFilesToSaveGame(DataStream *str, const std::vector<std::string> &paths)
+{
+	PluginHolder<Compressor> comp(PLUGIN_COMPRESSION_ZLIB);
+	std::vector<DeflateTask *> tasks;
+	unsigned long start = GetMicroTicks();
+	unsigned long packed = 0, unpacked = 0;
+	int ret = GEM_OK;
+	WorkerPool pool;
+
+	for (size_t i = 0; i < paths.size(); i++) {
+		DeflateTask *task = new DeflateTask(paths[i], comp.get());
+		tasks.push_back(task);
+		pool.Submit(task);
+	}
+	pool.Wait();
+
+	//the entries are written in the order they were given
+	for (size_t i = 0; i < tasks.size(); i++) {
+		DeflateTask *task = tasks[i];
+		if (task->status != GEM_OK) {
+			Log(ERROR, "SAVImporter", "Failed to compress \"%s\".", task->path.c_str());
+			ret = GEM_ERROR;
+			delete task;
+			continue;
+		}
+		ieDword fnlen = strlen(task->name) + 1;
+		ieDword complen = task->out.Size();
+		str->WriteDword( &fnlen);
+		str->Write( task->name, fnlen);
+		str->WriteDword( &task->declen);
+		str->WriteDword( &complen);
+		if (complen) {
+			str->Write( &task->out.buffer[0], complen);
+		}
+		packed += complen;
+		unpacked += task->declen;
+		delete task;
+	}
+	LogThroughput("Compressed", tasks.size(), packed, unpacked, start, pool.GetThreadCount());
+	return ret;
+}
+
+//only these are left packed until they are requested, the rest is
+//opened straight from the cache path (eg. the tlk overrides)
+static const char *lazy_extensions[]={"are","sto",0};
+
+static bool IsLazyExtension(const char *ext)
+{
+	for (int i = 0; lazy_extensions[i]; i++) {
+		if (!stricmp(lazy_extensions[i], ext)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool IsLazy(const std::string &name)
+{
+	size_t dot = name.rfind('.');
+	if (dot == std::string::npos) {
+		return false;
+	}
+	return IsLazyExtension(name.c_str() + dot + 1);
+}
+
+SAVSource::SAVSource(void)
+{
+	description = NULL;
+}
+
+SAVSource::~SAVSource(void)
+{
+	Clear();
+	free(description);
+}
+
+void SAVSource::Clear()
+{
+	std::map<std::string, Entry>::iterator it;
+	for (it = entries.begin(); it != entries.end(); ++it) {
+		free(it->second.data);
+	}
+	entries.clear();
+}
+
+bool SAVSource::Open(const char *filename, const char *desc)
+{
+	if (!core->IsAvailable(PLUGIN_COMPRESSION_ZLIB)) {
+		return false;
+	}
+	DataStream *str = FileStream::OpenFile(filename);
+	if (!str) {
+		return false;
+	}
+	char Signature[8];
+	if (str->Read(Signature, 8) != 8 || strncmp(Signature, "SAV V1.0", 8)) {
+		delete str;
+		return false;
+	}
+
+	free(description);
+	description = strdup(desc);
+	comp = PluginHolder<Compressor>(PLUGIN_COMPRESSION_ZLIB);
+	Clear();
+
+	//the packed data is kept in memory, since the save itself may get
+	//overwritten before all of it is extracted
+	std::vector<InflateTask *> tasks;
+	unsigned long start = GetMicroTicks();
+	unsigned long packed = 0, unpacked = 0;
+	bool ret = true;
+	WorkerPool pool;
+	while (str->Remains()) {
+		std::string fname;
+		Entry entry;
+		if (!ReadEntry(str, fname, entry.declen, entry.complen, entry.data)) {
+			ret = false;
+			break;
+		}
+		if (!IsLazy(fname)) {
+			InflateTask *task = new InflateTask(fname.c_str(), entry.data, entry.complen, comp.get());
+			tasks.push_back(task);
+			pool.Submit(task);
+			packed += entry.complen;
+			unpacked += entry.declen;
+			continue;
+		}
+		//a kept cache would shadow the entry, but it has to win like when
+		//the whole save is extracted
+		char path[_MAX_PATH];
+		PathJoin(path, core->CachePath, fname.c_str(), NULL);
+		if (file_exists(path)) {
+			unlink(path);
+		}
+		std::map<std::string, Entry>::iterator it = entries.find(fname);
+		if (it != entries.end()) {
+			free(it->second.data);
+		}
+		entries[fname] = entry;
+	}
+	delete str;
+
+	if (FinishInflating(pool, tasks) != GEM_OK) {
+		ret = false;
+	}
+	if (!ret) {
+		Clear();
+		return false;
+	}
+	LogThroughput("Decompressed", tasks.size(), packed, unpacked, start, pool.GetThreadCount());
+	Log(MESSAGE, "SAVImporter", "Left %d areas and stores of %s packed until needed.",
+		(int) entries.size(), filename);
+	return true;
+}
+
+DataStream* SAVSource::Extract(const char* resname, const char *ext)
+{
+	if (!IsLazyExtension(ext)) {
+		return NULL;
+	}
+	char key[_MAX_PATH];
+	snprintf(key, sizeof(key), "%s.%s", resname, ext);
+	strlwr(key);
+	std::map<std::string, Entry>::iterator it = entries.find(key);
+	if (it == entries.end()) {
+		return NULL;
+	}
+
+	unsigned long start = GetMicroTicks();
+	//the entry stays packed until it is safely on disk
+	InflateTask task(key, CopyData(it->second.data, it->second.complen), it->second.complen, comp.get());
+	ieDword declen = it->second.declen;
+	task.Run();
+	if (task.status != GEM_OK) {
+		Log(ERROR, "SAVImporter", "Failed to decompress %s.", task.path);
+		//a truncated file would shadow the entry
+		unlink(task.path);
+		return NULL;
+	}
+	free(it->second.data);
+	entries.erase(it);
+	Log(MESSAGE, "SAVImporter", "Extracted %s on first use (%d bytes) in %lu us.",
+		key, (int) declen, GetMicroTicks() - start);
+	return FileStream::OpenFile(task.path);
+}
+
+bool SAVSource::HasEntry(const char* resname, const char *ext) const
+{
+	//other types are looked up by the ambient thread too, and only the
+	//main thread ever asks for areas and stores, which are all we keep
+	if (!IsLazyExtension(ext)) {
+		return false;
+	}
+	if (entries.empty()) {
+		return false;
+	}
+	char key[_MAX_PATH];
+	snprintf(key, sizeof(key), "%s.%s", resname, ext);
+	strlwr(key);
+	return entries.find(key) != entries.end();
+}
+
+bool SAVSource::HasResource(const char* resname, SClass_ID type)
+{
+	return HasEntry(resname, core->TypeExt(type));
+}
+
+bool SAVSource::HasResource(const char* resname, const ResourceDesc &type)
+{
+	return HasEntry(resname, type.GetExt());
+}
+
+DataStream* SAVSource::GetResource(const char* resname, SClass_ID type)
+{
+	return Extract(resname, core->TypeExt(type));
+}
+
+DataStream* SAVSource::GetResource(const char* resname, const ResourceDesc &type)
+{
+	return Extract(resname, type.GetExt());
+}
+
+bool SAVSource::ExtractAll()
+{
+	if (entries.empty()) {
+		return true;
+	}
+	std::vector<InflateTask *> tasks;
+	std::vector<std::string> names;
+	unsigned long start = GetMicroTicks();
+	unsigned long packed = 0, unpacked = 0;
+	WorkerPool pool;
+	std::map<std::string, Entry>::iterator it;
+	for (it = entries.begin(); it != entries.end(); ++it) {
+		//the entries stay packed until they are safely on disk
+		InflateTask *task = new InflateTask(it->first.c_str(), CopyData(it->second.data, it->second.complen), it->second.complen, comp.get());
+		tasks.push_back(task);
+		names.push_back(it->first);
+		pool.Submit(task);
+		packed += it->second.complen;
+		unpacked += it->second.declen;
+	}
+	pool.Wait();
+	bool ret = true;
+	for (size_t i = 0; i < tasks.size(); i++) {
+		if (tasks[i]->status != GEM_OK) {
+			Log(ERROR, "SAVImporter", "Failed to decompress %s.", tasks[i]->path);
+			unlink(tasks[i]->path);
+			ret = false;
+		} else {
+			it = entries.find(names[i]);
+			free(it->second.data);
+			entries.erase(it);
+		}
+		delete tasks[i];
+	}
+	LogThroughput("Extracted", tasks.size(), packed, unpacked, start, pool.GetThreadCount());
+	return ret;
+}
+
 #include "plugindef.h"
 
 GEMRB_PLUGIN(0xCDF132C, "SAV File Importer")
 PLUGIN_CLASS(IE_SAV_CLASS_ID, SAVImporter)
+PLUGIN_CLASS(PLUGIN_RESOURCE_SAVEGAME, SAVSource)
 END_PLUGIN()
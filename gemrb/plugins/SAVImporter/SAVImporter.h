@@ -22,11 +22,16 @@
 #define SAVIMPORTER_H
 
 #include "ArchiveImporter.h"
+#include "ResourceSource.h"
 
 #include "globals.h"
 
+#include "Compressor.h"
+#include "PluginMgr.h"
 #include "System/DataStream.h"
 
+#include <map>
+
 namespace GemRB {
 
 class SAVImporter : public ArchiveImporter {
@@ -35,9 +40,41 @@ public:
 	~SAVImporter(void);
 	int DecompressSaveGame(DataStream *compressed);
 	int AddToSaveGame(DataStream *str, DataStream *uncompressed);
+	int AddFilesToSaveGame(DataStream *str, const std::vector<std::string> &paths);
 	int CreateArchive(DataStream *compressed);
 };
 
+/**
+ * @class SAVSource
+ * Serves the areas and stores of a save archive, which are only inflated
+ * into the cache when first requested. Everything else is extracted
+ * right away on Open.
+ */
+class SAVSource : public ResourceSource {
+public:
+	SAVSource(void);
+	~SAVSource(void);
+	bool Open(const char *filename, const char *description);
+	bool HasResource(const char* resname, SClass_ID type);
+	bool HasResource(const char* resname, const ResourceDesc &type);
+	DataStream* GetResource(const char* resname, SClass_ID type);
+	DataStream* GetResource(const char* resname, const ResourceDesc &type);
+	bool ExtractAll();
+private:
+	struct Entry {
+		ieDword declen;
+		ieDword complen;
+		char *data;
+	};
+	//keyed by the lowercase file name
+	std::map<std::string, Entry> entries;
+	PluginHolder<Compressor> comp;
+
+	void Clear();
+	bool HasEntry(const char* resname, const char *ext) const;
+	DataStream* Extract(const char* resname, const char *ext);
+};
+
 }
 
 #endif
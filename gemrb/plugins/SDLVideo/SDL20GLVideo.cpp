@@ -582,6 +582,9 @@ void GLVideoDriver::BlitGameSprite(const Sprite2D* spr, int x, int y, unsigned i
 	GLTextureSprite2D* glSprite = (GLTextureSprite2D*)spr;
 	GLuint coverTexture = 0;
 
+	// no wall in front of it
+	if (cover && !cover->pixels) cover = NULL;
+
 	if(glSprite->IsPaletted())
 	{
 		if (cover)
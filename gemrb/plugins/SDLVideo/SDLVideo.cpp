@@ -591,6 +591,9 @@ void SDLVideoDriver::BlitGameSprite(const Sprite2D* spr, int x, int y,
 {
 	assert(spr);
 
+	// no wall in front of it
+	if (cover && !cover->pixels) cover = NULL;
+
 	if (!spr->BAM) {
 		SDL_Surface* surf = ((SDLSurfaceSprite2D*)spr)->GetSurface();
 		if (surf->format->BytesPerPixel != 4 && surf->format->BytesPerPixel != 1) {
@@ -21,6 +21,14 @@
 // For debugging:
 //#define HIGHLIGHTCOVER
 
+// Runtime selected SSE2/AVX2 span blitters
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define SR_SIMD 1
+#include <immintrin.h>
+#else
+#define SR_SIMD 0
+#endif
 
 
 // For pixel formats:
@@ -297,8 +305,243 @@ struct SRBlender<Uint32, SRBlender_Alpha, SRFormat_Hard> {
 template <bool b>
 class MSVCHack {};
 
+
+// Span blitting of paletted sprites.
+// When a pixel's colour only depends on its palette index (no alpha
+// blending), we apply the tint and pixel format once per palette entry,
+// and a line of the sprite turns into table lookups, masks and stores.
+// On x86 these spans are done 4 (SSE2) or 8 (AVX2) pixels at a time,
+// picked at runtime, with a plain loop as the fallback.
+
+#if SR_SIMD
+#define SR_SIMD_TARGET(x) __attribute__((target(x)))
+#endif
+
+enum {
+	SRSHADOW_DRAW, // shadow pixels (index 1) are drawn like any other
+	SRSHADOW_HALF, // shadow pixels darken the background to half
+	SRSHADOW_SKIP  // shadow pixels are not drawn
+};
+
+struct SRSpanTable {
+	Uint32 pixels[256]; // target pixel for each palette index
+	int transindex; // skipped index, -1 for none
+	int shadow;
+	Uint32 mask; // for SRSHADOW_HALF, see SRShadow_HalfTrans
+	Uint32 shadowcol;
+};
+
+// which shadow functors have a span equivalent
+template<typename Shadow>
+static int SRSpanShadow(const Shadow&, SRSpanTable&) { return -1; }
+static int SRSpanShadow(const SRShadow_NOP&, SRSpanTable&) { return SRSHADOW_DRAW; }
+static int SRSpanShadow(const SRShadow_Regular&, SRSpanTable&) { return SRSHADOW_DRAW; }
+static int SRSpanShadow(const SRShadow_None&, SRSpanTable&) { return SRSHADOW_SKIP; }
+static int SRSpanShadow(const SRShadow_HalfTrans& shadow, SRSpanTable& table)
+{
+	table.mask = shadow.mask;
+	table.shadowcol = shadow.shadowcol;
+	return SRSHADOW_HALF;
+}
+
+// spans only do opaque pixels
+template<typename Blender>
+static bool SRSpanBlender(const Blender&) { return false; }
+static bool SRSpanBlender(const SRBlender_NoAlpha&) { return true; }
+
+template<typename PTYPE, typename Tinter>
+static void SRSpanFillTable(SRSpanTable& table, const Color* col,
+                            const Tinter& tint, unsigned int flags, PTYPE /*dummy*/ = 0)
+{
+	SRBlender<PTYPE, SRBlender_NoAlpha, SRFormat_Hard> blend;
+	for (int i = 0; i < 256; i++) {
+		Uint8 r = col[i].r;
+		Uint8 g = col[i].g;
+		Uint8 b = col[i].b;
+		Uint8 a = col[i].a;
+		tint(r, g, b, a, flags);
+		PTYPE pix = 0;
+		blend(pix, r, g, b, a);
+		table.pixels[i] = pix;
+	}
+}
+
+// Draw count source pixels starting at pix. With XFLIP, pix and cover
+// run backwards while src runs forwards, like in the blitters below.
+template<typename PTYPE, bool COVER, bool XFLIP>
+static void SRSpan_Plain(PTYPE* pix, const Uint8* src, const Uint8* cover,
+                         int count, const SRSpanTable& table)
+{
+	const int xfactor = XFLIP ? -1 : 1;
+	for (int i = 0; i < count; i++) {
+		Uint8 p = src[i];
+		if ((int)p == table.transindex)
+			continue;
+		if (COVER && cover[xfactor*i])
+			continue;
+		PTYPE& dst = pix[xfactor*i];
+		if (p == 1 && table.shadow != SRSHADOW_DRAW) {
+			if (table.shadow == SRSHADOW_HALF)
+				dst = ((dst >> 1)&table.mask) + table.shadowcol;
+			continue;
+		}
+		dst = (PTYPE)table.pixels[p];
+	}
+}
+
+#if SR_SIMD
+
+template<bool COVER, bool XFLIP>
+SR_SIMD_TARGET("sse2")
+static void SRSpan_SSE2(Uint32* pix, const Uint8* src, const Uint8* cover,
+                        int count, const SRSpanTable& table)
+{
+	const Uint32* pixels = table.pixels;
+	const __m128i trans = _mm_set1_epi32(table.transindex);
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i mask = _mm_set1_epi32(table.mask);
+	const __m128i shadowcol = _mm_set1_epi32(table.shadowcol);
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const Uint8* s = src + i;
+		__m128i idx = _mm_set_epi32(s[3], s[2], s[1], s[0]);
+		__m128i color = _mm_set_epi32(pixels[s[3]], pixels[s[2]], pixels[s[1]], pixels[s[0]]);
+
+		// lanes are kept in source order, so flipped memory gets reversed
+		__m128i* dst = (__m128i*)(XFLIP ? pix - i - 3 : pix + i);
+		__m128i old = _mm_loadu_si128(dst);
+		if (XFLIP)
+			old = _mm_shuffle_epi32(old, _MM_SHUFFLE(0, 1, 2, 3));
+
+		__m128i keep = _mm_cmpeq_epi32(idx, trans);
+		if (COVER) {
+			__m128i cov;
+			if (XFLIP)
+				cov = _mm_set_epi32(cover[-i-3], cover[-i-2], cover[-i-1], cover[-i]);
+			else
+				cov = _mm_set_epi32(cover[i+3], cover[i+2], cover[i+1], cover[i]);
+			keep = _mm_or_si128(keep, _mm_andnot_si128(_mm_cmpeq_epi32(cov, zero), _mm_cmpeq_epi32(zero, zero)));
+		}
+		if (table.shadow != SRSHADOW_DRAW) {
+			__m128i isshadow = _mm_cmpeq_epi32(idx, one);
+			if (table.shadow == SRSHADOW_HALF) {
+				__m128i half = _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(old, 1), mask), shadowcol);
+				color = _mm_or_si128(_mm_and_si128(isshadow, half), _mm_andnot_si128(isshadow, color));
+			} else {
+				keep = _mm_or_si128(keep, isshadow);
+			}
+		}
+
+		__m128i result = _mm_or_si128(_mm_and_si128(keep, old), _mm_andnot_si128(keep, color));
+		if (XFLIP)
+			result = _mm_shuffle_epi32(result, _MM_SHUFFLE(0, 1, 2, 3));
+		_mm_storeu_si128(dst, result);
+	}
+
+	const int xfactor = XFLIP ? -1 : 1;
+	SRSpan_Plain<Uint32, COVER, XFLIP>(pix + xfactor*i, src + i,
+	                                   COVER ? cover + xfactor*i : cover, count - i, table);
+}
+
+template<bool COVER, bool XFLIP>
+SR_SIMD_TARGET("avx2")
+static void SRSpan_AVX2(Uint32* pix, const Uint8* src, const Uint8* cover,
+                        int count, const SRSpanTable& table)
+{
+	const int* pixels = (const int*)table.pixels;
+	const __m256i trans = _mm256_set1_epi32(table.transindex);
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i mask = _mm256_set1_epi32(table.mask);
+	const __m256i shadowcol = _mm256_set1_epi32(table.shadowcol);
+	const __m256i reverse = _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i)));
+		__m256i color = _mm256_i32gather_epi32(pixels, idx, 4);
+
+		// lanes are kept in source order, so flipped memory gets reversed
+		__m256i* dst = (__m256i*)(XFLIP ? pix - i - 7 : pix + i);
+		__m256i old = _mm256_loadu_si256(dst);
+		if (XFLIP)
+			old = _mm256_permutevar8x32_epi32(old, reverse);
+
+		__m256i keep = _mm256_cmpeq_epi32(idx, trans);
+		if (COVER) {
+			__m256i cov = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(XFLIP ? cover - i - 7 : cover + i)));
+			if (XFLIP)
+				cov = _mm256_permutevar8x32_epi32(cov, reverse);
+			keep = _mm256_or_si256(keep, _mm256_xor_si256(_mm256_cmpeq_epi32(cov, zero), _mm256_cmpeq_epi32(zero, zero)));
+		}
+		if (table.shadow != SRSHADOW_DRAW) {
+			__m256i isshadow = _mm256_cmpeq_epi32(idx, one);
+			if (table.shadow == SRSHADOW_HALF) {
+				__m256i half = _mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(old, 1), mask), shadowcol);
+				color = _mm256_blendv_epi8(color, half, isshadow);
+			} else {
+				keep = _mm256_or_si256(keep, isshadow);
+			}
+		}
+
+		__m256i result = _mm256_blendv_epi8(color, old, keep);
+		if (XFLIP)
+			result = _mm256_permutevar8x32_epi32(result, reverse);
+		_mm256_storeu_si256(dst, result);
+	}
+
+	const int xfactor = XFLIP ? -1 : 1;
+	SRSpan_Plain<Uint32, COVER, XFLIP>(pix + xfactor*i, src + i,
+	                                   COVER ? cover + xfactor*i : cover, count - i, table);
+}
+
+#endif
+
+// 0 = plain, 1 = SSE2, 2 = AVX2
+static int SRSpanLevel()
+{
+	static int level = -1;
+	if (level < 0) {
+		level = 0;
+#if SR_SIMD
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+			level = 2;
+		else if (__builtin_cpu_supports("sse2"))
+			level = 1;
+#endif
+	}
+	return level;
+}
+
+template<typename PTYPE, bool COVER, bool XFLIP>
+struct SRSpanFunc {
+	typedef void (*Func)(PTYPE*, const Uint8*, const Uint8*, int, const SRSpanTable&);
+	static Func Get() { return SRSpan_Plain<PTYPE, COVER, XFLIP>; }
+};
+
+template<bool COVER, bool XFLIP>
+struct SRSpanFunc<Uint32, COVER, XFLIP> {
+	typedef void (*Func)(Uint32*, const Uint8*, const Uint8*, int, const SRSpanTable&);
+	static Func Get() {
+#if SR_SIMD
+		switch (SRSpanLevel()) {
+			case 2:
+				return SRSpan_AVX2<COVER, XFLIP>;
+			case 1:
+				return SRSpan_SSE2<COVER, XFLIP>;
+		}
+#endif
+		return SRSpan_Plain<Uint32, COVER, XFLIP>;
+	}
+};
+
+
 // RLE, palette
-template<typename PTYPE, bool COVER, bool XFLIP, typename Shadow, typename Tinter, typename Blender>
+// With SPANS, the functors are ignored and the pixels come from table
+template<typename PTYPE, bool COVER, bool XFLIP, bool SPANS, typename Shadow, typename Tinter, typename Blender>
 static void BlitSpriteRLE_internal(SDL_Surface* target,
             const Uint8* srcdata, const Color* col,
             int tx, int ty,
@@ -308,10 +551,13 @@ static void BlitSpriteRLE_internal(SDL_Surface* target,
             Uint8 transindex,
             const SpriteCover* cover,
             const Sprite2D* spr, unsigned int flags,
-            const Shadow& shadow, const Tinter& tint, const Blender& blend, PTYPE /*dummy*/ = 0, MSVCHack<COVER>* /*dummy*/ = 0, MSVCHack<XFLIP>* /*dummy*/ = 0)
+            const Shadow& shadow, const Tinter& tint, const Blender& blend,
+            const SRSpanTable* table, PTYPE /*dummy*/ = 0, MSVCHack<COVER>* /*dummy*/ = 0, MSVCHack<XFLIP>* /*dummy*/ = 0, MSVCHack<SPANS>* /*dummy*/ = 0)
 {
 	if (COVER)
 		assert(cover);
+	if (SPANS)
+		assert(table);
 	assert(spr);
 
 	int pitch = target->pitch / target->format->BytesPerPixel;
@@ -393,6 +639,10 @@ static void BlitSpriteRLE_internal(SDL_Surface* target,
 	const int yfactor = yflip ? -1 : 1;
 	const int xfactor = XFLIP ? -1 : 1;
 
+	typename SRSpanFunc<PTYPE, COVER, XFLIP>::Func span = 0;
+	if (SPANS)
+		span = SRSpanFunc<PTYPE, COVER, XFLIP>::Get();
+
 	while (line != end) {
 
 		// Fast-forward through the RLE data until we reach clipstartpix
@@ -441,6 +691,18 @@ static void BlitSpriteRLE_internal(SDL_Surface* target,
 						if (COVER)
 							coverpix -= count;
 					}
+				} else if (SPANS) {
+					// the literal pixels up to the next run or the clipping edge
+					const Uint8* start = srcdata - 1;
+					int left = XFLIP ? (int)(pix - clipendpix) : (int)(clipendpix - pix);
+					int count = 1;
+					while (count < left && start[count] != transindex)
+						count++;
+					span(pix, start, COVER ? coverpix : 0, count, *table);
+					srcdata = start + count;
+					pix += xfactor * count;
+					if (COVER)
+						coverpix += xfactor * count;
 				} else {
 					if (!COVER || !*coverpix) {
 						int extra_alpha = 0;
@@ -484,7 +746,8 @@ static void BlitSpriteRLE_internal(SDL_Surface* target,
 }
 
 // non-RLE, palette
-template<typename PTYPE, bool COVER, bool XFLIP, typename Shadow, typename Tinter, typename Blender>
+// With SPANS, the functors are ignored and the pixels come from table
+template<typename PTYPE, bool COVER, bool XFLIP, bool SPANS, typename Shadow, typename Tinter, typename Blender>
 static void BlitSprite_internal(SDL_Surface* target,
             const Uint8* srcdata, const Color* col,
             int tx, int ty,
@@ -494,10 +757,13 @@ static void BlitSprite_internal(SDL_Surface* target,
             int transindex,
             const SpriteCover* cover,
             const Sprite2D* spr, unsigned int flags,
-            const Shadow& shadow, const Tinter& tint, const Blender& blend, PTYPE /*dummy*/ = 0, MSVCHack<COVER>* /*dummy*/ = 0, MSVCHack<XFLIP>* /*dummy*/ = 0)
+            const Shadow& shadow, const Tinter& tint, const Blender& blend,
+            const SRSpanTable* table, PTYPE /*dummy*/ = 0, MSVCHack<COVER>* /*dummy*/ = 0, MSVCHack<XFLIP>* /*dummy*/ = 0, MSVCHack<SPANS>* /*dummy*/ = 0)
 {
 	if (COVER)
 		assert(cover);
+	if (SPANS)
+		assert(table);
 	assert(spr);
 
 	int pitch = target->pitch / target->format->BytesPerPixel;
@@ -559,35 +825,47 @@ static void BlitSprite_internal(SDL_Surface* target,
 	const int yfactor = yflip ? -1 : 1;
 	const int xfactor = XFLIP ? -1 : 1;
 
+	typename SRSpanFunc<PTYPE, COVER, XFLIP>::Func span = 0;
+	if (SPANS)
+		span = SRSpanFunc<PTYPE, COVER, XFLIP>::Get();
+
 	while (line != end) {
-		do {
-			Uint8 p = *srcdata++;
-			if ((int)p != transindex) {
-				if (!COVER || !*coverpix) {
-					int extra_alpha = 0;
-					if (!shadow(*pix, p, extra_alpha, flags)) {
-						Uint8 r = col[p].r;
-						Uint8 g = col[p].g;
-						Uint8 b = col[p].b;
-						Uint8 a = col[p].a;
-						tint(r, g, b, a, flags);
-						blend(*pix, r, g, b, a >> extra_alpha);
+		if (SPANS) {
+			span(pix, srcdata, COVER ? coverpix : 0, clip.w, *table);
+			srcdata += clip.w;
+			pix = endpix;
+			if (COVER)
+				coverpix += xfactor * clip.w;
+		} else {
+			do {
+				Uint8 p = *srcdata++;
+				if ((int)p != transindex) {
+					if (!COVER || !*coverpix) {
+						int extra_alpha = 0;
+						if (!shadow(*pix, p, extra_alpha, flags)) {
+							Uint8 r = col[p].r;
+							Uint8 g = col[p].g;
+							Uint8 b = col[p].b;
+							Uint8 a = col[p].a;
+							tint(r, g, b, a, flags);
+							blend(*pix, r, g, b, a >> extra_alpha);
+						}
 					}
-				}
 #ifdef HIGHLIGHTCOVER
-				else if (COVER) {
-					blend(*pix, 255, 255, 255, 255);
-				}
+					else if (COVER) {
+						blend(*pix, 255, 255, 255, 255);
+					}
 #endif
-			}
-			if (!XFLIP) {
-				pix++;
-				if (COVER) coverpix++;
-			} else {
-				pix--;
-				if (COVER) coverpix--;
-			}
-		} while (pix != endpix);
+				}
+				if (!XFLIP) {
+					pix++;
+					if (COVER) coverpix++;
+				} else {
+					pix--;
+					if (COVER) coverpix--;
+				}
+			} while (pix != endpix);
+		}
 
 		// advance all pointers to the next line
 		pix += yfactor * pitch - xfactor * clip.w;
@@ -734,40 +1012,98 @@ static void BlitSpritePAL_dispatch2(bool COVER, bool XFLIP,
 
 	if (!COVER && !XFLIP)
 		if (RLE)
-			BlitSpriteRLE_internal<PTYPE, false, false, Shadow, Tinter, Blender>(target,
+			BlitSpriteRLE_internal<PTYPE, false, false, false, Shadow, Tinter, Blender>(target,
 			    srcdata, col, tx, ty, width, height, yflip, clip, transindex, cover, spr, flags,
-			    shadow, tint, blend);
+			    shadow, tint, blend, 0);
 		else
-			BlitSprite_internal<PTYPE, false, false, Shadow, Tinter, Blender>(target,
+			BlitSprite_internal<PTYPE, false, false, false, Shadow, Tinter, Blender>(target,
 			    srcdata, col, tx, ty, width, height, yflip, clip, transindex, cover, spr, flags,
-			    shadow, tint, blend);
+			    shadow, tint, blend, 0);
 	else if (!COVER && XFLIP)
 		if (RLE)
-			BlitSpriteRLE_internal<PTYPE, false, true, Shadow, Tinter, Blender>(target,
+			BlitSpriteRLE_internal<PTYPE, false, true, false, Shadow, Tinter, Blender>(target,
 			    srcdata, col, tx, ty, width, height, yflip, clip, transindex, cover, spr, flags,
-			    shadow, tint, blend);
+			    shadow, tint, blend, 0);
 		else
-			BlitSprite_internal<PTYPE, false, true, Shadow, Tinter, Blender>(target,
+			BlitSprite_internal<PTYPE, false, true, false, Shadow, Tinter, Blender>(target,
 			    srcdata, col, tx, ty, width, height, yflip, clip, transindex, cover, spr, flags,
-			    shadow, tint, blend);
+			    shadow, tint, blend, 0);
 	else if (COVER && !XFLIP)
 		if (RLE)
-			BlitSpriteRLE_internal<PTYPE, true, false, Shadow, Tinter, Blender>(target,
+			BlitSpriteRLE_internal<PTYPE, true, false, false, Shadow, Tinter, Blender>(target,
 			    srcdata, col, tx, ty, width, height, yflip, clip, transindex, cover, spr, flags,
-			    shadow, tint, blend);
+			    shadow, tint, blend, 0);
 		else
-			BlitSprite_internal<PTYPE, true, false, Shadow, Tinter, Blender>(target,
+			BlitSprite_internal<PTYPE, true, false, false, Shadow, Tinter, Blender>(target,
 			    srcdata, col, tx, ty, width, height, yflip, clip, transindex, cover, spr, flags,
-			    shadow, tint, blend);
+			    shadow, tint, blend, 0);
 	else // if (COVER && XFLIP)
 		if (RLE)
-			BlitSpriteRLE_internal<PTYPE, true, true, Shadow, Tinter, Blender>(target,
+			BlitSpriteRLE_internal<PTYPE, true, true, false, Shadow, Tinter, Blender>(target,
 			    srcdata, col, tx, ty, width, height, yflip, clip, transindex, cover, spr, flags,
-			    shadow, tint, blend);
+			    shadow, tint, blend, 0);
 		else
-			BlitSprite_internal<PTYPE, true, true, Shadow, Tinter, Blender>(target,
+			BlitSprite_internal<PTYPE, true, true, false, Shadow, Tinter, Blender>(target,
 			    srcdata, col, tx, ty, width, height, yflip, clip, transindex, cover, spr, flags,
-			    shadow, tint, blend);
+			    shadow, tint, blend, 0);
+}
+
+// call the span instantiation of BlitSprite{RLE,}_internal with the specified
+// COVER, XFLIP, RLE bools
+template<typename PTYPE>
+static void BlitSpritePAL_spans(bool COVER, bool XFLIP,
+            SDL_Surface* target,
+            const Uint8* srcdata, const Color* col,
+            int tx, int ty,
+            int width, int height,
+            bool yflip,
+            const Region& clip,
+            int transindex,
+            const SpriteCover* cover,
+            const Sprite2D* spr, unsigned int flags,
+            const SRSpanTable& table, PTYPE /*dummy*/ = 0)
+{
+	bool RLE = spr->RLE;
+	SRShadow_NOP shadow;
+	SRTinter_NoTint<false> tint;
+	SRBlender<PTYPE, SRBlender_NoAlpha, SRFormat_Hard> blend;
+
+	if (!COVER && !XFLIP)
+		if (RLE)
+			BlitSpriteRLE_internal<PTYPE, false, false, true>(target,
+			    srcdata, col, tx, ty, width, height, yflip, clip, transindex, cover, spr, flags,
+			    shadow, tint, blend, &table);
+		else
+			BlitSprite_internal<PTYPE, false, false, true>(target,
+			    srcdata, col, tx, ty, width, height, yflip, clip, transindex, cover, spr, flags,
+			    shadow, tint, blend, &table);
+	else if (!COVER && XFLIP)
+		if (RLE)
+			BlitSpriteRLE_internal<PTYPE, false, true, true>(target,
+			    srcdata, col, tx, ty, width, height, yflip, clip, transindex, cover, spr, flags,
+			    shadow, tint, blend, &table);
+		else
+			BlitSprite_internal<PTYPE, false, true, true>(target,
+			    srcdata, col, tx, ty, width, height, yflip, clip, transindex, cover, spr, flags,
+			    shadow, tint, blend, &table);
+	else if (COVER && !XFLIP)
+		if (RLE)
+			BlitSpriteRLE_internal<PTYPE, true, false, true>(target,
+			    srcdata, col, tx, ty, width, height, yflip, clip, transindex, cover, spr, flags,
+			    shadow, tint, blend, &table);
+		else
+			BlitSprite_internal<PTYPE, true, false, true>(target,
+			    srcdata, col, tx, ty, width, height, yflip, clip, transindex, cover, spr, flags,
+			    shadow, tint, blend, &table);
+	else // if (COVER && XFLIP)
+		if (RLE)
+			BlitSpriteRLE_internal<PTYPE, true, true, true>(target,
+			    srcdata, col, tx, ty, width, height, yflip, clip, transindex, cover, spr, flags,
+			    shadow, tint, blend, &table);
+		else
+			BlitSprite_internal<PTYPE, true, true, true>(target,
+			    srcdata, col, tx, ty, width, height, yflip, clip, transindex, cover, spr, flags,
+			    shadow, tint, blend, &table);
 }
 
 // call the BlitSpritePAL_dispatch2 instantiation with the right pixelformat
@@ -783,8 +1119,29 @@ static void BlitSpritePAL_dispatch(bool COVER, bool XFLIP,
             int transindex,
             const SpriteCover* cover,
             const Sprite2D* spr, unsigned int flags,
-            const Shadow& shadow, const Tinter& tint, const Blender& /*dummy*/)
+            const Shadow& shadow, const Tinter& tint, const Blender& blender)
 {
+#ifndef HIGHLIGHTCOVER
+	// opaque blits go through the span blitters instead
+	SRSpanTable table;
+	table.shadow = SRSpanShadow(shadow, table);
+	if (table.shadow >= 0 && SRSpanBlender(blender)) {
+		table.transindex = transindex;
+		if (target->format->BytesPerPixel == 4) {
+			SRSpanFillTable<Uint32>(table, col, tint, flags);
+			BlitSpritePAL_spans<Uint32>(COVER, XFLIP, target, srcdata, col, tx, ty,
+			                            width, height, yflip, clip, transindex,
+			                            cover, spr, flags, table);
+		} else {
+			SRSpanFillTable<Uint16>(table, col, tint, flags);
+			BlitSpritePAL_spans<Uint16>(COVER, XFLIP, target, srcdata, col, tx, ty,
+			                            width, height, yflip, clip, transindex,
+			                            cover, spr, flags, table);
+		}
+		return;
+	}
+#endif
+
 	if (target->format->BytesPerPixel == 4) {
 		SRBlender<Uint32, Blender, SRFormat_Hard> blend;
 		BlitSpritePAL_dispatch2<Uint32>(COVER, XFLIP, target, srcdata, col, tx, ty,
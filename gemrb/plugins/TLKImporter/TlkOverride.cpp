@@ -22,6 +22,8 @@
 
 #include "TlkOverride.h"
 
+#include "FileCache.h"
+
 #include <algorithm>
 #include <cstdio>
 #include <cassert>
@@ -145,6 +147,8 @@ char* CTlkOverride::GetString(ieDword offset)
 ieStrRef CTlkOverride::UpdateString(ieStrRef strref, const char *newvalue)
 {
 	ieDword memoffset = 0;
+	//a save may still be reading the overrides in the background
+	WaitForBackgroundWrites();
 	ieDword offset = LocateString(strref);
 
 	if (offset == 0xffffffff) {